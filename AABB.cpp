@@ -35,18 +35,19 @@ AABB AABB::overlap(const AABB & b1, const AABB & b2) {
 }
 
 // Ray-AABB intersection code based on: https://medium.com/@bromanz/another-view-on-the-classic-ray-aabb-intersection-algorithm-for-bvh-traversal-41125138b525
-SIMD_float AABB::intersect(const Ray & ray, const SIMD_Vector3 & inv_direction, const SIMD_float & max_distance) const {
-	SIMD_Vector3 aabb_min(min);
-	SIMD_Vector3 aabb_max(max);
+template<int L>
+SIMD_float<L> AABB::intersect(const Ray<L> & ray, const SIMD_Vector3<L> & inv_direction, const SIMD_float<L> & max_distance) const {
+	SIMD_Vector3<L> aabb_min(min);
+	SIMD_Vector3<L> aabb_max(max);
 
-	SIMD_Vector3 t0 = (aabb_min - ray.origin) * inv_direction;
-	SIMD_Vector3 t1 = (aabb_max - ray.origin) * inv_direction;
+	SIMD_Vector3<L> t0 = (aabb_min - ray.origin) * inv_direction;
+	SIMD_Vector3<L> t1 = (aabb_max - ray.origin) * inv_direction;
 	
-	SIMD_Vector3 t_min = SIMD_Vector3::min(t0, t1);
-	SIMD_Vector3 t_max = SIMD_Vector3::max(t0, t1);
+	SIMD_Vector3<L> t_min = SIMD_Vector3<L>::min(t0, t1);
+	SIMD_Vector3<L> t_max = SIMD_Vector3<L>::max(t0, t1);
 	
-	SIMD_float t_near = SIMD_float::max(SIMD_float::max(Ray::EPSILON, t_min.x), SIMD_float::max(t_min.y, t_min.z));
-	SIMD_float t_far  = SIMD_float::min(SIMD_float::min(max_distance, t_max.x), SIMD_float::min(t_max.y, t_max.z));
+	SIMD_float<L> t_near = SIMD_float<L>::max(SIMD_float<L>::max(SIMD_float<L>(Ray<L>::EPSILON), t_min.x), SIMD_float<L>::max(t_min.y, t_min.z));
+	SIMD_float<L> t_far  = SIMD_float<L>::min(SIMD_float<L>::min(max_distance, t_max.x), SIMD_float<L>::min(t_max.y, t_max.z));
 
 	return t_near < t_far;
 }
@@ -71,3 +72,6 @@ AABB AABB::transform(const AABB & aabb, const Matrix4 & transformation) {
 
 	return result;
 }
+
+#define INSTANTIATE_AABB(L) template SIMD_float<L> AABB::intersect(const Ray<L> & ray, const SIMD_Vector3<L> & inv_direction, const SIMD_float<L> & max_distance) const;
+SIMD_LANE_SIZES(INSTANTIATE_AABB)
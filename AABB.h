@@ -1,6 +1,9 @@
 #pragma once
+#include <algorithm>
+
 #include "Ray.h"
 #include "RayHit.h"
+#include "RayInterval.h"
 
 #include "Matrix4.h"
 
@@ -51,7 +54,32 @@ struct AABB {
 
 	static AABB overlap(const AABB & b1, const AABB & b2);
 	
-	SIMD_float intersect(const Ray & ray, const SIMD_Vector3 & inv_direction, const SIMD_float & max_distance) const;
+	template<int L>
+	SIMD_float<L> intersect(const Ray<L> & ray, const SIMD_Vector3<L> & inv_direction, const SIMD_float<L> & max_distance) const;
+
+	// Conservative test whether any lane of the packet can intersect the AABB, using interval arithmetic (see Boulos et al. 2006)
+	// The entry and exit distances along every axis are bounded over all lanes at once. If the largest lower bound on the entry
+	// distance exceeds the smallest upper bound on the exit distance, every lane in the packet must miss the AABB
+	inline bool intersect(const RayInterval & interval, float max_distance) const {
+		if (!interval.is_coherent) return true;
+
+		float t_near = Ray<1>::EPSILON; // The same for every lane size
+		float t_far  = max_distance;
+
+		for (int dimension = 0; dimension < 3; dimension++) {
+			float plane_near = interval.direction_positive[dimension] ? min[dimension] : max[dimension];
+			float plane_far  = interval.direction_positive[dimension] ? max[dimension] : min[dimension];
+
+			float distance_near = plane_near - interval.origin_near[dimension];
+			float distance_far  = plane_far  - interval.origin_far [dimension];
+
+			// All inverse directions along this axis share the same sign, so the bounds of the product lie at the ends of the interval
+			t_near = std::max(t_near, std::min(distance_near * interval.inv_direction_min[dimension], distance_near * interval.inv_direction_max[dimension]));
+			t_far  = std::min(t_far,  std::max(distance_far  * interval.inv_direction_min[dimension], distance_far  * interval.inv_direction_max[dimension]));
+		}
+
+		return t_near < t_far;
+	}
 
 	static AABB transform(const AABB & aabb, const Matrix4 & transformation);
 };
@@ -5,11 +5,18 @@
 #include "BVHNode.h"
 
 namespace BVHBuilders {
-	template<typename PrimitiveType>
+	// Should be called after both children of the given internal Node are built, see BVHNode::should_visit_left_first_occlusion
+	inline void set_largest_child(BVHNode & node, const BVHNode nodes[]) {
+		if (nodes[node.left].aabb.surface_area() >= nodes[node.left + 1].aabb.surface_area()) {
+			node.count |= BVH_LARGEST_LEFT_BIT;
+		}
+	}
+
+	template<int GROUP_SIZE = 1, typename PrimitiveType>
 	inline void build_bvh(BVHNode & node, const PrimitiveType * primitives, int * indices[3], BVHNode nodes[], int & node_index, int first_index, int index_count, float * sah, int * temp) {
 		node.aabb = BVHPartitions::calculate_bounds(primitives, indices[0], first_index, first_index + index_count);
 		
-		if (index_count < 3) {
+		if (index_count <= BVHPartitions::max_forced_leaf_size<GROUP_SIZE>()) {
 			// Leaf Node, terminate recursion
 			node.first = first_index;
 			node.count = index_count;
@@ -22,10 +29,10 @@ namespace BVHBuilders {
 		
 		int split_dimension;
 		float split_cost;
-		int split_index = BVHPartitions::partition_sah(primitives, indices, first_index, index_count, sah, split_dimension, split_cost);
+		int split_index = BVHPartitions::partition_sah<GROUP_SIZE>(primitives, indices, first_index, index_count, sah, split_dimension, split_cost);
 
 		// Check SAH termination condition
-		float parent_cost = node.aabb.surface_area() * float(index_count); 
+		float parent_cost = node.aabb.surface_area() * BVHPartitions::intersection_cost<GROUP_SIZE>(index_count); 
 		if (split_cost >= parent_cost) {
 			node.first = first_index;
 			node.count = index_count;
@@ -41,14 +48,18 @@ namespace BVHBuilders {
 		int n_left  = split_index - first_index;
 		int n_right = first_index + index_count - split_index;
 
-		build_bvh(nodes[node.left    ], primitives, indices, nodes, node_index, first_index,          n_left,  sah, temp);
-		build_bvh(nodes[node.left + 1], primitives, indices, nodes, node_index, first_index + n_left, n_right, sah, temp);
+		build_bvh<GROUP_SIZE>(nodes[node.left    ], primitives, indices, nodes, node_index, first_index,          n_left,  sah, temp);
+		build_bvh<GROUP_SIZE>(nodes[node.left + 1], primitives, indices, nodes, node_index, first_index + n_left, n_right, sah, temp);
+
+		set_largest_child(node, nodes);
 	}
 
+	// L is the lane size used to bin Triangles into the spatial split Bins, see SBVH_BINNING_SIMD
+	template<int L, int GROUP_SIZE>
 	inline int build_sbvh(BVHNode & node, const Triangle * triangles, int * indices[3], BVHNode nodes[], int & node_index, int first_index, int index_count, float * sah, int * temp[2], float inv_root_surface_area, AABB node_aabb) {
 		node.aabb = node_aabb;
 
-		if (index_count < 3) {
+		if (index_count <= BVHPartitions::max_forced_leaf_size<GROUP_SIZE>()) {
 			// Leaf Node, terminate recursion
 			node.first = first_index;
 			node.count = index_count;
@@ -64,7 +75,7 @@ namespace BVHBuilders {
 		int   object_split_dimension;
 		AABB  object_split_aabb_left;
 		AABB  object_split_aabb_right;
-		int   object_split_index = BVHPartitions::partition_object(triangles, indices, first_index, index_count, sah, object_split_dimension, object_split_cost, node_aabb, object_split_aabb_left, object_split_aabb_right);
+		int   object_split_index = BVHPartitions::partition_object<GROUP_SIZE>(triangles, indices, first_index, index_count, sah, object_split_dimension, object_split_cost, node_aabb, object_split_aabb_left, object_split_aabb_right);
 
 		assert(object_split_index != -1);
 
@@ -94,11 +105,11 @@ namespace BVHBuilders {
 
 		// If ratio between overlap area and root area is large enough, consider a Spatial Split
 		if (ratio > alpha) { 
-			BVHPartitions::partition_spatial(triangles, indices, first_index, index_count, spatial_split_dimension, spatial_split_cost, spatial_split_plane_distance, spatial_split_aabb_left, spatial_split_aabb_right, spatial_split_count_left, spatial_split_count_right, node_aabb);
+			BVHPartitions::partition_spatial<L, GROUP_SIZE>(triangles, indices, first_index, index_count, spatial_split_dimension, spatial_split_cost, spatial_split_plane_distance, spatial_split_aabb_left, spatial_split_aabb_right, spatial_split_count_left, spatial_split_count_right, node_aabb);
 		}
 
 		// Check SAH termination condition
-		float parent_cost = node.aabb.surface_area() * float(index_count); 
+		float parent_cost = node.aabb.surface_area() * BVHPartitions::intersection_cost<GROUP_SIZE>(index_count); 
 		if (parent_cost <= object_split_cost && parent_cost <= spatial_split_cost) {
 			node.first = first_index;
 			node.count = index_count;
@@ -311,7 +322,7 @@ namespace BVHBuilders {
 		}
 		
 		// Do a depth first traversal, so that we know the amount of indices that were recursively created by the left child
-		int number_of_leaves_left = build_sbvh(nodes[node.left], triangles, indices, nodes, node_index, first_index, n_left, sah, temp, inv_root_surface_area, child_aabb_left);
+		int number_of_leaves_left = build_sbvh<L, GROUP_SIZE>(nodes[node.left], triangles, indices, nodes, node_index, first_index, n_left, sah, temp, inv_root_surface_area, child_aabb_left);
 
 		// Using the depth first offset, we can now copy over the right references
 		memcpy(indices[0] + first_index + number_of_leaves_left, children_right[0], n_right * sizeof(int));
@@ -319,11 +330,13 @@ namespace BVHBuilders {
 		memcpy(indices[2] + first_index + number_of_leaves_left, children_right[2], n_right * sizeof(int));
 			
 		// Now recurse on the right side
-		int number_of_leaves_right = build_sbvh(nodes[node.left + 1], triangles, indices, nodes, node_index, first_index + number_of_leaves_left, n_right, sah, temp, inv_root_surface_area, child_aabb_right);
+		int number_of_leaves_right = build_sbvh<L, GROUP_SIZE>(nodes[node.left + 1], triangles, indices, nodes, node_index, first_index + number_of_leaves_left, n_right, sah, temp, inv_root_surface_area, child_aabb_right);
 		
 		delete [] children_right[0];
 		delete [] children_right[1];
 		delete [] children_right[2];
+
+		set_largest_child(node, nodes);
 		
 		return number_of_leaves_left + number_of_leaves_right;
 	}
@@ -0,0 +1,119 @@
+#pragma once
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#include "BVHNode.h"
+
+// Contains various ways to reorder the Nodes of a BVH in memory after construction
+// Sibling Nodes are always stored next to each other, so the unit of reordering is a pair of Nodes.
+// Two BVHNodes together are exactly one cache line wide
+namespace BVHLayouts {
+	static_assert(2 * sizeof(BVHNode) == CACHE_LINE_WIDTH, "A pair of sibling Nodes should occupy exactly one cache line");
+
+	// Calculates the height of the subtree below the given pair, measured in pairs
+	inline int calculate_height(const BVHNode nodes[], int pair) {
+		int height = 0;
+
+		for (int i = 0; i < 2; i++) {
+			const BVHNode & node = nodes[pair + i];
+
+			if (!node.is_leaf()) {
+				height = std::max(height, calculate_height(nodes, node.left));
+			}
+		}
+
+		return height + 1;
+	}
+
+	// Collects all pairs that lie exactly 'depth' levels below the given pair
+	inline void collect_pairs_at_depth(const BVHNode nodes[], int pair, int depth, std::vector<int> & pairs) {
+		if (depth == 0) {
+			pairs.push_back(pair);
+
+			return;
+		}
+
+		for (int i = 0; i < 2; i++) {
+			const BVHNode & node = nodes[pair + i];
+
+			if (!node.is_leaf()) {
+				collect_pairs_at_depth(nodes, node.left, depth - 1, pairs);
+			}
+		}
+	}
+
+	// Appends the pairs of the subtree below the given pair, truncated to the given height, in van Emde Boas order.
+	// The top half of the subtree is laid out first, followed by each of the subtrees hanging below it
+	inline void layout_van_emde_boas(const BVHNode nodes[], int pair, int height, std::vector<int> & order) {
+		if (height == 1) {
+			order.push_back(pair);
+
+			return;
+		}
+
+		int height_top    = height / 2;
+		int height_bottom = height - height_top;
+
+		layout_van_emde_boas(nodes, pair, height_top, order);
+
+		std::vector<int> pairs_bottom;
+		collect_pairs_at_depth(nodes, pair, height_top, pairs_bottom);
+
+		int pair_count = int(pairs_bottom.size());
+		for (int i = 0; i < pair_count; i++) {
+			layout_van_emde_boas(nodes, pairs_bottom[i], height_bottom, order);
+		}
+	}
+
+	// Reorders the Nodes such that every subtree is clustered in a contiguous block of memory, at every scale.
+	// This way a path from the root to a leaf touches far fewer cache lines and pages than with the depth first
+	// allocation order of the builders. The builders also allocate child pairs for Nodes that end up being a leaf,
+	// these unreferenced pairs are dropped. Returns the new Node count
+	inline int reorder_van_emde_boas(BVHNode nodes[], int node_count) {
+		// The root Node is stored on its own at index 0, index 1 is unused
+		if (nodes[0].is_leaf()) return 2;
+
+		int root_pair = nodes[0].left;
+
+		std::vector<int> order;
+		order.reserve((node_count - 2) / 2);
+
+		layout_van_emde_boas(nodes, root_pair, calculate_height(nodes, root_pair), order);
+
+		int pair_count = int(order.size());
+
+		int reordered_node_count = 2 + 2 * pair_count;
+		assert(reordered_node_count <= node_count);
+
+		// Maps the old index of a pair to its new index
+		int * pair_indices = new int[node_count];
+		for (int i = 0; i < pair_count; i++) {
+			pair_indices[order[i]] = 2 + 2 * i;
+		}
+
+		BVHNode * reordered_nodes = new BVHNode[reordered_node_count];
+		reordered_nodes[0] = nodes[0];
+		reordered_nodes[1] = nodes[1];
+		reordered_nodes[0].left = pair_indices[root_pair];
+
+		for (int i = 0; i < pair_count; i++) {
+			for (int j = 0; j < 2; j++) {
+				BVHNode & node = reordered_nodes[2 + 2 * i + j];
+				node = nodes[order[i] + j];
+
+				if (!node.is_leaf()) {
+					node.left = pair_indices[node.left];
+				}
+			}
+		}
+
+		memcpy(nodes, reordered_nodes, reordered_node_count * sizeof(BVHNode));
+
+		delete [] reordered_nodes;
+		delete [] pair_indices;
+
+		return reordered_node_count;
+	}
+}
@@ -1,22 +1,25 @@
 #pragma once
 #include "AABB.h"
 #include "Ray.h"
+#include "RayInterval.h"
 
 #define BVH_AXIS_X_BITS (0b01 << 30)
 #define BVH_AXIS_Y_BITS (0b10 << 30)
 #define BVH_AXIS_Z_BITS (0b11 << 30)
 #define BVH_AXIS_MASK   (0b11 << 30)
 
+#define BVH_LARGEST_LEFT_BIT (1 << 29) // Set on internal Nodes whose left child has the largest surface area
+
 struct BVHNode {
 	AABB aabb;
 	union {  // A Node can either be a leaf or have 2 children. A leaf Node means count > 0
 		int left;  // Left contains index of left child if the current Node is not a leaf Node
 		int first; // First constains index of first primtive if the current Node is a leaf Node
 	};
-	int count; // Stores split axis in its 2 highest bits, count in its lowest 30 bits
+	int count; // Stores split axis in its 2 highest bits, the largest child bit below that, count in its lowest 29 bits
 
 	inline int get_count() const {
-		return count & ~BVH_AXIS_MASK;
+		return count & ~(BVH_AXIS_MASK | BVH_LARGEST_LEFT_BIT);
 	}
 
 	inline int get_axis() const {
@@ -27,15 +30,36 @@ struct BVHNode {
 		return get_count() > 0;
 	}
 
-	inline bool should_visit_left_first(const Ray & ray) const {
+	// The order is decided for the packet as a whole, based on the direction sign that most lanes agree on
+	inline bool should_visit_left_first(const RayInterval & interval) const {
 #if BVH_TRAVERSAL_STRATEGY == BVH_TRAVERSE_TREE_NAIVE
 		return true; // Naive always goes left first
 #elif BVH_TRAVERSAL_STRATEGY == BVH_TRAVERSE_TREE_ORDERED
 		switch (get_axis()) {
-			case BVH_AXIS_X_BITS: return ray.direction.x[0] > 0.0f;
-			case BVH_AXIS_Y_BITS: return ray.direction.y[0] > 0.0f;
-			case BVH_AXIS_Z_BITS: return ray.direction.z[0] > 0.0f;
+			case BVH_AXIS_X_BITS: return interval.direction_positive[0];
+			case BVH_AXIS_Y_BITS: return interval.direction_positive[1];
+			case BVH_AXIS_Z_BITS: return interval.direction_positive[2];
 		}
 #endif
 	}
+
+	// Any hit terminates an occlusion query, so the order does not have to depend on the direction of the Ray.
+	// The child with the largest surface area is visited first, since by the SAH it is the most likely to contain an occluder.
+	// The builders decide this once per Node, see BVHBuilders::set_largest_child
+	inline bool should_visit_left_first_occlusion() const {
+		return count & BVH_LARGEST_LEFT_BIT;
+	}
 };
+
+#if BVH_HYBRID_TRAVERSAL
+// Node with up to L children, obtained by collapsing a binary BVH. The bounds of the children are stored
+// in SoA form, so that a single Ray can be tested against all of them at once (see BottomLevelBVH::trace_single)
+template<int L>
+struct WideBVHNode {
+	SIMD_Vector3<L> aabb_min;
+	SIMD_Vector3<L> aabb_max;
+
+	int children[L]; // Index of the child WideBVHNode, or the complement (~index) of a leaf Node in the binary BVH
+	int child_count;
+};
+#endif
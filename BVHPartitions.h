@@ -1,11 +1,26 @@
 #pragma once
 #include "AABB.h"
 #include "Math.h"
+#include "Triangle.h"
 
 #include "Debug.h"
 
 // Contains various ways to parition space into "left" and "right" as well as helper methods
 namespace BVHPartitions {
+	// SAH cost of intersecting the given number of Primitives. Primitives that are intersected a whole group at a time
+	// (see BVH_LEAF_FORMAT_SOA) are free to add until the next group has to be started, a group size of 1 is the regular SAH
+	template<int GROUP_SIZE>
+	inline float intersection_cost(int count) {
+		return float((count + GROUP_SIZE - 1) / GROUP_SIZE);
+	}
+
+	// Nodes with at most this many Primitives are always turned into a leaf.
+	// Splitting a Node that fits in a single group can never reduce the number of groups that need to be intersected
+	template<int GROUP_SIZE>
+	inline int max_forced_leaf_size() {
+		return GROUP_SIZE > 2 ? GROUP_SIZE : 2;
+	}
+
 	// Calculates the smallest enclosing AABB over the union of all AABB's of the primitives in the range defined by [first, last>
 	template<typename PrimitiveType>
 	inline AABB calculate_bounds(const PrimitiveType * primitives, const int * indices, int first, int last) {
@@ -73,7 +88,7 @@ namespace BVHPartitions {
 	}
 
 	// Evaluates SAH for every object for every dimension to determine splitting candidate
-	template<typename PrimitiveType>
+	template<int GROUP_SIZE, typename PrimitiveType>
 	inline int partition_sah(const PrimitiveType * primitives, int * indices[3], int first_index, int index_count, float * sah, int & split_dimension, float & split_cost) {
 		float min_split_cost = INFINITY;
 		int   min_split_index     = -1;
@@ -90,14 +105,14 @@ namespace BVHPartitions {
 			for (int i = 0; i < index_count - 1; i++) {
 				aabb_left.expand(primitives[indices[dimension][first_index + i]].aabb);
 				
-				sah[i] = aabb_left.surface_area() * float(i + 1);
+				sah[i] = aabb_left.surface_area() * intersection_cost<GROUP_SIZE>(i + 1);
 			}
 
 			// Then traverse right to left along the current dimension to evaluate second half of the SAH
 			for (int i = index_count - 1; i > 0; i--) {
 				aabb_right.expand(primitives[indices[dimension][first_index + i]].aabb);
 
-				float cost = sah[i - 1] + aabb_right.surface_area() * float(index_count - i);
+				float cost = sah[i - 1] + aabb_right.surface_area() * intersection_cost<GROUP_SIZE>(index_count - i);
 
 				if (cost < min_split_cost) {
 					min_split_cost = cost;
@@ -114,7 +129,7 @@ namespace BVHPartitions {
 	}
 
 	// Evaluates SAH for every object for every dimension to determine splitting candidate
-	template<typename PrimitiveType>
+	template<int GROUP_SIZE, typename PrimitiveType>
 	inline int partition_object(const PrimitiveType * primitives, int * indices[3], int first_index, int index_count, float * sah, int & split_dimension, float & split_cost, const AABB & node_aabb, AABB & aabb_left, AABB & aabb_right) {
 		float min_split_cost = INFINITY;
 		int   min_split_index     = -1;
@@ -136,7 +151,7 @@ namespace BVHPartitions {
 				bounds_left[i].expand(primitives[indices[dimension][first_index + i - 1]].aabb);
 				bounds_left[i] = AABB::overlap(bounds_left[i], node_aabb);
 
-				sah[i] = bounds_left[i].surface_area() * float(i);
+				sah[i] = bounds_left[i].surface_area() * intersection_cost<GROUP_SIZE>(i);
 			}
 
 			// Then traverse right to left along the current dimension to evaluate second half of the SAH
@@ -145,7 +160,7 @@ namespace BVHPartitions {
 				bounds_right[i].expand(primitives[indices[dimension][first_index + i]].aabb);
 				bounds_right[i] = AABB::overlap(bounds_right[i], node_aabb);
 				
-				float cost = sah[i] + bounds_right[i].surface_area() * float(index_count - i);
+				float cost = sah[i] + bounds_right[i].surface_area() * intersection_cost<GROUP_SIZE>(index_count - i);
 
 				if (cost < min_split_cost) {
 					min_split_cost = cost;
@@ -170,9 +185,157 @@ namespace BVHPartitions {
 		return min_split_index;
 	}
 
+	const int SBVH_BIN_COUNT = 256;
+
+#if SBVH_BINNING == SBVH_BINNING_SIMD
+	// Bounds of the spatial split Bins along one dimension, stored as SoA so that L consecutive Bins can be loaded and stored at once
+	struct SpatialBinBounds {
+		alignas(CACHE_LINE_WIDTH) float min_x[SBVH_BIN_COUNT];
+		alignas(CACHE_LINE_WIDTH) float min_y[SBVH_BIN_COUNT];
+		alignas(CACHE_LINE_WIDTH) float min_z[SBVH_BIN_COUNT];
+		alignas(CACHE_LINE_WIDTH) float max_x[SBVH_BIN_COUNT];
+		alignas(CACHE_LINE_WIDTH) float max_y[SBVH_BIN_COUNT];
+		alignas(CACHE_LINE_WIDTH) float max_z[SBVH_BIN_COUNT];
+	};
+
+	// Makes sure the AABB's in the active lanes are non-zero along every dimension, same as AABB::fix_if_needed
+	template<int L>
+	inline FORCEINLINE void fix_if_needed(const SIMD_Vector3<L> & box_min, SIMD_Vector3<L> & box_max) {
+		const SIMD_float<L> min_extent(0.001f);
+		const SIMD_float<L> fix_extent(0.005f);
+
+		box_max.x = SIMD_float<L>::blend(box_max.x, box_max.x + fix_extent, (box_max.x - box_min.x) < min_extent);
+		box_max.y = SIMD_float<L>::blend(box_max.y, box_max.y + fix_extent, (box_max.y - box_min.y) < min_extent);
+		box_max.z = SIMD_float<L>::blend(box_max.z, box_max.z + fix_extent, (box_max.z - box_min.z) < min_extent);
+	}
+
+	// Clips the Triangle against the planes of L consecutive Bins at once and expands the bounds of those Bins.
+	// The vertices should be sorted along the given dimension. Every lane performs exactly the same floating point
+	// operations as the scalar path, so both paths produce identical Bins
+	template<int L>
+	inline void bin_triangle_simd(const Triangle & triangle, const Vector3 vertices[3], int dimension, int bin_min, int bin_max, const float planes_left[], const float planes_right[], const float bin_indices[], const AABB & bounds, SpatialBinBounds & bin_bounds) {
+		const SIMD_float<L> zero(0.0f);
+		const SIMD_float<L> one (1.0f);
+		const SIMD_float<L> two (2.0f);
+
+		const SIMD_Vector3<L> empty_min = SIMD_Vector3<L>(SIMD_float<L>( INFINITY));
+		const SIMD_Vector3<L> empty_max = SIMD_Vector3<L>(SIMD_float<L>(-INFINITY));
+
+		SIMD_float<L> vertex_min(vertices[0][dimension]);
+		SIMD_float<L> vertex_mid(vertices[1][dimension]);
+		SIMD_float<L> vertex_max(vertices[2][dimension]);
+
+		SIMD_Vector3<L> vertices_simd[3] = {
+			SIMD_Vector3<L>(vertices[0]),
+			SIMD_Vector3<L>(vertices[1]),
+			SIMD_Vector3<L>(vertices[2])
+		};
+
+		SIMD_Vector3<L> triangle_min(triangle.aabb.min);
+		SIMD_Vector3<L> triangle_max(triangle.aabb.max);
+
+		SIMD_Vector3<L> bounds_min(bounds.min);
+		SIMD_Vector3<L> bounds_max(bounds.max);
+
+		SIMD_float<L> first_bin = SIMD_float<L>(float(bin_min));
+		SIMD_float<L> last_bin  = SIMD_float<L>(float(bin_max));
+
+		// Start at a multiple of the lane size, so that all loads and stores are aligned
+		for (int b = bin_min & ~(L - 1); b <= bin_max; b += L) {
+			SIMD_float<L> bin_index = SIMD_float<L>::load(bin_indices + b);
+
+			SIMD_float<L> bin_left_plane  = SIMD_float<L>::load(planes_left  + b);
+			SIMD_float<L> bin_right_plane = SIMD_float<L>::load(planes_right + b);
+
+			// Lanes outside of [bin_min, bin_max] and lanes where all vertices lie on one side of either plane are left untouched
+			SIMD_float<L> mask_active = (bin_index >= first_bin) & (bin_index <= last_bin);
+			SIMD_float<L> mask_empty  = (vertex_min >= bin_right_plane) | (vertex_max <= bin_left_plane);
+
+			mask_active = SIMD_float<L>::andnot(mask_empty, mask_active);
+
+			if (SIMD_float<L>::all_false(mask_active)) continue;
+
+			// Lanes where all vertices lie between the two planes use the Triangle's entire AABB
+			SIMD_float<L> mask_contained = (vertex_min >= bin_left_plane) & (vertex_max <= bin_right_plane);
+
+			SIMD_Vector3<L> box_min = empty_min;
+			SIMD_Vector3<L> box_max = empty_max;
+
+			SIMD_float<L> intersection_count(0.0f);
+
+			for (int i = 0; i < 3; i++) {
+				SIMD_float<L> vertex_i(vertices[i][dimension]);
+
+				for (int j = i + 1; j < 3; j++) {
+					SIMD_float<L> vertex_j(vertices[j][dimension]);
+
+					SIMD_float<L> delta_ij = vertex_j - vertex_i;
+
+					for (int p = 0; p < 2; p++) {
+						SIMD_float<L> plane = p == 0 ? bin_left_plane : bin_right_plane;
+
+						// Check if edge between Vertex i and j intersects the plane and lerp to obtain exact intersection point
+						SIMD_float<L> mask_intersect = (vertex_i < plane) & (plane <= vertex_j);
+
+						SIMD_float<L>   t = (plane - vertex_i) / delta_ij;
+						SIMD_Vector3<L> intersection = (one - t) * vertices_simd[i] + t * vertices_simd[j];
+
+						box_min = SIMD_Vector3<L>::blend(box_min, SIMD_Vector3<L>::min(box_min, intersection), mask_intersect);
+						box_max = SIMD_Vector3<L>::blend(box_max, SIMD_Vector3<L>::max(box_max, intersection), mask_intersect);
+
+						intersection_count = intersection_count + SIMD_float<L>::blend(zero, one, mask_intersect);
+					}
+				}
+			}
+
+			fix_if_needed(box_min, box_max);
+
+			// If the middle vertex lies between the two planes it should be included in the AABB
+			SIMD_float<L> mask_middle = (vertex_mid >= bin_left_plane) & (vertex_mid < bin_right_plane);
+
+			box_min = SIMD_Vector3<L>::blend(box_min, SIMD_Vector3<L>::min(box_min, vertices_simd[1]), mask_middle);
+			box_max = SIMD_Vector3<L>::blend(box_max, SIMD_Vector3<L>::max(box_max, vertices_simd[1]), mask_middle);
+
+			// In case we have only two intersections with either plane it must be the case that
+			// either the leftmost or the rightmost vertex lies between the two planes
+			SIMD_float<L>   mask_two_intersections = intersection_count == two;
+			SIMD_Vector3<L> vertex_outer = SIMD_Vector3<L>::blend(vertices_simd[0], vertices_simd[2], vertex_max < bin_right_plane);
+
+			box_min = SIMD_Vector3<L>::blend(box_min, SIMD_Vector3<L>::min(box_min, vertex_outer), mask_two_intersections);
+			box_max = SIMD_Vector3<L>::blend(box_max, SIMD_Vector3<L>::max(box_max, vertex_outer), mask_two_intersections);
+
+			fix_if_needed(box_min, box_max);
+
+			box_min = SIMD_Vector3<L>::blend(box_min, triangle_min, mask_contained);
+			box_max = SIMD_Vector3<L>::blend(box_max, triangle_max, mask_contained);
+
+			SIMD_Vector3<L> bin_min_old(SIMD_float<L>::load(bin_bounds.min_x + b), SIMD_float<L>::load(bin_bounds.min_y + b), SIMD_float<L>::load(bin_bounds.min_z + b));
+			SIMD_Vector3<L> bin_max_old(SIMD_float<L>::load(bin_bounds.max_x + b), SIMD_float<L>::load(bin_bounds.max_y + b), SIMD_float<L>::load(bin_bounds.max_z + b));
+
+			// Expand the Bins and clip them against the parent bounds, same as AABB::expand followed by AABB::overlap
+			SIMD_Vector3<L> bin_min_new = SIMD_Vector3<L>::max(SIMD_Vector3<L>::min(bin_min_old, box_min), bounds_min);
+			SIMD_Vector3<L> bin_max_new = SIMD_Vector3<L>::min(SIMD_Vector3<L>::max(bin_max_old, box_max), bounds_max);
+
+			SIMD_float<L> mask_valid = (bin_max_new.x > bin_min_new.x) & (bin_max_new.y > bin_min_new.y) & (bin_max_new.z > bin_min_new.z);
+
+			bin_min_new = SIMD_Vector3<L>::blend(empty_min, bin_min_new, mask_valid);
+			bin_max_new = SIMD_Vector3<L>::blend(empty_max, bin_max_new, mask_valid);
+
+			bin_min_new = SIMD_Vector3<L>::blend(bin_min_old, bin_min_new, mask_active);
+			bin_max_new = SIMD_Vector3<L>::blend(bin_max_old, bin_max_new, mask_active);
+
+			SIMD_float<L>::store(bin_bounds.min_x + b, bin_min_new.x);
+			SIMD_float<L>::store(bin_bounds.min_y + b, bin_min_new.y);
+			SIMD_float<L>::store(bin_bounds.min_z + b, bin_min_new.z);
+			SIMD_float<L>::store(bin_bounds.max_x + b, bin_max_new.x);
+			SIMD_float<L>::store(bin_bounds.max_y + b, bin_max_new.y);
+			SIMD_float<L>::store(bin_bounds.max_z + b, bin_max_new.z);
+		}
+	}
+#endif
+
+	template<int L, int GROUP_SIZE>
 	inline int partition_spatial(const Triangle * triangles, int * indices[3], int first_index, int index_count, int & split_dimension, float & split_cost, float & plane_distance, AABB & aabb_left, AABB & aabb_right, int & n_left, int & n_right, AABB bounds) {
-		const int SBVH_BIN_COUNT = 256;
-		
 		float min_bin_cost = INFINITY;
 		int   min_bin_index     = -1;
 		int   min_bin_dimension = -1;
@@ -191,6 +354,23 @@ namespace BVHPartitions {
 				int exits   = 0;
 			} bins[SBVH_BIN_COUNT];
 
+#if SBVH_BINNING == SBVH_BINNING_SIMD
+			alignas(CACHE_LINE_WIDTH) float planes_left [SBVH_BIN_COUNT];
+			alignas(CACHE_LINE_WIDTH) float planes_right[SBVH_BIN_COUNT];
+			alignas(CACHE_LINE_WIDTH) float bin_indices [SBVH_BIN_COUNT];
+
+			SpatialBinBounds bin_bounds;
+
+			for (int b = 0; b < SBVH_BIN_COUNT; b++) {
+				planes_left [b] = bounds_min + float(b) * bounds_step;
+				planes_right[b] = planes_left[b] + bounds_step;
+				bin_indices [b] = float(b);
+
+				bin_bounds.min_x[b] = bin_bounds.min_y[b] = bin_bounds.min_z[b] =  INFINITY;
+				bin_bounds.max_x[b] = bin_bounds.max_y[b] = bin_bounds.max_z[b] = -INFINITY;
+			}
+#endif
+
 			for (int i = first_index; i < first_index + index_count; i++) {
 				const Triangle & triangle = triangles[indices[dimension][i]];
 				
@@ -205,9 +385,6 @@ namespace BVHPartitions {
 				if (vertices[1][dimension] > vertices[2][dimension]) Util::swap(vertices[1], vertices[2]);
 				if (vertices[0][dimension] > vertices[1][dimension]) Util::swap(vertices[0], vertices[1]);
 
-				float vertex_min = vertices[0][dimension];
-				float vertex_max = vertices[2][dimension];
-				
 				int bin_min = int(SBVH_BIN_COUNT * ((triangle.aabb.min[dimension] - bounds_min) * inv_bounds_delta));
 				int bin_max = int(SBVH_BIN_COUNT * ((triangle.aabb.max[dimension] - bounds_min) * inv_bounds_delta));
 
@@ -217,6 +394,10 @@ namespace BVHPartitions {
 				bins[bin_min].entries++;
 				bins[bin_max].exits++;
 
+#if SBVH_BINNING == SBVH_BINNING_SCALAR
+				float vertex_min = vertices[0][dimension];
+				float vertex_max = vertices[2][dimension];
+
 				// Iterate over bins that intersect the AABB along the current dimension
 				for (int b = bin_min; b <= bin_max; b++) {
 					Bin & bin = bins[b];
@@ -300,7 +481,20 @@ namespace BVHPartitions {
 					assert(bin.aabb.min[1] > bounds.min[1] - epsilon && bin.aabb.max[1] < bounds.max[1] + epsilon);
 					assert(bin.aabb.min[2] > bounds.min[2] - epsilon && bin.aabb.max[2] < bounds.max[2] + epsilon);
 				}
+#elif SBVH_BINNING == SBVH_BINNING_SIMD
+				bin_triangle_simd<L>(triangle, vertices, dimension, bin_min, bin_max, planes_left, planes_right, bin_indices, bounds, bin_bounds);
+#endif
+			}
+
+#if SBVH_BINNING == SBVH_BINNING_SIMD
+			// Transpose the SoA bounds back into the Bins for the SAH sweep below
+			for (int b = 0; b < SBVH_BIN_COUNT; b++) {
+				bins[b].aabb.min = Vector3(bin_bounds.min_x[b], bin_bounds.min_y[b], bin_bounds.min_z[b]);
+				bins[b].aabb.max = Vector3(bin_bounds.max_x[b], bin_bounds.max_y[b], bin_bounds.max_z[b]);
+
+				assert(bins[b].aabb.is_valid() || bins[b].aabb.is_empty());
 			}
+#endif
 
 			float bin_sah[SBVH_BIN_COUNT];
 
@@ -326,7 +520,7 @@ namespace BVHPartitions {
 				count_left[b] = count_left[b-1] + bins[b-1].entries;
 
 				if (count_left[b] < index_count) {
-					bin_sah[b] = bounds_left[b].surface_area() * float(count_left[b]);
+					bin_sah[b] = bounds_left[b].surface_area() * intersection_cost<GROUP_SIZE>(count_left[b]);
 				} else {
 					bin_sah[b] = INFINITY;
 				}
@@ -342,7 +536,7 @@ namespace BVHPartitions {
 				count_right[b] = count_right[b+1] + bins[b].exits;
 
 				if (count_right[b] < index_count) {
-					bin_sah[b] += bounds_right[b].surface_area() * float(count_right[b]);
+					bin_sah[b] += bounds_right[b].surface_area() * intersection_cost<GROUP_SIZE>(count_right[b]);
 				} else {
 					bin_sah[b] = INFINITY;
 				}
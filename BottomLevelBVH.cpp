@@ -1,6 +1,7 @@
 #include "BottomLevelBVH.h"
 
 #include <algorithm>
+#include <vector>
 #include <filesystem>
 #include <unordered_map>
 
@@ -8,22 +9,66 @@
 
 #include "Material.h"
 
+#include "BVHLayouts.h"
+
+#include "LargeRayPacket.h"
+
 #include "SIMD_Vector2.h"
 #include "SIMD_Vector3.h"
 
 #include "ScopeTimer.h"
 
-static std::unordered_map<std::string, BottomLevelBVH *> bvh_cache;
+// One cache per lane size, every lane size is a different instantiation of BottomLevelBVH
+template<int L>
+static std::unordered_map<std::string, BottomLevelBVH<L> *> bvh_cache;
+
+// Remembers the given Triangle as the last one that occluded a Shadow Ray, see Occluder
+template<int L>
+void BottomLevelBVH<L>::record_occluder(Occluder & occluder, const TriangleHot & triangle) {
+	occluder.position_0      = triangle.position_0;
+	occluder.position_edge_1 = triangle.position_edge_1;
+	occluder.position_edge_2 = triangle.position_edge_2;
+}
+
+template<int L>
+static FORCEINLINE void set_lane(SIMD_Vector3<L> & vector, int lane, const Vector3 & value) {
+	vector.x[lane] = value.x;
+	vector.y[lane] = value.y;
+	vector.z[lane] = value.z;
+}
+
+template<int L>
+static FORCEINLINE void set_lane(SIMD_Vector2<L> & vector, int lane, const Vector2 & value) {
+	vector.x[lane] = value.x;
+	vector.y[lane] = value.y;
+}
+
+// Returns a mask where only the given lane is set
+template<int L>
+static FORCEINLINE SIMD_float<L> lane_mask(int lane) {
+	SIMD_float<L> lane_indices;
+	for (int i = 0; i < L; i++) {
+		lane_indices[i] = float(i);
+	}
+
+	return lane_indices == SIMD_float<L>(float(lane));
+}
 
-const BottomLevelBVH * BottomLevelBVH::load(const char * filename) {
-	BottomLevelBVH *& bvh = bvh_cache[filename];
+template<int L>
+const BottomLevelBVH<L> * BottomLevelBVH<L>::load(const char * filename, int flags) {
+	// Meshes choose which optional data structures they use, so the same file is cached separately for every combination of flags
+	BottomLevelBVH *& bvh = bvh_cache<L>[std::string(filename) + ":" + std::to_string(flags)];
 
 	// If the cache already contains the requested BVH simply return it
 	if (bvh) return bvh;
 
 	bvh = new BottomLevelBVH();
 
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+	std::string bvh_filename = std::string(filename) + "." + std::to_string(L) + ".bvh";
+#else
 	std::string bvh_filename = std::string(filename) + ".bvh";
+#endif
 	
 	if (std::filesystem::exists(bvh_filename)) {
 		printf("Loading BVH %s from disk.\n", bvh_filename.c_str());
@@ -48,28 +93,109 @@ const BottomLevelBVH * BottomLevelBVH::load(const char * filename) {
 		}
 #endif
 
+#if BVH_LAYOUT == BVH_LAYOUT_VAN_EMDE_BOAS
+		{
+			ScopeTimer timer("Mesh BVH Node Reordering");
+			bvh->node_count = BVHLayouts::reorder_van_emde_boas(bvh->nodes, bvh->node_count);
+		}
+#endif
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+		// Compress straight from the construction Triangles, full precision positions are never stored in the BVH or the .bvh file
+		bvh->compress(triangles);
+#endif
+
 		delete [] triangles;
 
+#if BVH_TRIANGLE_RECORDS && BVH_LEAF_FORMAT != BVH_LEAF_FORMAT_COMPRESSED
+		bvh->calculate_triangle_records();
+#endif
+
 		bvh->save_to_disk(bvh_filename.c_str());
 	}
+
+	// Triangle records are always stored in the .bvh file, but only kept in memory if the Mesh uses them
+	if (!(flags & FLAG_TRIANGLE_RECORDS) && bvh->triangle_records) {
+		Util::aligned_free(bvh->triangle_records);
+		bvh->triangle_records = nullptr;
+	}
 	
+	// The Shadow BVH is built from the original Triangles, before they are duplicated
+	if (flags & FLAG_SHADOW_BVH) {
+		ScopeTimer timer("Mesh Shadow BVH Construction");
+
+		Triangle * triangles = new Triangle[bvh->triangle_count];
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+		// Only the quantized positions are available, every reference to a Triangle decompresses to the same positions
+		for (int i = 0; i < bvh->index_count; i++) {
+			const CompressedTriangle & compressed_triangle = bvh->compressed_triangles[i];
+
+			TriangleHot triangle = bvh->decompress(bvh->compressed_leaves[compressed_triangle.leaf], i);
+
+			Triangle & original_triangle = triangles[compressed_triangle.index];
+			original_triangle.position_0 = triangle.position_0;
+			original_triangle.position_1 = triangle.position_0 + triangle.position_edge_1;
+			original_triangle.position_2 = triangle.position_0 + triangle.position_edge_2;
+		}
+
+		for (int i = 0; i < bvh->triangle_count; i++) {
+			triangles[i].calc_aabb();
+		}
+#else
+		for (int i = 0; i < bvh->triangle_count; i++) {
+			const TriangleHot & triangle = bvh->triangles_hot[i];
+
+			triangles[i].position_0 = triangle.position_0;
+			triangles[i].position_1 = triangle.position_0 + triangle.position_edge_1;
+			triangles[i].position_2 = triangle.position_0 + triangle.position_edge_2;
+			triangles[i].calc_aabb();
+		}
+#endif
+
+		bvh->shadow_bvh = ShadowBVH::build(triangles, bvh->triangle_count);
+
+		delete [] triangles;
+	}
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_FLAT
 	bvh->flatten();
+#elif BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+	bvh->pack_triangle_groups();
+#endif
+
+#if BVH_HYBRID_TRAVERSAL
+	if constexpr (HYBRID_TRAVERSAL) {
+		bvh->build_wide_bvh();
+	}
+#endif
+
 	return bvh;
 }
 
-void BottomLevelBVH::init(int count) {
+template<int L>
+void BottomLevelBVH<L>::init(int count) {
 	assert(count > 0);
 
 	triangle_count = count; 
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+	triangles_hot  = nullptr; // Positions are only stored in compressed form, see compress()
+#else
 	triangles_hot  = Util::aligned_malloc<TriangleHot> (triangle_count, CACHE_LINE_WIDTH);
+#endif
 	triangles_cold = Util::aligned_malloc<TriangleCold>(triangle_count, CACHE_LINE_WIDTH);
 
+	triangle_records = nullptr;
+
+	shadow_bvh = nullptr;
+
 	indices = nullptr;
 
 	nodes = Util::aligned_malloc<BVHNode>(2 * triangle_count, CACHE_LINE_WIDTH);
 }
 
-void BottomLevelBVH::build_bvh(const Triangle * triangles) {
+template<int L>
+void BottomLevelBVH<L>::build_bvh(const Triangle * triangles) {
 	int * indices_x = new int[triangle_count];
 	int * indices_y = new int[triangle_count];
 	int * indices_z = new int[triangle_count];
@@ -90,7 +216,7 @@ void BottomLevelBVH::build_bvh(const Triangle * triangles) {
 	int   * temp = new int[triangle_count];
 
 	node_count = 2;
-	BVHBuilders::build_bvh(nodes[0], triangles, indices_xyz, nodes, node_count, 0, triangle_count, sah, temp);
+	BVHBuilders::build_bvh<GROUP_SIZE>(nodes[0], triangles, indices_xyz, nodes, node_count, 0, triangle_count, sah, temp);
 
 	assert(node_count <= 2 * triangle_count);
 
@@ -105,7 +231,8 @@ void BottomLevelBVH::build_bvh(const Triangle * triangles) {
 	delete [] sah;
 }
 
-void BottomLevelBVH::build_sbvh(const Triangle * triangles) {
+template<int L>
+void BottomLevelBVH<L>::build_sbvh(const Triangle * triangles) {
 	const int overallocation = 2; // SBVH requires more space
 
 	int * indices_x = new int[overallocation * triangle_count];
@@ -130,7 +257,7 @@ void BottomLevelBVH::build_sbvh(const Triangle * triangles) {
 	AABB root_aabb = BVHPartitions::calculate_bounds(triangles, indices_xyz[0], 0, triangle_count);
 
 	node_count = 2;
-	index_count = BVHBuilders::build_sbvh(nodes[0], triangles, indices_xyz, nodes, node_count, 0, triangle_count, sah, temp, 1.0f / root_aabb.surface_area(), root_aabb);
+	index_count = BVHBuilders::build_sbvh<L, GROUP_SIZE>(nodes[0], triangles, indices_xyz, nodes, node_count, 0, triangle_count, sah, temp, 1.0f / root_aabb.surface_area(), root_aabb);
 
 	printf("SBVH Leaf count: %i\n", index_count);
 
@@ -146,7 +273,57 @@ void BottomLevelBVH::build_sbvh(const Triangle * triangles) {
 	delete [] sah;
 }
 
-void BottomLevelBVH::save_to_disk(const char * bvh_filename) const {
+#if BVH_TRIANGLE_RECORDS
+// Calculates the affine transformation that maps every Triangle onto the unit Triangle, see: http://jcgt.org/published/0005/03/03/
+template<int L>
+void BottomLevelBVH<L>::calculate_triangle_records() {
+	triangle_records = Util::aligned_malloc<TriangleRecord>(triangle_count, CACHE_LINE_WIDTH);
+
+	for (int i = 0; i < triangle_count; i++) {
+		const TriangleHot & triangle = triangles_hot[i];
+
+		const Vector3 & edge_1 = triangle.position_edge_1;
+		const Vector3 & edge_2 = triangle.position_edge_2;
+
+		Vector3 normal = Vector3::cross(edge_1, edge_2);
+
+		// Project along the dimension in which the normal is largest, this avoids dividing by small numbers
+		int k;
+		if (fabsf(normal.x) > fabsf(normal.y) && fabsf(normal.x) > fabsf(normal.z)) {
+			k = 0;
+		} else if (fabsf(normal.y) > fabsf(normal.z)) {
+			k = 1;
+		} else {
+			k = 2;
+		}
+
+		int a = (k + 1) % 3;
+		int b = (k + 2) % 3;
+
+		float inv_normal_k = 1.0f / normal[k];
+
+		TriangleRecord & record = triangle_records[i];
+		
+		record.transform_u = Vector3(0.0f);
+		record.transform_u[a] =  edge_2[b] * inv_normal_k;
+		record.transform_u[b] = -edge_2[a] * inv_normal_k;
+
+		record.transform_v = Vector3(0.0f);
+		record.transform_v[a] = -edge_1[b] * inv_normal_k;
+		record.transform_v[b] =  edge_1[a] * inv_normal_k;
+
+		record.transform_t = normal * inv_normal_k;
+
+		// The first vertex should map to the origin
+		record.offset_u = -Vector3::dot(record.transform_u, triangle.position_0);
+		record.offset_v = -Vector3::dot(record.transform_v, triangle.position_0);
+		record.offset_t = -Vector3::dot(record.transform_t, triangle.position_0);
+	}
+}
+#endif
+
+template<int L>
+void BottomLevelBVH<L>::save_to_disk(const char * bvh_filename) const {
 	FILE * file;
 	fopen_s(&file, bvh_filename, "wb");
 
@@ -154,20 +331,37 @@ void BottomLevelBVH::save_to_disk(const char * bvh_filename) const {
 
 	fwrite(&triangle_count, sizeof(int), 1, file);
 
+#if BVH_LEAF_FORMAT != BVH_LEAF_FORMAT_COMPRESSED
 	fwrite(triangles_hot,  sizeof(TriangleHot),  triangle_count, file);
+#endif
 	fwrite(triangles_cold, sizeof(TriangleCold), triangle_count, file);
 
+#if BVH_TRIANGLE_RECORDS && BVH_LEAF_FORMAT != BVH_LEAF_FORMAT_COMPRESSED
+	fwrite(triangle_records, sizeof(TriangleRecord), triangle_count, file);
+#endif
+
 	fwrite(&node_count, sizeof(int), 1, file);
 	fwrite(nodes, sizeof(BVHNode), node_count, file);
 
 	fwrite(&index_count, sizeof(int), 1, file);
 		
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+	fwrite(compressed_triangles, sizeof(CompressedTriangle), index_count, file);
+
+	fwrite(&compressed_leaf_count, sizeof(int), 1, file);
+	fwrite(compressed_leaves, sizeof(CompressedLeaf), compressed_leaf_count, file);
+
+	fwrite(&compressed_vertex_count, sizeof(int), 1, file);
+	fwrite(compressed_vertices, sizeof(CompressedVertex), compressed_vertex_count, file);
+#else
 	fwrite(indices, sizeof(int), index_count, file);
+#endif
 
 	fclose(file);
 }
 
-void BottomLevelBVH::load_from_disk(const char * bvh_filename) {
+template<int L>
+void BottomLevelBVH<L>::load_from_disk(const char * bvh_filename) {
 	FILE * file;
 	fopen_s(&file, bvh_filename, "rb"); 
 	
@@ -176,24 +370,45 @@ void BottomLevelBVH::load_from_disk(const char * bvh_filename) {
 	fread(&triangle_count, sizeof(int), 1, file);
 	init(triangle_count);
 
+#if BVH_LEAF_FORMAT != BVH_LEAF_FORMAT_COMPRESSED
 	fread(triangles_hot,  sizeof(TriangleHot),  triangle_count, file);
+#endif
 	fread(triangles_cold, sizeof(TriangleCold), triangle_count, file);
 
+#if BVH_TRIANGLE_RECORDS && BVH_LEAF_FORMAT != BVH_LEAF_FORMAT_COMPRESSED
+	triangle_records = Util::aligned_malloc<TriangleRecord>(triangle_count, CACHE_LINE_WIDTH);
+	fread(triangle_records, sizeof(TriangleRecord), triangle_count, file);
+#endif
+
 	fread(&node_count, sizeof(int), 1, file);
 
 	fread(nodes, sizeof(BVHNode), node_count, file);
 
 	fread(&index_count, sizeof(int), 1, file);
 	
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+	compressed_triangles = Util::aligned_malloc<CompressedTriangle>(index_count, CACHE_LINE_WIDTH);
+	fread(compressed_triangles, sizeof(CompressedTriangle), index_count, file);
+
+	fread(&compressed_leaf_count, sizeof(int), 1, file);
+	compressed_leaves = Util::aligned_malloc<CompressedLeaf>(compressed_leaf_count, CACHE_LINE_WIDTH);
+	fread(compressed_leaves, sizeof(CompressedLeaf), compressed_leaf_count, file);
+
+	fread(&compressed_vertex_count, sizeof(int), 1, file);
+	compressed_vertices = Util::aligned_malloc<CompressedVertex>(compressed_vertex_count, CACHE_LINE_WIDTH);
+	fread(compressed_vertices, sizeof(CompressedVertex), compressed_vertex_count, file);
+#else
 	indices = new int[index_count];
 	fread(indices, sizeof(int), index_count, file);
+#endif
 
 	fclose(file);
 }
 
 // Flattens the Triangle arrays out, so that the indices array is no longer required to index the Triangle array
 // This means more memory consumption but is better for the cache and improves frame times slightly
-void BottomLevelBVH::flatten() {
+template<int L>
+void BottomLevelBVH<L>::flatten() {
 	TriangleHot  * flat_triangles_hot  = new TriangleHot [index_count];
 	TriangleCold * flat_triangles_cold = new TriangleCold[index_count];
 
@@ -202,6 +417,17 @@ void BottomLevelBVH::flatten() {
 		flat_triangles_cold[i] = triangles_cold[indices[i]];
 	}
 
+	if (triangle_records) {
+		TriangleRecord * flat_triangle_records = Util::aligned_malloc<TriangleRecord>(index_count, CACHE_LINE_WIDTH);
+
+		for (int i = 0; i < index_count; i++) {
+			flat_triangle_records[i] = triangle_records[indices[i]];
+		}
+
+		Util::aligned_free(triangle_records);
+		triangle_records = flat_triangle_records;
+	}
+
 	delete [] indices;
 
 	Util::aligned_free(triangles_hot);
@@ -211,227 +437,1280 @@ void BottomLevelBVH::flatten() {
 	triangles_cold = flat_triangles_cold;
 }
 
-void BottomLevelBVH::triangle_trace(int index, const Ray & ray, RayHit & ray_hit, const Matrix4 & world) const {
-	const SIMD_float zero(0.0f);
-	const SIMD_float one (1.0f);
-	
-	SIMD_Vector3 edge_1(triangles_hot[index].position_edge_1);
-	SIMD_Vector3 edge_2(triangles_hot[index].position_edge_2);
+#if BVH_HYBRID_TRAVERSAL
+// Fills the given wide Node with the children of the given binary Node. As long as there is room, the internal child
+// with the largest surface area is replaced by its own two children, so that every wide Node covers as much of the tree as possible
+template<int L>
+static void collapse(const BVHNode nodes[], int node_index, WideBVHNode<L> wide_nodes[], int wide_node_index, int & wide_node_count) {
+	const BVHNode & node = nodes[node_index];
 
-	SIMD_Vector3 h = SIMD_Vector3::cross(ray.direction, edge_2);
-	SIMD_float   a = SIMD_Vector3::dot(edge_1, h);
+	int children[L];
+	int child_count;
 
-	SIMD_float   f = SIMD_float::rcp(a);
-	SIMD_Vector3 s = ray.origin - SIMD_Vector3(triangles_hot[index].position_0);
-	SIMD_float   u = f * SIMD_Vector3::dot(s, h);
+	if (node.is_leaf()) {
+		children[0] = node_index;
+		child_count = 1;
+	} else {
+		children[0] = node.left;
+		children[1] = node.left + 1;
+		child_count = 2;
+	}
 
-	// If the barycentric coordinate on the edge between vertices i and i+1 
-	// is outside the interval [0, 1] we know no intersection is possible
-	SIMD_float mask = (u > zero) & (u < one);
-	if (SIMD_float::all_false(mask)) return;
+	while (child_count < L) {
+		int   largest      = INVALID;
+		float largest_area = -INFINITY;
 
-	SIMD_Vector3 q = SIMD_Vector3::cross(s, edge_1);
-	SIMD_float   v = f * SIMD_Vector3::dot(ray.direction, q);
+		for (int i = 0; i < child_count; i++) {
+			const BVHNode & child = nodes[children[i]];
 
-	// If the barycentric coordinate on the edge between vertices i and i+2 
-	// is outside the interval [0, 1] we know no intersection is possible
-	mask = mask & (v       > zero);
-	mask = mask & ((u + v) < one);
-	if (SIMD_float::all_false(mask)) return;
+			if (!child.is_leaf() && child.aabb.surface_area() > largest_area) {
+				largest      = i;
+				largest_area = child.aabb.surface_area();
+			}
+		}
 
-	SIMD_float t = f * SIMD_Vector3::dot(edge_2, q);
+		if (largest == INVALID) break;
 
-	// Check if we are in the right distance range
-	mask = mask & (t > Ray::EPSILON);
-	mask = mask & (t < ray_hit.distance);
+		int left = nodes[children[largest]].left;
 
-	int int_mask = SIMD_float::mask(mask);
-	if (int_mask == 0x0) return;
-		
-	ray_hit.hit      = ray_hit.hit | mask;
-	ray_hit.distance = SIMD_float::blend(ray_hit.distance, t, mask);
+		children[largest]       = left;
+		children[child_count++] = left + 1;
+	}
 
-	SIMD_Vector3 n_edge_1 = SIMD_Vector3(triangles_cold[index].normal_edge_1);
-	SIMD_Vector3 n_edge_2 = SIMD_Vector3(triangles_cold[index].normal_edge_2);
+	WideBVHNode<L> & wide_node = wide_nodes[wide_node_index];
+	wide_node.child_count = child_count;
 
-	SIMD_Vector3 n = Math::barycentric(SIMD_Vector3(triangles_cold[index].normal_0), n_edge_1, n_edge_2, u, v);
+	for (int i = 0; i < L; i++) {
+		AABB aabb = i < child_count ? nodes[children[i]].aabb : AABB::create_empty();
 
-	SIMD_Vector3 point  = Matrix4::transform_position(world, ray.origin + ray.direction * t);
-	SIMD_Vector3 normal = Matrix4::transform_direction(world, SIMD_Vector3::normalize(n));
+		set_lane(wide_node.aabb_min, i, aabb.min);
+		set_lane(wide_node.aabb_max, i, aabb.max);
+	}
 
-	ray_hit.point  = SIMD_Vector3::blend(ray_hit.point,  point,  mask);
-	ray_hit.normal = SIMD_Vector3::blend(ray_hit.normal, normal, mask);
-	
-	ray_hit.material_id = SIMD_int::blend(ray_hit.material_id, SIMD_int(material_offset + triangles_cold[index].material_id), SIMD_float_as_int(mask));
+	for (int i = 0; i < child_count; i++) {
+		if (nodes[children[i]].is_leaf()) {
+			wide_node.children[i] = ~children[i];
+		} else {
+			int index = wide_node_count++;
+			wide_node.children[i] = index;
 
-	// Obtain u,v by barycentric interpolation of the texture coordinates of the three current vertices
-	SIMD_Vector2 t_edge_1(triangles_cold[index].tex_coord_edge_1);
-	SIMD_Vector2 t_edge_2(triangles_cold[index].tex_coord_edge_2);
+			collapse(nodes, children[i], wide_nodes, index, wide_node_count);
+		}
+	}
+}
 
-	SIMD_Vector2 tex_coords = Math::barycentric(SIMD_Vector2(triangles_cold[index].tex_coord_0), t_edge_1, t_edge_2, u, v);
-	ray_hit.u = SIMD_float::blend(ray_hit.u, tex_coords.x, mask);
-	ray_hit.v = SIMD_float::blend(ray_hit.v, tex_coords.y, mask);
-	
-#if RAY_DIFFERENTIALS_ENABLED
-	// Formulae from Chapter 20 of Ray Tracing Gems "Texture Level of Detail Strategies for Real-Time Ray Tracing"
-	SIMD_float one_over_k = SIMD_float(1.0f) / SIMD_Vector3::dot(SIMD_Vector3::cross(edge_1, edge_2), ray.direction); 
+// Every wide Node replaces at least one internal Node of the binary BVH, so the binary Node count is an upper bound
+template<int L>
+void BottomLevelBVH<L>::build_wide_bvh() {
+	wide_nodes = Util::aligned_malloc<WideBVHNode<L>>(node_count, CACHE_LINE_WIDTH);
 
-	SIMD_Vector3 _q = SIMD_Vector3::madd(ray.dD_dx, t, ray.dO_dx);
-	SIMD_Vector3 _r = SIMD_Vector3::madd(ray.dD_dy, t, ray.dO_dy);
+	wide_node_count = 1;
+	collapse(nodes, 0, wide_nodes, 0, wide_node_count);
 
-	SIMD_Vector3 c_u = SIMD_Vector3::cross(edge_2, ray.direction);
-	SIMD_Vector3 c_v = SIMD_Vector3::cross(ray.direction, edge_1);
+	assert(wide_node_count <= node_count);
+}
+#endif
 
-	SIMD_float du_dx = one_over_k * SIMD_Vector3::dot(c_u, _q);
-	SIMD_float du_dy = one_over_k * SIMD_Vector3::dot(c_u, _r);
-	SIMD_float dv_dx = one_over_k * SIMD_Vector3::dot(c_v, _q);
-	SIMD_float dv_dy = one_over_k * SIMD_Vector3::dot(c_v, _r);
-	
-	ray_hit.dO_dx = SIMD_Vector3::blend(ray_hit.dO_dx, du_dx * edge_1 + dv_dx * edge_2, mask);
-	ray_hit.dO_dy = SIMD_Vector3::blend(ray_hit.dO_dy, du_dy * edge_1 + dv_dy * edge_2, mask);
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+// Stores the positions of the given Triangles as vertices that are quantized against the bounds of their leaf and deduplicated within the leaf.
+// Leaf Nodes are changed to index the leaf array instead of the Triangle arrays. The cold Triangle data is kept at full precision
+template<int L>
+void BottomLevelBVH<L>::compress(const Triangle * triangles) {
+	std::vector<CompressedLeaf>   leaves;
+	std::vector<CompressedVertex> vertices;
 
-	// Calculate derivative of the non-normalized vector n
-	SIMD_Vector3 dn_dx = du_dx * n_edge_1 + dv_dx * n_edge_2;
-	SIMD_Vector3 dn_dy = du_dy * n_edge_1 + dv_dy * n_edge_2;
+	compressed_triangles = Util::aligned_malloc<CompressedTriangle>(index_count, CACHE_LINE_WIDTH);
 
-	// Calculate derivative of the normalized vector N
-	SIMD_float n_dot_n = SIMD_Vector3::dot(n, n);
-	SIMD_float N_denom = SIMD_float::inv_sqrt(n_dot_n) / n_dot_n;
+	// Maps a quantized position to its vertex index within the current leaf
+	std::unordered_map<unsigned long long, int> vertex_map;
 
-	ray_hit.dN_dx = SIMD_Vector3::blend(ray_hit.dN_dx, (n_dot_n * dn_dx - SIMD_Vector3::dot(n, dn_dx) * n) * N_denom, mask);
-	ray_hit.dN_dy = SIMD_Vector3::blend(ray_hit.dN_dy, (n_dot_n * dn_dy - SIMD_Vector3::dot(n, dn_dy) * n) * N_denom, mask);
+	int stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
 
-	ray_hit.ds_dx = SIMD_float::blend(ray_hit.ds_dx, du_dx * t_edge_1.x + dv_dx * t_edge_2.x, mask);
-	ray_hit.ds_dy = SIMD_float::blend(ray_hit.ds_dy, du_dy * t_edge_1.x + dv_dy * t_edge_2.x, mask);
-	ray_hit.dt_dx = SIMD_float::blend(ray_hit.dt_dx, du_dx * t_edge_1.y + dv_dx * t_edge_2.y, mask);
-	ray_hit.dt_dy = SIMD_float::blend(ray_hit.dt_dy, du_dy * t_edge_1.y + dv_dy * t_edge_2.y, mask);
-#endif
-}
+	// Push root on stack
+	stack[0] = 0;
 
-SIMD_float BottomLevelBVH::triangle_intersect(int index, const Ray & ray, SIMD_float max_distance) const {
-	const SIMD_float zero(0.0f);
-	const SIMD_float one (1.0f);
+	while (stack_size > 0) {
+		BVHNode & node = nodes[stack[--stack_size]];
 
-	SIMD_Vector3 edge_0(triangles_hot[index].position_edge_1);
-	SIMD_Vector3 edge_1(triangles_hot[index].position_edge_2);
+		if (!node.is_leaf()) {
+			stack[stack_size++] = node.left;
+			stack[stack_size++] = node.left + 1;
 
-	SIMD_Vector3 h = SIMD_Vector3::cross(ray.direction, edge_1);
-	SIMD_float   a = SIMD_Vector3::dot(edge_0, h);
+			continue;
+		}
 
-	SIMD_float   f = SIMD_float::rcp(a);
-	SIMD_Vector3 s = ray.origin - SIMD_Vector3(triangles_hot[index].position_0);
-	SIMD_float   u = f * SIMD_Vector3::dot(s, h);
+		// Calculate bounds over the vertices of all Triangles in the leaf.
+		// Note that this is not the same as the AABB of the Node, which can be clipped by spatial splits
+		AABB bounds = AABB::create_empty();
 
-	// If the barycentric coordinate on the edge between vertices i and i+1 
-	// is outside the interval [0, 1] we know no intersection is possible
-	SIMD_float mask = (u > zero) & (u < one);
-	if (SIMD_float::all_false(mask)) return mask;
+		for (int i = node.first; i < node.first + node.count; i++) {
+			const Triangle & triangle = triangles[indices[i]];
 
-	SIMD_Vector3 q = SIMD_Vector3::cross(s, edge_0);
-	SIMD_float   v = f * SIMD_Vector3::dot(ray.direction, q);
+			bounds.expand(triangle.position_0);
+			bounds.expand(triangle.position_1);
+			bounds.expand(triangle.position_2);
+		}
 
-	// If the barycentric coordinate on the edge between vertices i and i+2 
-	// is outside the interval [0, 1] we know no intersection is possible
-	mask = mask & (v       > zero);
-	mask = mask & ((u + v) < one);
-	if (SIMD_float::all_false(mask)) return mask;
+		const float max_offset = 65535.0f;
 
-	SIMD_float t = f * SIMD_Vector3::dot(edge_1, q);
+		Vector3 extent = bounds.max - bounds.min;
+		Vector3 inv_scale(
+			extent.x > 0.0f ? max_offset / extent.x : 0.0f,
+			extent.y > 0.0f ? max_offset / extent.y : 0.0f,
+			extent.z > 0.0f ? max_offset / extent.z : 0.0f
+		);
 
-	// Check if we are in the right distance range
-	mask = mask & (t > Ray::EPSILON);
-	mask = mask & (t < max_distance);
+		CompressedLeaf leaf;
+		leaf.origin = bounds.min;
+		leaf.scale  = extent / max_offset;
+		leaf.first_vertex   = vertices.size();
+		leaf.first_triangle = node.first;
 
-	return mask;
-}
+		vertex_map.clear();
 
-// Possible hints:
-// _MM_HINT_NTA - non-temporal
-// _MM_HINT_T0  - L1, L2, and L3 cache
-// _MM_HINT_T1  -     L2, and L3 cache
-// _MM_HINT_T2  -             L3 cache
-#define PREFETCH_HINT _MM_HINT_T0
+		for (int i = node.first; i < node.first + node.count; i++) {
+			const Triangle & triangle = triangles[indices[i]];
 
-void BottomLevelBVH::trace(const Ray & ray, RayHit & ray_hit, const Matrix4 & world) const {
-	int stack[BVH_TRAVERSAL_STACK_SIZE];
-	int stack_size = 1;
+			Vector3 positions[3] = {
+				triangle.position_0,
+				triangle.position_1,
+				triangle.position_2
+			};
 
-	// Push root on stack
-	stack[0] = 0;
+			unsigned short vertex_indices[3];
 
-	int steps = 0;
+			for (int v = 0; v < 3; v++) {
+				Vector3 offset = (positions[v] - leaf.origin) * inv_scale;
 
-	SIMD_Vector3 inv_direction = SIMD_Vector3::rcp(ray.direction);
+				CompressedVertex vertex;
+				vertex.x = Math::clamp(Util::float_to_int(offset.x), 0, 65535);
+				vertex.y = Math::clamp(Util::float_to_int(offset.y), 0, 65535);
+				vertex.z = Math::clamp(Util::float_to_int(offset.z), 0, 65535);
 
-	while (stack_size > 0) {
-		// Pop Node of the stack
-		const BVHNode & node = nodes[stack[--stack_size]];
+				unsigned long long key = 
+					 (unsigned long long)vertex.x | 
+					((unsigned long long)vertex.y << 16) |
+					((unsigned long long)vertex.z << 32);
 
-		SIMD_float mask = node.aabb.intersect(ray, inv_direction, ray_hit.distance);
-		if (SIMD_float::all_false(mask)) continue;
+				auto vertex_index = vertex_map.find(key);
+				if (vertex_index == vertex_map.end()) {
+					int new_vertex_index = vertices.size() - leaf.first_vertex;
 
-		if (node.is_leaf()) {
-			for (int i = node.first; i < node.first + node.count; i++) {
-				triangle_trace(i, ray, ray_hit, world);
-			}
-		} else {
-			// Prefetch the cacheline containing the children of the current Node
-			_mm_prefetch(reinterpret_cast<const char *>(nodes + node.left), PREFETCH_HINT);
+					if (new_vertex_index > 65535) {
+						printf("Too many unique vertices in a single BVH leaf to compress!\n");
 
-			if (node.should_visit_left_first(ray)) {
-				stack[stack_size++] = node.left + 1;
-				stack[stack_size++] = node.left;
-			} else {
-				stack[stack_size++] = node.left;
-				stack[stack_size++] = node.left + 1;
+						abort();
+					}
+
+					vertex_index = vertex_map.insert({ key, new_vertex_index }).first;
+
+					vertices.push_back(vertex);
+				}
+
+				vertex_indices[v] = vertex_index->second;
 			}
+
+			compressed_triangles[i].vertex_0 = vertex_indices[0];
+			compressed_triangles[i].vertex_1 = vertex_indices[1];
+			compressed_triangles[i].vertex_2 = vertex_indices[2];
+			compressed_triangles[i].index = indices[i];
+			compressed_triangles[i].leaf  = leaves.size();
 		}
 
-		steps++;
+		node.first = leaves.size();
+		leaves.push_back(leaf);
 	}
-	
-#if BVH_VISUALIZE_HEATMAP
-	ray_hit.bvh_steps += steps;
-#endif
+
+	compressed_leaf_count   = leaves.size();
+	compressed_vertex_count = vertices.size();
+
+	compressed_leaves   = Util::aligned_malloc<CompressedLeaf>  (compressed_leaf_count,   CACHE_LINE_WIDTH);
+	compressed_vertices = Util::aligned_malloc<CompressedVertex>(compressed_vertex_count, CACHE_LINE_WIDTH);
+
+	memcpy(compressed_leaves,   leaves.data(),   compressed_leaf_count   * sizeof(CompressedLeaf));
+	memcpy(compressed_vertices, vertices.data(), compressed_vertex_count * sizeof(CompressedVertex));
+
+	size_t size_flat       = size_t(index_count) * (sizeof(TriangleHot) + sizeof(TriangleCold));
+	size_t size_compressed = 
+		size_t(compressed_leaf_count)   * sizeof(CompressedLeaf) + 
+		size_t(compressed_vertex_count) * sizeof(CompressedVertex) + 
+		size_t(index_count)             * sizeof(CompressedTriangle) + 
+		size_t(triangle_count)          * sizeof(TriangleCold);
+
+	printf("Compressed %i BVH leaves, %i unique vertices. Triangle data takes %zu KB instead of %zu KB\n", compressed_leaf_count, compressed_vertex_count, size_compressed / 1024, size_flat / 1024);
+
+	// The cold data remains indexed by the original Triangle index
+	delete [] indices;
+	indices = nullptr;
+}
+
+template<int L>
+typename BottomLevelBVH<L>::TriangleHot BottomLevelBVH<L>::decompress(const CompressedLeaf & leaf, int index) const {
+	const CompressedTriangle & triangle = compressed_triangles[index];
+
+	const CompressedVertex & vertex_0 = compressed_vertices[leaf.first_vertex + triangle.vertex_0];
+	const CompressedVertex & vertex_1 = compressed_vertices[leaf.first_vertex + triangle.vertex_1];
+	const CompressedVertex & vertex_2 = compressed_vertices[leaf.first_vertex + triangle.vertex_2];
+
+	Vector3 position_0 = leaf.origin + leaf.scale * Vector3(float(vertex_0.x), float(vertex_0.y), float(vertex_0.z));
+	Vector3 position_1 = leaf.origin + leaf.scale * Vector3(float(vertex_1.x), float(vertex_1.y), float(vertex_1.z));
+	Vector3 position_2 = leaf.origin + leaf.scale * Vector3(float(vertex_2.x), float(vertex_2.y), float(vertex_2.z));
+
+	TriangleHot result;
+	result.position_0      = position_0;
+	result.position_edge_1 = position_1 - position_0;
+	result.position_edge_2 = position_2 - position_0;
+
+	return result;
 }
+#endif
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+// Flattens the Triangle arrays like flatten(), but pads every leaf to a multiple of L Triangles.
+// The positions are then also packed into groups in SoA form, such that every leaf occupies a whole number of groups
+template<int L>
+void BottomLevelBVH<L>::pack_triangle_groups() {
+	std::vector<BVHNode *> leaves;
+
+	int padded_count = 0;
 
-SIMD_float BottomLevelBVH::intersect(const Ray & ray, SIMD_float max_distance) const {
 	int stack[BVH_TRAVERSAL_STACK_SIZE];
 	int stack_size = 1;
 
 	// Push root on stack
 	stack[0] = 0;
 
-	SIMD_float hit(0.0f);
-	
-	SIMD_Vector3 inv_direction = SIMD_Vector3::rcp(ray.direction);
-
 	while (stack_size > 0) {
-		// Pop Node of the stack
-		const BVHNode & node = nodes[stack[--stack_size]];
-
-		SIMD_float mask = node.aabb.intersect(ray, inv_direction, max_distance);
-		if (SIMD_float::all_false(mask)) continue;
+		BVHNode & node = nodes[stack[--stack_size]];
 
 		if (node.is_leaf()) {
-			for (int i = node.first; i < node.first + node.count; i++) {
-				hit = hit | triangle_intersect(i, ray, max_distance);
+			leaves.push_back(&node);
 
-				if (SIMD_float::all_true(hit)) return hit;
-			}
+			padded_count += (node.count + L - 1) / L * L;
 		} else {
-			// Prefetch the cacheline containing the children of the current Node
-			_mm_prefetch(reinterpret_cast<const char *>(nodes + node.left), PREFETCH_HINT);
+			stack[stack_size++] = node.left;
+			stack[stack_size++] = node.left + 1;
+		}
+	}
 
-			if (node.should_visit_left_first(ray)) {
-				stack[stack_size++] = node.left + 1;
-				stack[stack_size++] = node.left;
-			} else {
-				stack[stack_size++] = node.left;
-				stack[stack_size++] = node.left + 1;
+	TriangleHot  * flat_triangles_hot  = new TriangleHot [padded_count];
+	TriangleCold * flat_triangles_cold = new TriangleCold[padded_count];
+
+	TriangleRecord * flat_triangle_records = triangle_records ? Util::aligned_malloc<TriangleRecord>(padded_count, CACHE_LINE_WIDTH) : nullptr;
+
+	triangle_group_count = padded_count / L;
+	triangle_groups = Util::aligned_malloc<TriangleGroup>(triangle_group_count, CACHE_LINE_WIDTH);
+
+	// Unused lanes get NaN positions, which makes every comparison in the intersection test fail
+	const SIMD_Vector3<L> nan(Vector3(NAN));
+
+	for (int i = 0; i < triangle_group_count; i++) {
+		triangle_groups[i].position_0      = nan;
+		triangle_groups[i].position_edge_1 = nan;
+		triangle_groups[i].position_edge_2 = nan;
+	}
+
+	int offset = 0;
+
+	for (int l = 0; l < int(leaves.size()); l++) {
+		BVHNode & leaf = *leaves[l];
+
+		for (int i = 0; i < leaf.count; i++) {
+			const TriangleHot & triangle = triangles_hot[indices[leaf.first + i]];
+
+			flat_triangles_hot [offset + i] = triangle;
+			flat_triangles_cold[offset + i] = triangles_cold[indices[leaf.first + i]];
+
+			if (triangle_records) {
+				flat_triangle_records[offset + i] = triangle_records[indices[leaf.first + i]];
 			}
+
+			TriangleGroup & group = triangle_groups[(offset + i) / L];
+			int             lane  =                 (offset + i) % L;
+
+			set_lane(group.position_0,      lane, triangle.position_0);
+			set_lane(group.position_edge_1, lane, triangle.position_edge_1);
+			set_lane(group.position_edge_2, lane, triangle.position_edge_2);
 		}
+
+		leaf.first = offset;
+		offset += (leaf.count + L - 1) / L * L;
 	}
 
-	return hit;
+	printf("Packed %i BVH leaves into %i Triangle groups, %i of %i lanes are used\n", int(leaves.size()), triangle_group_count, index_count, padded_count);
+
+	delete [] indices;
+
+	Util::aligned_free(triangles_hot);
+	Util::aligned_free(triangles_cold);
+
+	triangles_hot  = flat_triangles_hot;
+	triangles_cold = flat_triangles_cold;
+
+	if (triangle_records) {
+		Util::aligned_free(triangle_records);
+		triangle_records = flat_triangle_records;
+	}
+}
+#endif
+
+template<int L>
+void BottomLevelBVH<L>::triangle_trace(const TriangleHot & triangle, int index, const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+	
+	SIMD_Vector3<L> edge_1(triangle.position_edge_1);
+	SIMD_Vector3<L> edge_2(triangle.position_edge_2);
+
+	SIMD_Vector3<L> h = SIMD_Vector3<L>::cross(ray.direction, edge_2);
+	SIMD_float<L>   a = SIMD_Vector3<L>::dot(edge_1, h);
+
+	SIMD_float<L>   f = SIMD_float<L>::rcp(a);
+	SIMD_Vector3<L> s = ray.origin - SIMD_Vector3<L>(triangle.position_0);
+	SIMD_float<L>   u = f * SIMD_Vector3<L>::dot(s, h);
+
+	// If the barycentric coordinate on the edge between vertices i and i+1 
+	// is outside the interval [0, 1] we know no intersection is possible
+	SIMD_float<L> mask = (u > zero) & (u < one);
+	if (SIMD_float<L>::all_false(mask)) return;
+
+	SIMD_Vector3<L> q = SIMD_Vector3<L>::cross(s, edge_1);
+	SIMD_float<L>   v = f * SIMD_Vector3<L>::dot(ray.direction, q);
+
+	// If the barycentric coordinate on the edge between vertices i and i+2 
+	// is outside the interval [0, 1] we know no intersection is possible
+	mask = mask & (v       > zero);
+	mask = mask & ((u + v) < one);
+	if (SIMD_float<L>::all_false(mask)) return;
+
+	SIMD_float<L> t = f * SIMD_Vector3<L>::dot(edge_2, q);
+
+	// Check if we are in the right distance range
+	mask = mask & (t > SIMD_float<L>(Ray<L>::EPSILON));
+	mask = mask & (t < ray_hit.distance);
+
+	int int_mask = SIMD_float<L>::mask(mask);
+	if (int_mask == 0x0) return;
+		
+	ray_hit.hit      = ray_hit.hit | mask;
+	ray_hit.distance = SIMD_float<L>::blend(ray_hit.distance, t, mask);
+
+	// Only record which Triangle was hit, its attributes are evaluated once traversal has finished
+	ray_hit.u = SIMD_float<L>::blend(ray_hit.u, u, mask);
+	ray_hit.v = SIMD_float<L>::blend(ray_hit.v, v, mask);
+
+	ray_hit.primitive_id = SIMD_int<L>::blend(ray_hit.primitive_id, SIMD_int<L>(index),       SIMD_float_as_int(mask));
+	ray_hit.instance_id  = SIMD_int<L>::blend(ray_hit.instance_id,  SIMD_int<L>(instance_id), SIMD_float_as_int(mask));
 }
+
+template<int L>
+SIMD_float<L> BottomLevelBVH<L>::triangle_intersect(const TriangleHot & triangle, const Ray<L> & ray, SIMD_float<L> max_distance) const {
+	return Triangle::intersect(triangle.position_0, triangle.position_edge_1, triangle.position_edge_2, ray, max_distance);
+}
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+// Intersects a single lane of the Ray packet with all Triangles in the group at once, and records the closest hit in that lane
+template<int L>
+void BottomLevelBVH<L>::triangle_group_trace(const TriangleGroup & group, int first_index, const Vector3 & origin, const Vector3 & direction, int lane, RayHit<L> & ray_hit, int instance_id) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+
+	// Broadcast the Ray of the given lane to all lanes
+	SIMD_Vector3<L> origin_broadcast   (origin);
+	SIMD_Vector3<L> direction_broadcast(direction);
+
+	SIMD_Vector3<L> h = SIMD_Vector3<L>::cross(direction_broadcast, group.position_edge_2);
+	SIMD_float<L>   a = SIMD_Vector3<L>::dot(group.position_edge_1, h);
+
+	SIMD_float<L>   f = SIMD_float<L>::rcp(a);
+	SIMD_Vector3<L> s = origin_broadcast - group.position_0;
+	SIMD_float<L>   u = f * SIMD_Vector3<L>::dot(s, h);
+
+	SIMD_float<L> mask = (u > zero) & (u < one);
+	if (SIMD_float<L>::all_false(mask)) return;
+
+	SIMD_Vector3<L> q = SIMD_Vector3<L>::cross(s, group.position_edge_1);
+	SIMD_float<L>   v = f * SIMD_Vector3<L>::dot(direction_broadcast, q);
+
+	mask = mask & (v       > zero);
+	mask = mask & ((u + v) < one);
+	if (SIMD_float<L>::all_false(mask)) return;
+
+	SIMD_float<L> t = f * SIMD_Vector3<L>::dot(group.position_edge_2, q);
+
+	// Check if we are in the right distance range
+	mask = mask & (t > SIMD_float<L>(Ray<L>::EPSILON));
+	mask = mask & (t < SIMD_float<L>(ray_hit.distance[lane]));
+
+	if (SIMD_float<L>::all_false(mask)) return;
+
+	// Find the closest Triangle in the group that was hit
+	float t_closest = SIMD_float<L>::hmin(SIMD_float<L>::blend(SIMD_float<L>(INFINITY), t, mask));
+	int   closest   = _tzcnt_u32(SIMD_float<L>::mask(mask & (t == SIMD_float<L>(t_closest))));
+
+	SIMD_float<L> hit_mask = lane_mask<L>(lane);
+
+	ray_hit.hit      = ray_hit.hit | hit_mask;
+	ray_hit.distance = SIMD_float<L>::blend(ray_hit.distance, SIMD_float<L>(t_closest), hit_mask);
+
+	ray_hit.u = SIMD_float<L>::blend(ray_hit.u, SIMD_float<L>(u[closest]), hit_mask);
+	ray_hit.v = SIMD_float<L>::blend(ray_hit.v, SIMD_float<L>(v[closest]), hit_mask);
+
+	ray_hit.primitive_id = SIMD_int<L>::blend(ray_hit.primitive_id, SIMD_int<L>(first_index + closest), SIMD_float_as_int(hit_mask));
+	ray_hit.instance_id  = SIMD_int<L>::blend(ray_hit.instance_id,  SIMD_int<L>(instance_id),           SIMD_float_as_int(hit_mask));
+}
+
+// Checks if a single lane of the Ray packet intersects any Triangle in the group.
+// Returns the lane of the group that contains an occluding Triangle, or INVALID if there is none
+template<int L>
+int BottomLevelBVH<L>::triangle_group_intersect(const TriangleGroup & group, const Ray<L> & ray, int lane, float max_distance) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+
+	// Broadcast the Ray of the given lane to all lanes
+	SIMD_Vector3<L> origin   (Vector3(ray.origin.x[lane],    ray.origin.y[lane],    ray.origin.z[lane]));
+	SIMD_Vector3<L> direction(Vector3(ray.direction.x[lane], ray.direction.y[lane], ray.direction.z[lane]));
+
+	SIMD_Vector3<L> h = SIMD_Vector3<L>::cross(direction, group.position_edge_2);
+	SIMD_float<L>   a = SIMD_Vector3<L>::dot(group.position_edge_1, h);
+
+	SIMD_float<L>   f = SIMD_float<L>::rcp(a);
+	SIMD_Vector3<L> s = origin - group.position_0;
+	SIMD_float<L>   u = f * SIMD_Vector3<L>::dot(s, h);
+
+	SIMD_float<L> mask = (u > zero) & (u < one);
+	if (SIMD_float<L>::all_false(mask)) return INVALID;
+
+	SIMD_Vector3<L> q = SIMD_Vector3<L>::cross(s, group.position_edge_1);
+	SIMD_float<L>   v = f * SIMD_Vector3<L>::dot(direction, q);
+
+	mask = mask & (v       > zero);
+	mask = mask & ((u + v) < one);
+	if (SIMD_float<L>::all_false(mask)) return INVALID;
+
+	SIMD_float<L> t = f * SIMD_Vector3<L>::dot(group.position_edge_2, q);
+
+	// Check if we are in the right distance range
+	mask = mask & (t > SIMD_float<L>(Ray<L>::EPSILON));
+	mask = mask & (t < SIMD_float<L>(max_distance));
+
+	int int_mask = SIMD_float<L>::mask(mask);
+	if (int_mask == 0x0) return INVALID;
+
+	return _tzcnt_u32(int_mask);
+}
+#endif
+
+// Intersection test using the precomputed transformation of the Triangle, see: http://jcgt.org/published/0005/03/03/
+template<int L>
+void BottomLevelBVH<L>::triangle_trace(const TriangleRecord & record, int index, const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+
+	SIMD_Vector3<L> transform_t(record.transform_t);
+
+	// Distance along the Ray to the plane of the Triangle
+	SIMD_float<L> t = -(SIMD_Vector3<L>::dot(transform_t, ray.origin) + SIMD_float<L>(record.offset_t)) / SIMD_Vector3<L>::dot(transform_t, ray.direction);
+
+	// Check if we are in the right distance range
+	SIMD_float<L> mask = (t > SIMD_float<L>(Ray<L>::EPSILON)) & (t < ray_hit.distance);
+	if (SIMD_float<L>::all_false(mask)) return;
+
+	// Transform the intersection point with the plane to barycentric coordinates
+	SIMD_Vector3<L> point = SIMD_Vector3<L>::madd(ray.direction, t, ray.origin);
+
+	SIMD_float<L> u = SIMD_Vector3<L>::dot(SIMD_Vector3<L>(record.transform_u), point) + SIMD_float<L>(record.offset_u);
+	SIMD_float<L> v = SIMD_Vector3<L>::dot(SIMD_Vector3<L>(record.transform_v), point) + SIMD_float<L>(record.offset_v);
+
+	mask = mask & (u       > zero);
+	mask = mask & (v       > zero);
+	mask = mask & ((u + v) < one);
+
+	int int_mask = SIMD_float<L>::mask(mask);
+	if (int_mask == 0x0) return;
+		
+	ray_hit.hit      = ray_hit.hit | mask;
+	ray_hit.distance = SIMD_float<L>::blend(ray_hit.distance, t, mask);
+
+	// Only record which Triangle was hit, its attributes are evaluated once traversal has finished
+	ray_hit.u = SIMD_float<L>::blend(ray_hit.u, u, mask);
+	ray_hit.v = SIMD_float<L>::blend(ray_hit.v, v, mask);
+
+	ray_hit.primitive_id = SIMD_int<L>::blend(ray_hit.primitive_id, SIMD_int<L>(index),       SIMD_float_as_int(mask));
+	ray_hit.instance_id  = SIMD_int<L>::blend(ray_hit.instance_id,  SIMD_int<L>(instance_id), SIMD_float_as_int(mask));
+}
+
+template<int L>
+SIMD_float<L> BottomLevelBVH<L>::triangle_intersect(const TriangleRecord & record, const Ray<L> & ray, SIMD_float<L> max_distance) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+
+	SIMD_Vector3<L> transform_t(record.transform_t);
+
+	// Distance along the Ray to the plane of the Triangle
+	SIMD_float<L> t = -(SIMD_Vector3<L>::dot(transform_t, ray.origin) + SIMD_float<L>(record.offset_t)) / SIMD_Vector3<L>::dot(transform_t, ray.direction);
+
+	// Check if we are in the right distance range
+	SIMD_float<L> mask = (t > SIMD_float<L>(Ray<L>::EPSILON)) & (t < max_distance);
+	if (SIMD_float<L>::all_false(mask)) return mask;
+
+	// Transform the intersection point with the plane to barycentric coordinates
+	SIMD_Vector3<L> point = SIMD_Vector3<L>::madd(ray.direction, t, ray.origin);
+
+	SIMD_float<L> u = SIMD_Vector3<L>::dot(SIMD_Vector3<L>(record.transform_u), point) + SIMD_float<L>(record.offset_u);
+	SIMD_float<L> v = SIMD_Vector3<L>::dot(SIMD_Vector3<L>(record.transform_v), point) + SIMD_float<L>(record.offset_v);
+
+	mask = mask & (u       > zero);
+	mask = mask & (v       > zero);
+	mask = mask & ((u + v) < one);
+
+	return mask;
+}
+
+// Possible hints:
+// _MM_HINT_NTA - non-temporal
+// _MM_HINT_T0  - L1, L2, and L3 cache
+// _MM_HINT_T1  -     L2, and L3 cache
+// _MM_HINT_T2  -             L3 cache
+#define PREFETCH_HINT _MM_HINT_T0
+
+#if BVH_HYBRID_TRAVERSAL
+// Checks whether the active lanes of the packet are numerous and coherent enough to be traced as a packet.
+// The directions are compared to their average, without normalizing them, since Mesh transforms may scale them
+template<int L>
+static bool is_packet_coherent(const Ray<L> & ray, int active_mask) {
+	if (_mm_popcnt_u32(active_mask) < BVH_HYBRID_TRAVERSAL_MIN_LANE_FRACTION * L) return false;
+
+	Vector3 average_direction(0.0f);
+
+	for (int i = 0; i < L; i++) {
+		if (active_mask & (1 << i)) {
+			average_direction += Vector3(ray.direction.x[i], ray.direction.y[i], ray.direction.z[i]);
+		}
+	}
+
+	const SIMD_float<L> min_coherence_squared(BVH_HYBRID_TRAVERSAL_MIN_COHERENCE * BVH_HYBRID_TRAVERSAL_MIN_COHERENCE);
+
+	// cos(theta) >= min_coherence <=> dot > 0 and dot^2 >= min_coherence^2 * |direction|^2 * |average_direction|^2
+	SIMD_float<L> dot = SIMD_Vector3<L>::dot(ray.direction, SIMD_Vector3<L>(average_direction));
+
+	SIMD_float<L> coherent_mask = (dot > SIMD_float<L>(0.0f)) & (dot * dot >= min_coherence_squared * SIMD_Vector3<L>::length_squared(ray.direction) * SIMD_float<L>(Vector3::length_squared(average_direction)));
+
+	return (SIMD_float<L>::mask(coherent_mask) & active_mask) == active_mask;
+}
+#endif
+
+// Intersects the Triangles of a leaf with the lanes of the packet that hit the leaf, only the SoA format uses their mask
+template<int L>
+void BottomLevelBVH<L>::trace_leaf(const BVHNode & node, const Ray<L> & ray, [[maybe_unused]] SIMD_float<L> mask, RayHit<L> & ray_hit, int instance_id) const {
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_FLAT
+	if (triangle_records) {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			triangle_trace(triangle_records[i], i, ray, ray_hit, instance_id);
+		}
+	} else {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			triangle_trace(triangles_hot[i], i, ray, ray_hit, instance_id);
+		}
+	}
+#elif BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+	const CompressedLeaf & leaf = compressed_leaves[node.first];
+
+	for (int i = leaf.first_triangle; i < leaf.first_triangle + node.count; i++) {
+		triangle_trace(decompress(leaf, i), i, ray, ray_hit, instance_id);
+	}
+#elif BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+	int int_mask = SIMD_float<L>::mask(mask);
+
+	int first_group = node.first / L;
+	int group_count = (node.count + L - 1) / L;
+
+	// If only a few lanes of the packet reach this leaf it is cheaper to intersect them one at a time
+	// with whole groups of Triangles, than to intersect the entire packet with one Triangle at a time
+	if (_mm_popcnt_u32(int_mask) * group_count < node.count) {
+		for (int lane = 0; lane < L; lane++) {
+			if ((int_mask & (1 << lane)) == 0) continue;
+
+			Vector3 origin   (ray.origin.x[lane],    ray.origin.y[lane],    ray.origin.z[lane]);
+			Vector3 direction(ray.direction.x[lane], ray.direction.y[lane], ray.direction.z[lane]);
+
+			for (int g = first_group; g < first_group + group_count; g++) {
+				triangle_group_trace(triangle_groups[g], g * L, origin, direction, lane, ray_hit, instance_id);
+			}
+		}
+	} else if (triangle_records) {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			triangle_trace(triangle_records[i], i, ray, ray_hit, instance_id);
+		}
+	} else {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			triangle_trace(triangles_hot[i], i, ray, ray_hit, instance_id);
+		}
+	}
+#endif
+}
+
+template<int L>
+void BottomLevelBVH<L>::trace(const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const {
+#if BVH_HYBRID_TRAVERSAL
+	if constexpr (HYBRID_TRAVERSAL) {
+		// Lanes that were retired by setting their distance to zero can not hit anything
+		int active_mask = SIMD_float<L>::mask(ray_hit.distance > SIMD_float<L>(0.0f));
+		if (active_mask == 0) return;
+
+		// Incoherent packets would visit many Nodes that only a few lanes need, trace their lanes one at a time instead
+		if (!is_packet_coherent(ray, active_mask)) {
+			for (int lane = 0; lane < L; lane++) {
+				if (active_mask & (1 << lane)) {
+					trace_single(ray, lane, ray_hit, instance_id);
+				}
+			}
+
+			ray_hit.single_ray_traversals += _mm_popcnt_u32(active_mask);
+
+			return;
+		}
+
+		ray_hit.packet_traversals++;
+	}
+#endif
+
+	int stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack[0] = 0;
+
+	int steps = 0;
+
+	SIMD_Vector3<L> inv_direction = SIMD_Vector3<L>::rcp(ray.direction);
+
+	RayInterval interval(ray, inv_direction);
+
+#if BVH_PACKET_CULLING
+	float max_distance = SIMD_float<L>::hmax(ray_hit.distance);
+#endif
+
+	while (stack_size > 0) {
+		// Pop Node of the stack
+		const BVHNode & node = nodes[stack[--stack_size]];
+
+#if BVH_COUNT_NODE_FETCHES && !PRIMARY_RAY_LARGE_PACKETS
+		ray_hit.node_fetches++;
+#endif
+
+#if BVH_PACKET_CULLING
+		// Reject the Node for the entire packet at once if no lane can possibly hit it
+		if (!node.aabb.intersect(interval, max_distance)) continue;
+#endif
+
+		SIMD_float<L> mask = node.aabb.intersect(ray, inv_direction, ray_hit.distance);
+		if (SIMD_float<L>::all_false(mask)) continue;
+
+		if (node.is_leaf()) {
+			trace_leaf(node, ray, mask, ray_hit, instance_id);
+
+#if BVH_PACKET_CULLING
+			max_distance = SIMD_float<L>::hmax(ray_hit.distance);
+#endif
+		} else {
+			// Prefetch the cacheline containing the children of the current Node
+			_mm_prefetch(reinterpret_cast<const char *>(nodes + node.left), PREFETCH_HINT);
+
+			if (node.should_visit_left_first(interval)) {
+				stack[stack_size++] = node.left + 1;
+				stack[stack_size++] = node.left;
+			} else {
+				stack[stack_size++] = node.left;
+				stack[stack_size++] = node.left + 1;
+			}
+		}
+
+		steps++;
+	}
+	
+#if BVH_VISUALIZE_HEATMAP
+	ray_hit.bvh_steps += steps;
+#endif
+}
+
+template<int L>
+void BottomLevelBVH<L>::trace(const Ray<L> rays[], RayHit<L> hits[], int first, int packet_count, int instance_id, [[maybe_unused]] int & node_fetches) const {
+	typename LargeRayPacket<L>::StackEntry stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack[0] = { 0, first };
+
+	SIMD_Vector3<L> inv_directions[LargeRayPacket<L>::MAX_PACKET_COUNT];
+	for (int p = first; p < packet_count; p++) {
+		inv_directions[p] = SIMD_Vector3<L>::rcp(rays[p].direction);
+	}
+
+	RayInterval interval(rays + first, inv_directions + first, packet_count - first);
+
+	float max_distance = LargeRayPacket<L>::max_distance(hits, first, packet_count);
+
+	while (stack_size > 0) {
+		// Pop Node of the stack
+		typename LargeRayPacket<L>::StackEntry entry = stack[--stack_size];
+
+		const BVHNode & node = nodes[entry.node];
+
+#if BVH_COUNT_NODE_FETCHES
+		node_fetches++;
+#endif
+
+		// Reject the Node for all packets at once if no lane can possibly hit it
+		if (!node.aabb.intersect(interval, max_distance)) continue;
+
+		// Packets before the first one that hit the parent can not hit its children either
+		int first_active = LargeRayPacket<L>::find_first_active(node.aabb, rays, inv_directions, hits, entry.first, packet_count);
+		if (first_active == packet_count) continue;
+
+		if (node.is_leaf()) {
+			// Packets after the first active one may still miss the leaf, so they each get a slab test
+			for (int p = first_active; p < packet_count; p++) {
+				SIMD_float<L> mask = node.aabb.intersect(rays[p], inv_directions[p], hits[p].distance);
+				if (SIMD_float<L>::all_false(mask)) continue;
+
+				trace_leaf(node, rays[p], mask, hits[p], instance_id);
+			}
+
+			max_distance = LargeRayPacket<L>::max_distance(hits, first, packet_count);
+		} else {
+			// Prefetch the cacheline containing the children of the current Node
+			_mm_prefetch(reinterpret_cast<const char *>(nodes + node.left), PREFETCH_HINT);
+
+			if (node.should_visit_left_first(interval)) {
+				stack[stack_size++] = { node.left + 1, first_active };
+				stack[stack_size++] = { node.left,     first_active };
+			} else {
+				stack[stack_size++] = { node.left,     first_active };
+				stack[stack_size++] = { node.left + 1, first_active };
+			}
+		}
+	}
+}
+
+#if BVH_HYBRID_TRAVERSAL
+// Records a closer hit in a single lane of the packet
+template<int L>
+static FORCEINLINE void record_hit(RayHit<L> & ray_hit, int lane, float t, float u, float v, int index, int instance_id) {
+	ray_hit.hit = ray_hit.hit | lane_mask<L>(lane);
+
+	ray_hit.distance[lane] = t;
+
+	ray_hit.u[lane] = u;
+	ray_hit.v[lane] = v;
+
+	ray_hit.primitive_id[lane] = index;
+	ray_hit.instance_id [lane] = instance_id;
+}
+
+// Single lane versions of the Triangle tests. The comparisons are written such that NaN fails them, like it does for the packet masks
+template<int L>
+void BottomLevelBVH<L>::triangle_trace(const TriangleHot & triangle, int index, const Vector3 & origin, const Vector3 & direction, int lane, RayHit<L> & ray_hit, int instance_id) const {
+	Vector3 h = Vector3::cross(direction, triangle.position_edge_2);
+	float   a = Vector3::dot(triangle.position_edge_1, h);
+
+	float   f = 1.0f / a;
+	Vector3 s = origin - triangle.position_0;
+	float   u = f * Vector3::dot(s, h);
+
+	if (!(u > 0.0f && u < 1.0f)) return;
+
+	Vector3 q = Vector3::cross(s, triangle.position_edge_1);
+	float   v = f * Vector3::dot(direction, q);
+
+	if (!(v > 0.0f && u + v < 1.0f)) return;
+
+	float t = f * Vector3::dot(triangle.position_edge_2, q);
+
+	if (!(t > Ray<L>::EPSILON && t < ray_hit.distance[lane])) return;
+
+	record_hit(ray_hit, lane, t, u, v, index, instance_id);
+}
+
+template<int L>
+void BottomLevelBVH<L>::triangle_trace(const TriangleRecord & record, int index, const Vector3 & origin, const Vector3 & direction, int lane, RayHit<L> & ray_hit, int instance_id) const {
+	float t = -(Vector3::dot(record.transform_t, origin) + record.offset_t) / Vector3::dot(record.transform_t, direction);
+
+	if (!(t > Ray<L>::EPSILON && t < ray_hit.distance[lane])) return;
+
+	Vector3 point = origin + t * direction;
+
+	float u = Vector3::dot(record.transform_u, point) + record.offset_u;
+	float v = Vector3::dot(record.transform_v, point) + record.offset_v;
+
+	if (!(u > 0.0f && v > 0.0f && u + v < 1.0f)) return;
+
+	record_hit(ray_hit, lane, t, u, v, index, instance_id);
+}
+
+template<int L>
+void BottomLevelBVH<L>::trace_single_leaf(const BVHNode & node, const Vector3 & origin, const Vector3 & direction, int lane, RayHit<L> & ray_hit, int instance_id) const {
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_FLAT
+	if (triangle_records) {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			triangle_trace(triangle_records[i], i, origin, direction, lane, ray_hit, instance_id);
+		}
+	} else {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			triangle_trace(triangles_hot[i], i, origin, direction, lane, ray_hit, instance_id);
+		}
+	}
+#elif BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+	const CompressedLeaf & leaf = compressed_leaves[node.first];
+
+	for (int i = leaf.first_triangle; i < leaf.first_triangle + node.count; i++) {
+		triangle_trace(decompress(leaf, i), i, origin, direction, lane, ray_hit, instance_id);
+	}
+#elif BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+	int first_group = node.first / L;
+	int group_count = (node.count + L - 1) / L;
+
+	for (int g = first_group; g < first_group + group_count; g++) {
+		triangle_group_trace(triangle_groups[g], g * L, origin, direction, lane, ray_hit, instance_id);
+	}
+#endif
+}
+
+// Traces a single lane of the packet through the wide BVH. Every step tests the Ray against all children of a Node at once,
+// and the children that were hit are pushed in order of distance, so that the closest one is visited first
+template<int L>
+void BottomLevelBVH<L>::trace_single(const Ray<L> & ray, int lane, RayHit<L> & ray_hit, int instance_id) const {
+	// Every wide Node can push all but one of its children more than it pops
+	int   stack         [BVH_TRAVERSAL_STACK_SIZE * (L - 1)];
+	float stack_distance[BVH_TRAVERSAL_STACK_SIZE * (L - 1)];
+	int   stack_size = 1;
+
+	// Push root on stack
+	stack         [0] = 0;
+	stack_distance[0] = 0.0f;
+
+	Vector3 origin   (ray.origin.x[lane],    ray.origin.y[lane],    ray.origin.z[lane]);
+	Vector3 direction(ray.direction.x[lane], ray.direction.y[lane], ray.direction.z[lane]);
+
+	SIMD_Vector3<L> origin_broadcast(origin);
+	SIMD_Vector3<L> inv_direction = SIMD_Vector3<L>::rcp(SIMD_Vector3<L>(direction));
+
+	while (stack_size > 0) {
+		stack_size--;
+
+		// Skip Nodes that lie beyond the closest hit found since they were pushed
+		if (stack_distance[stack_size] >= ray_hit.distance[lane]) continue;
+
+		int index = stack[stack_size];
+
+#if BVH_COUNT_NODE_FETCHES && !PRIMARY_RAY_LARGE_PACKETS
+		ray_hit.node_fetches++;
+#endif
+
+		if (index < 0) {
+			trace_single_leaf(nodes[~index], origin, direction, lane, ray_hit, instance_id);
+
+			continue;
+		}
+
+		const WideBVHNode<L> & node = wide_nodes[index];
+
+		SIMD_Vector3<L> t0 = (node.aabb_min - origin_broadcast) * inv_direction;
+		SIMD_Vector3<L> t1 = (node.aabb_max - origin_broadcast) * inv_direction;
+
+		SIMD_Vector3<L> t_min = SIMD_Vector3<L>::min(t0, t1);
+		SIMD_Vector3<L> t_max = SIMD_Vector3<L>::max(t0, t1);
+
+		SIMD_float<L> t_near = SIMD_float<L>::max(SIMD_float<L>::max(SIMD_float<L>(Ray<L>::EPSILON), t_min.x), SIMD_float<L>::max(t_min.y, t_min.z));
+		SIMD_float<L> t_far  = SIMD_float<L>::min(SIMD_float<L>::min(SIMD_float<L>(ray_hit.distance[lane]), t_max.x), SIMD_float<L>::min(t_max.y, t_max.z));
+
+		// Lanes beyond the child count contain empty bounds, which the slab test does not reject on its own
+		int hit_mask = SIMD_float<L>::mask(t_near < t_far) & ((1 << node.child_count) - 1);
+
+		// Insertion sort on the stack, so that the closest child ends up on top
+		int first = stack_size;
+
+		while (hit_mask) {
+			int   child    = _tzcnt_u32(hit_mask);
+			float distance = t_near[child];
+
+			int i = stack_size++;
+			while (i > first && stack_distance[i - 1] < distance) {
+				stack         [i] = stack         [i - 1];
+				stack_distance[i] = stack_distance[i - 1];
+				i--;
+			}
+
+			stack         [i] = node.children[child];
+			stack_distance[i] = distance;
+
+			hit_mask &= hit_mask - 1;
+		}
+	}
+}
+#endif
+
+// Intersects the Ray packet with all Triangles in the leaf, and returns the given hit mask extended with the newly occluded lanes.
+// Only the SoA format uses the mask of lanes that reached the leaf
+template<int L>
+SIMD_float<L> BottomLevelBVH<L>::intersect_leaf(const BVHNode & node, const Ray<L> & ray, [[maybe_unused]] SIMD_float<L> mask, SIMD_float<L> max_distance, SIMD_float<L> hit, Occluder & occluder) const {
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_FLAT
+	if (triangle_records) {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			SIMD_float<L> triangle_hit = triangle_intersect(triangle_records[i], ray, max_distance);
+			if (SIMD_float<L>::all_false(triangle_hit)) continue;
+
+			hit = hit | triangle_hit;
+			record_occluder(occluder, triangles_hot[i]);
+
+			if (SIMD_float<L>::all_true(hit)) return hit;
+		}
+	} else {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			SIMD_float<L> triangle_hit = triangle_intersect(triangles_hot[i], ray, max_distance);
+			if (SIMD_float<L>::all_false(triangle_hit)) continue;
+
+			hit = hit | triangle_hit;
+			record_occluder(occluder, triangles_hot[i]);
+
+			if (SIMD_float<L>::all_true(hit)) return hit;
+		}
+	}
+#elif BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+	const CompressedLeaf & leaf = compressed_leaves[node.first];
+
+	for (int i = leaf.first_triangle; i < leaf.first_triangle + node.count; i++) {
+		TriangleHot triangle = decompress(leaf, i);
+
+		SIMD_float<L> triangle_hit = triangle_intersect(triangle, ray, max_distance);
+		if (SIMD_float<L>::all_false(triangle_hit)) continue;
+
+		hit = hit | triangle_hit;
+		record_occluder(occluder, triangle);
+
+		if (SIMD_float<L>::all_true(hit)) return hit;
+	}
+#elif BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+	// Lanes that are already occluded don't need to be tested again
+	int int_mask = SIMD_float<L>::mask(SIMD_float<L>::andnot(hit, mask));
+
+	int first_group = node.first / L;
+	int group_count = (node.count + L - 1) / L;
+
+	// If only a few lanes of the packet reach this leaf it is cheaper to intersect them one at a time
+	// with whole groups of Triangles, than to intersect the entire packet with one Triangle at a time
+	if (_mm_popcnt_u32(int_mask) * group_count < node.count) {
+		for (int lane = 0; lane < L; lane++) {
+			if ((int_mask & (1 << lane)) == 0) continue;
+
+			for (int g = first_group; g < first_group + group_count; g++) {
+				int occluding_lane = triangle_group_intersect(triangle_groups[g], ray, lane, max_distance[lane]);
+				if (occluding_lane != INVALID) {
+					hit = hit | lane_mask<L>(lane);
+					record_occluder(occluder, triangles_hot[g * L + occluding_lane]);
+
+					break;
+				}
+			}
+		}
+
+		if (SIMD_float<L>::all_true(hit)) return hit;
+	} else if (triangle_records) {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			SIMD_float<L> triangle_hit = triangle_intersect(triangle_records[i], ray, max_distance);
+			if (SIMD_float<L>::all_false(triangle_hit)) continue;
+
+			hit = hit | triangle_hit;
+			record_occluder(occluder, triangles_hot[i]);
+
+			if (SIMD_float<L>::all_true(hit)) return hit;
+		}
+	} else {
+		for (int i = node.first; i < node.first + node.count; i++) {
+			SIMD_float<L> triangle_hit = triangle_intersect(triangles_hot[i], ray, max_distance);
+			if (SIMD_float<L>::all_false(triangle_hit)) continue;
+
+			hit = hit | triangle_hit;
+			record_occluder(occluder, triangles_hot[i]);
+
+			if (SIMD_float<L>::all_true(hit)) return hit;
+		}
+	}
+#endif
+
+	return hit;
+}
+
+template<int L>
+SIMD_float<L> BottomLevelBVH<L>::intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const {
+	// Meshes that opted into a Shadow BVH use it for all occlusion queries
+	if (shadow_bvh) return shadow_bvh->intersect(ray, max_distance, occluder);
+
+	int stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack[0] = 0;
+
+	const SIMD_float<L> zero(0.0f);
+
+	SIMD_float<L> hit(0.0f);
+	
+	SIMD_Vector3<L> inv_direction = SIMD_Vector3<L>::rcp(ray.direction);
+
+	RayInterval interval(ray, inv_direction);
+
+#if BVH_PACKET_CULLING
+	const float packet_max_distance = SIMD_float<L>::hmax(max_distance);
+#endif
+
+	while (stack_size > 0) {
+		// Pop Node of the stack
+		const BVHNode & node = nodes[stack[--stack_size]];
+
+#if BVH_PACKET_CULLING
+		// Reject the Node for the entire packet at once if no lane can possibly hit it
+		if (!node.aabb.intersect(interval, packet_max_distance)) continue;
+#endif
+
+		SIMD_float<L> mask = node.aabb.intersect(ray, inv_direction, max_distance);
+		if (SIMD_float<L>::all_false(mask)) continue;
+
+		if (node.is_leaf()) {
+			hit = intersect_leaf(node, ray, mask, max_distance, hit, occluder);
+
+			if (SIMD_float<L>::all_true(hit)) return hit;
+
+			// Lanes that are occluded are retired, they can no longer pass any AABB test
+			max_distance = SIMD_float<L>::blend(max_distance, zero, hit);
+		} else {
+			// Prefetch the cacheline containing the children of the current Node
+			_mm_prefetch(reinterpret_cast<const char *>(nodes + node.left), PREFETCH_HINT);
+
+			if (node.should_visit_left_first_occlusion()) {
+				stack[stack_size++] = node.left + 1;
+				stack[stack_size++] = node.left;
+			} else {
+				stack[stack_size++] = node.left;
+				stack[stack_size++] = node.left + 1;
+			}
+		}
+	}
+
+	return hit;
+}
+
+template<int L>
+void BottomLevelBVH<L>::intersect(const Ray<L> rays[], ShadowRayBatch<L> & batch, int lights, int instance_id) const {
+	// Meshes that opted into a Shadow BVH trace the Lights one at a time
+	if (shadow_bvh) {
+		for (int l = 0; l < batch.size; l++) {
+			if ((lights & batch.active_mask & (1 << l)) == 0) continue;
+
+			SIMD_float<L> hit = shadow_bvh->intersect(rays[l], batch.max_distance[l], *batch.occluders[l]);
+			if (SIMD_float<L>::all_false(hit)) continue;
+
+			batch.occluders[l]->instance_id = instance_id;
+			batch.occlude(l, hit);
+		}
+
+		return;
+	}
+
+	// Every stack entry also stores the mask of the Lights that reached the parent of the Node
+	int stack       [BVH_TRAVERSAL_STACK_SIZE];
+	int stack_lights[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack       [0] = 0;
+	stack_lights[0] = lights;
+
+	SIMD_Vector3<L> inv_direction[SHADOW_RAY_BATCH_SIZE];
+	RayInterval     interval     [SHADOW_RAY_BATCH_SIZE];
+
+	for (int l = 0; l < batch.size; l++) {
+		if ((lights & (1 << l)) == 0) continue;
+
+		inv_direction[l] = SIMD_Vector3<L>::rcp(rays[l].direction);
+		interval     [l] = RayInterval(rays[l], inv_direction[l]);
+	}
+
+	SIMD_float<L> masks[SHADOW_RAY_BATCH_SIZE];
+
+	while (stack_size > 0) {
+		// Pop Node of the stack
+		stack_size--;
+
+		const BVHNode & node = nodes[stack[stack_size]];
+
+		// Lights that became fully occluded since the Node was pushed no longer need to be tested
+		int parent_lights = stack_lights[stack_size] & batch.active_mask;
+		if (parent_lights == 0) continue;
+
+		// Determine which of the remaining Lights reach this Node
+		int node_lights = 0;
+
+		for (int remaining_lights = parent_lights; remaining_lights != 0; remaining_lights &= remaining_lights - 1) {
+			int l = _tzcnt_u32(remaining_lights);
+
+#if BVH_PACKET_CULLING
+			if (!node.aabb.intersect(interval[l], SIMD_float<L>::hmax(batch.max_distance[l]))) continue;
+#endif
+
+			masks[l] = node.aabb.intersect(rays[l], inv_direction[l], batch.max_distance[l]);
+
+			if (!SIMD_float<L>::all_false(masks[l])) node_lights |= 1 << l;
+		}
+
+		if (node_lights == 0) continue;
+
+		if (node.is_leaf()) {
+			for (int remaining_lights = node_lights; remaining_lights != 0; remaining_lights &= remaining_lights - 1) {
+				int l = _tzcnt_u32(remaining_lights);
+
+				SIMD_float<L> hit = intersect_leaf(node, rays[l], masks[l], batch.max_distance[l], batch.occluded[l], *batch.occluders[l]);
+
+				// Only update the Occluder if this leaf actually occluded some new lanes
+				if (SIMD_float<L>::mask(hit) != SIMD_float<L>::mask(batch.occluded[l])) {
+					batch.occluders[l]->instance_id = instance_id;
+					batch.occlude(l, hit);
+				}
+			}
+
+			if (batch.active_mask == 0) return;
+		} else {
+			// Prefetch the cacheline containing the children of the current Node
+			_mm_prefetch(reinterpret_cast<const char *>(nodes + node.left), PREFETCH_HINT);
+
+			// The child with the larger surface area is visited first, see BVH_LARGEST_LEFT_BIT
+			if (node.should_visit_left_first_occlusion()) {
+				stack       [stack_size]   = node.left + 1;
+				stack_lights[stack_size++] = node_lights;
+				stack       [stack_size]   = node.left;
+				stack_lights[stack_size++] = node_lights;
+			} else {
+				stack       [stack_size]   = node.left;
+				stack_lights[stack_size++] = node_lights;
+				stack       [stack_size]   = node.left + 1;
+				stack_lights[stack_size++] = node_lights;
+			}
+		}
+	}
+}
+
+// Evaluates the shading attributes of the Triangles hit by the lanes in the mask, as recorded by trace()
+template<int L>
+template<bool PROPAGATE_DIFFERENTIALS>
+void BottomLevelBVH<L>::evaluate(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes, const Matrix4 & world) const {
+	SIMD_int<L> triangle_ids = ray_hit.primitive_id;
+
+	SIMD_Vector3<L> n_0, n_edge_1, n_edge_2;
+	SIMD_Vector2<L> t_0, t_edge_1, t_edge_2;
+
+	SIMD_int<L> material_id;
+
+#if RAY_DIFFERENTIALS_ENABLED
+	SIMD_Vector3<L> edge_1, edge_2;
+#endif
+
+	int int_mask = SIMD_float<L>::mask(mask);
+
+	// Every lane can have hit a different Triangle, gather their data into SIMD registers
+	for (int i = 0; i < L; i++) {
+		if ((int_mask & (1 << i)) == 0) continue;
+
+		int index = triangle_ids[i];
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_FLAT || BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+		const TriangleHot  & triangle_hot  = triangles_hot [index];
+		const TriangleCold & triangle_cold = triangles_cold[index];
+#elif BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+		const TriangleHot    triangle_hot  = decompress(compressed_leaves[compressed_triangles[index].leaf], index);
+		const TriangleCold & triangle_cold = triangles_cold[compressed_triangles[index].index];
+#endif
+
+		set_lane(n_0,      i, triangle_cold.normal_0);
+		set_lane(n_edge_1, i, triangle_cold.normal_edge_1);
+		set_lane(n_edge_2, i, triangle_cold.normal_edge_2);
+
+		set_lane(t_0,      i, triangle_cold.tex_coord_0);
+		set_lane(t_edge_1, i, triangle_cold.tex_coord_edge_1);
+		set_lane(t_edge_2, i, triangle_cold.tex_coord_edge_2);
+
+		material_id[i] = material_offset + triangle_cold.material_id;
+
+#if RAY_DIFFERENTIALS_ENABLED
+		set_lane(edge_1, i, triangle_hot.position_edge_1);
+		set_lane(edge_2, i, triangle_hot.position_edge_2);
+#endif
+	}
+
+	SIMD_float<L> t = ray_hit.distance;
+	SIMD_float<L> u = ray_hit.u;
+	SIMD_float<L> v = ray_hit.v;
+
+	SIMD_Vector3<L> n = Math::barycentric(n_0, n_edge_1, n_edge_2, u, v);
+
+	SIMD_Vector3<L> point  = Matrix4::transform_position(world, ray.origin + ray.direction * t);
+	SIMD_Vector3<L> normal = Matrix4::transform_direction(world, SIMD_Vector3<L>::normalize(n));
+
+	attributes.point  = SIMD_Vector3<L>::blend(attributes.point,  point,  mask);
+	attributes.normal = SIMD_Vector3<L>::blend(attributes.normal, normal, mask);
+	
+	attributes.material_id = SIMD_int<L>::blend(attributes.material_id, material_id, SIMD_float_as_int(mask));
+
+	// Obtain u,v by barycentric interpolation of the texture coordinates of the three current vertices
+	SIMD_Vector2<L> tex_coords = Math::barycentric(t_0, t_edge_1, t_edge_2, u, v);
+	attributes.u = SIMD_float<L>::blend(attributes.u, tex_coords.x, mask);
+	attributes.v = SIMD_float<L>::blend(attributes.v, tex_coords.y, mask);
+	
+#if RAY_DIFFERENTIALS_ENABLED
+	// Formulae from Chapter 20 of Ray Tracing Gems "Texture Level of Detail Strategies for Real-Time Ray Tracing"
+	SIMD_float<L> one_over_k = SIMD_float<L>(1.0f) / SIMD_Vector3<L>::dot(SIMD_Vector3<L>::cross(edge_1, edge_2), ray.direction); 
+
+	SIMD_Vector3<L> _q = SIMD_Vector3<L>::madd(ray.dD_dx, t, ray.dO_dx);
+	SIMD_Vector3<L> _r = SIMD_Vector3<L>::madd(ray.dD_dy, t, ray.dO_dy);
+
+	SIMD_Vector3<L> c_u = SIMD_Vector3<L>::cross(edge_2, ray.direction);
+	SIMD_Vector3<L> c_v = SIMD_Vector3<L>::cross(ray.direction, edge_1);
+
+	SIMD_float<L> du_dx = one_over_k * SIMD_Vector3<L>::dot(c_u, _q);
+	SIMD_float<L> du_dy = one_over_k * SIMD_Vector3<L>::dot(c_u, _r);
+	SIMD_float<L> dv_dx = one_over_k * SIMD_Vector3<L>::dot(c_v, _q);
+	SIMD_float<L> dv_dy = one_over_k * SIMD_Vector3<L>::dot(c_v, _r);
+	
+	if constexpr (PROPAGATE_DIFFERENTIALS) {
+		attributes.dO_dx = SIMD_Vector3<L>::blend(attributes.dO_dx, du_dx * edge_1 + dv_dx * edge_2, mask);
+		attributes.dO_dy = SIMD_Vector3<L>::blend(attributes.dO_dy, du_dy * edge_1 + dv_dy * edge_2, mask);
+
+		// Calculate derivative of the non-normalized vector n
+		SIMD_Vector3<L> dn_dx = du_dx * n_edge_1 + dv_dx * n_edge_2;
+		SIMD_Vector3<L> dn_dy = du_dy * n_edge_1 + dv_dy * n_edge_2;
+
+		// Calculate derivative of the normalized vector N
+		SIMD_float<L> n_dot_n = SIMD_Vector3<L>::dot(n, n);
+		SIMD_float<L> N_denom = SIMD_float<L>::inv_sqrt(n_dot_n) / n_dot_n;
+
+		attributes.dN_dx = SIMD_Vector3<L>::blend(attributes.dN_dx, (n_dot_n * dn_dx - SIMD_Vector3<L>::dot(n, dn_dx) * n) * N_denom, mask);
+		attributes.dN_dy = SIMD_Vector3<L>::blend(attributes.dN_dy, (n_dot_n * dn_dy - SIMD_Vector3<L>::dot(n, dn_dy) * n) * N_denom, mask);
+	}
+
+	attributes.ds_dx = SIMD_float<L>::blend(attributes.ds_dx, du_dx * t_edge_1.x + dv_dx * t_edge_2.x, mask);
+	attributes.ds_dy = SIMD_float<L>::blend(attributes.ds_dy, du_dy * t_edge_1.x + dv_dy * t_edge_2.x, mask);
+	attributes.dt_dx = SIMD_float<L>::blend(attributes.dt_dx, du_dx * t_edge_1.y + dv_dx * t_edge_2.y, mask);
+	attributes.dt_dy = SIMD_float<L>::blend(attributes.dt_dy, du_dy * t_edge_1.y + dv_dy * t_edge_2.y, mask);
+#endif
+}
+
+#define INSTANTIATE_BOTTOM_LEVEL_BVH(L) \
+	template void                      BottomLevelBVH<L>::init(int count); \
+	template const BottomLevelBVH<L> * BottomLevelBVH<L>::load(const char * filename, int flags); \
+	template void                      BottomLevelBVH<L>::trace          (const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const; \
+	template void                      BottomLevelBVH<L>::trace          (const Ray<L> rays[], RayHit<L> hits[], int first, int packet_count, int instance_id, int & node_fetches) const; \
+	template SIMD_float<L>             BottomLevelBVH<L>::intersect      (const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const; \
+	template void                      BottomLevelBVH<L>::intersect      (const Ray<L> rays[], ShadowRayBatch<L> & batch, int lights, int instance_id) const; \
+	template void                      BottomLevelBVH<L>::evaluate<false>(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes, const Matrix4 & world) const; \
+	template void                      BottomLevelBVH<L>::evaluate<true> (const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes, const Matrix4 & world) const;
+SIMD_LANE_SIZES(INSTANTIATE_BOTTOM_LEVEL_BVH)
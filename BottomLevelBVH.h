@@ -1,7 +1,11 @@
 #pragma once
 #include "BVHBuilders.h"
+#include "ShadowBVH.h"
+#include "ShadowRayBatch.h"
 
+#include "HitAttributes.h"
 
+template<int L>
 struct BottomLevelBVH {
 	struct TriangleHot {
 		Vector3 position_0;
@@ -20,6 +24,60 @@ struct BottomLevelBVH {
 
 		int material_id; // Material id as obtained from the obj file, should not be used directly to index the global Material buffer
 	} * triangles_cold;
+
+	// Precomputed affine transformation that maps the Triangle onto the unit Triangle (see Baldwin and Weber 2016).
+	// Trades 12 floats per Triangle for an intersection test that only requires a few dot products
+	struct TriangleRecord {
+		Vector3 transform_u; float offset_u; // Maps a point in the plane of the Triangle to its barycentric coordinate u
+		Vector3 transform_v; float offset_v; // Maps a point in the plane of the Triangle to its barycentric coordinate v
+		Vector3 transform_t; float offset_t; // Maps a point to its distance to the plane of the Triangle, scaled by the largest component of the normal
+	} * triangle_records; // Only available if the Mesh opted into using them, nullptr otherwise
+
+	const ShadowBVH * shadow_bvh; // Used for occlusion queries instead of this BVH if the Mesh opted into it, nullptr otherwise
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+	// Leaf Nodes index this array, instead of the Triangle arrays directly
+	struct CompressedLeaf {
+		Vector3 origin; // Minimum corner of the bounds of all Triangles in the leaf
+		Vector3 scale;  // Size of one quantization step along each dimension
+
+		int first_vertex;   // Index of the first vertex of the leaf in the compressed_vertices array
+		int first_triangle; // Index of the first Triangle of the leaf in the compressed_triangles array
+	} * compressed_leaves;
+	
+	// Vertex position stored as an offset from the leaf origin in quantization steps
+	struct CompressedVertex {
+		unsigned short x, y, z;
+	} * compressed_vertices;
+
+	struct CompressedTriangle {
+		unsigned short vertex_0, vertex_1, vertex_2; // Relative to the first vertex of the leaf, vertices are shared within a leaf
+		
+		int index; // Index in the triangles_cold array, which is not flattened so that it is not duplicated for every SBVH reference
+		int leaf;  // Index of the CompressedLeaf this Triangle belongs to, needed to decompress it again after traversal
+	} * compressed_triangles;
+
+	int compressed_leaf_count;
+	int compressed_vertex_count;
+#endif
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+	// Positions of the Triangles in groups of L, in SoA form. Every leaf starts at the boundary of a group,
+	// so Triangle i is stored in lane i % L of group i / L. Unused lanes contain NaN positions
+	struct TriangleGroup {
+		SIMD_Vector3<L> position_0;
+		SIMD_Vector3<L> position_edge_1;
+		SIMD_Vector3<L> position_edge_2;
+	} * triangle_groups;
+
+	int triangle_group_count;
+#endif
+	
+#if BVH_HYBRID_TRAVERSAL
+	// Collapsed version of the binary BVH, used to trace the lanes of incoherent packets one at a time
+	WideBVHNode<L> * wide_nodes;
+	int              wide_node_count;
+#endif
 	
 	int triangle_count;
 
@@ -33,20 +91,70 @@ struct BottomLevelBVH {
 	
 	void init(int count);
 
-	static const BottomLevelBVH * load(const char * filename);
+	// Optional per Mesh data structures, see Mesh::init
+	static const int FLAG_TRIANGLE_RECORDS = 1 << 0; // Use precomputed Triangle intersection records (requires BVH_TRIANGLE_RECORDS, not available with BVH_LEAF_FORMAT_COMPRESSED)
+	static const int FLAG_SHADOW_BVH       = 1 << 1; // Build a separate, quantized BVH without duplicate references for occlusion queries
 
-	void trace(const Ray & ray, RayHit & ray_hit, const Matrix4 & world) const;
-	SIMD_float intersect(const Ray & ray, SIMD_float max_distance) const;
+	static const BottomLevelBVH * load(const char * filename, int flags);
+
+	void          trace    (const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const;
+	void          trace    (const Ray<L> rays[], RayHit<L> hits[], int first, int packet_count, int instance_id, int & node_fetches) const; // Traces the packets of a LargeRayPacket from the given one onwards, the Rays are given in Model Space
+	SIMD_float<L> intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const; // Records the last occluding Triangle in the Occluder
+	void          intersect(const Ray<L> rays[], ShadowRayBatch<L> & batch, int lights, int instance_id) const; // Traces the given Lights of the batch in a single traversal, the Rays are given in Model Space
+
+	template<bool PROPAGATE_DIFFERENTIALS> void evaluate(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes, const Matrix4 & world) const;
 
 private:
+	// With BVH_LEAF_FORMAT_SOA the builders aim for leaves of whole Triangle groups
+	static constexpr int GROUP_SIZE = BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA ? L : 1;
+
+	// With a lane size of 1 every packet already is a single Ray
+	static constexpr bool HYBRID_TRAVERSAL = BVH_HYBRID_TRAVERSAL && L > 1;
+
 	void build_bvh (const Triangle * triangles);
 	void build_sbvh(const Triangle * triangles);
 
+#if BVH_TRIANGLE_RECORDS
+	void calculate_triangle_records();
+#endif
+
 	void save_to_disk  (const char * bvh_filename) const;
 	void load_from_disk(const char * bvh_filename);
 	
 	void flatten();
 
-	FORCEINLINE void       triangle_trace    (int index, const Ray & ray, RayHit & ray_hit, const Matrix4 & world) const;
-	FORCEINLINE SIMD_float triangle_intersect(int index, const Ray & ray, SIMD_float max_distance) const;
+	FORCEINLINE void trace_leaf(const BVHNode & node, const Ray<L> & ray, SIMD_float<L> mask, RayHit<L> & ray_hit, int instance_id) const;
+
+#if BVH_HYBRID_TRAVERSAL
+	void build_wide_bvh();
+
+	void trace_single     (const Ray<L> & ray, int lane, RayHit<L> & ray_hit, int instance_id) const;
+	void trace_single_leaf(const BVHNode & node, const Vector3 & origin, const Vector3 & direction, int lane, RayHit<L> & ray_hit, int instance_id) const;
+
+	FORCEINLINE void triangle_trace(const TriangleHot    & triangle, int index, const Vector3 & origin, const Vector3 & direction, int lane, RayHit<L> & ray_hit, int instance_id) const;
+	FORCEINLINE void triangle_trace(const TriangleRecord & record,   int index, const Vector3 & origin, const Vector3 & direction, int lane, RayHit<L> & ray_hit, int instance_id) const;
+#endif
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_COMPRESSED
+	void compress(const Triangle * triangles);
+
+	FORCEINLINE TriangleHot decompress(const CompressedLeaf & leaf, int index) const;
+#endif
+
+#if BVH_LEAF_FORMAT == BVH_LEAF_FORMAT_SOA
+	void pack_triangle_groups();
+
+	FORCEINLINE void triangle_group_trace    (const TriangleGroup & group, int first_index, const Vector3 & origin, const Vector3 & direction, int lane, RayHit<L> & ray_hit, int instance_id) const;
+	FORCEINLINE int  triangle_group_intersect(const TriangleGroup & group,                  const Ray<L> & ray, int lane, float max_distance)                                    const;
+#endif
+
+	FORCEINLINE SIMD_float<L> intersect_leaf(const BVHNode & node, const Ray<L> & ray, SIMD_float<L> mask, SIMD_float<L> max_distance, SIMD_float<L> hit, Occluder & occluder) const;
+
+	FORCEINLINE void          triangle_trace    (const TriangleHot & triangle, int index, const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const;
+	FORCEINLINE SIMD_float<L> triangle_intersect(const TriangleHot & triangle,            const Ray<L> & ray, SIMD_float<L> max_distance) const;
+
+	FORCEINLINE void          triangle_trace    (const TriangleRecord & record, int index, const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const;
+	FORCEINLINE SIMD_float<L> triangle_intersect(const TriangleRecord & record,            const Ray<L> & ray, SIMD_float<L> max_distance) const;
+
+	static FORCEINLINE void record_occluder(Occluder & occluder, const TriangleHot & triangle);
 };
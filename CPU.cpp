@@ -0,0 +1,103 @@
+#include "CPU.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <intrin.h>
+#include <immintrin.h>
+
+struct Features {
+	bool sse41;
+	bool popcnt;
+	bool fma;
+	bool avx2;
+	bool avx512f;
+	bool avx512dq;
+};
+
+static Features detect_features() {
+	Features features = { };
+
+	int info[4]; // eax, ebx, ecx, edx
+
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	features.sse41  = (info[2] & (1 << 19)) != 0;
+	features.popcnt = (info[2] & (1 << 23)) != 0;
+
+	bool avx     = (info[2] & (1 << 28)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool fma     = (info[2] & (1 << 12)) != 0;
+
+	// The OS has to save the YMM / ZMM registers on context switches, otherwise the instructions are unusable
+	unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool os_ymm = (xcr0 & 0x06) == 0x06;
+	bool os_zmm = (xcr0 & 0xe6) == 0xe6;
+
+	features.fma = fma && avx && os_ymm;
+
+	if (max_leaf >= 7) {
+		__cpuidex(info, 7, 0);
+		features.avx2     = avx && os_ymm && (info[1] & (1 << 5)) != 0;
+		features.avx512f  = os_zmm && (info[1] & (1 << 16)) != 0;
+		features.avx512dq = os_zmm && (info[1] & (1 << 17)) != 0;
+	}
+
+	return features;
+}
+
+static const Features features = detect_features();
+
+int CPU::get_max_simd_lane_size() {
+	if (is_simd_lane_size_supported(16)) return 16;
+	if (is_simd_lane_size_supported(8))  return 8;
+	if (is_simd_lane_size_supported(4))  return 4;
+
+	return 1;
+}
+
+bool CPU::is_simd_lane_size_supported(int lane_size) {
+	switch (lane_size) {
+		case 1:  return features.popcnt;
+		case 4:  return features.popcnt && features.sse41 && features.fma;
+		case 8:  return features.popcnt && features.avx2  && features.fma;
+		case 16: return features.popcnt && features.avx2  && features.fma && features.avx512f && features.avx512dq;
+
+		default: return false;
+	}
+}
+
+const char * CPU::get_simd_lane_size_name(int lane_size) {
+	switch (lane_size) {
+		case 1:  return "Scalar";
+		case 4:  return "SSE";
+		case 8:  return "AVX";
+		case 16: return "AVX-512";
+
+		default: return "Unknown";
+	}
+}
+
+int CPU::select_simd_lane_size(int argument_count, char ** arguments) {
+	int max_lane_size = get_max_simd_lane_size();
+
+	// Check for a command line override
+	int requested_lane_size = -1;
+	for (int i = 1; i < argument_count - 1; i++) {
+		if (strcmp(arguments[i], "--simd") == 0) {
+			requested_lane_size = atoi(arguments[i + 1]);
+		}
+	}
+
+	if (requested_lane_size == -1) return max_lane_size;
+
+	if (!is_simd_lane_size_supported(requested_lane_size)) {
+		printf("ERROR: SIMD lane size %i was requested, but is not supported by this CPU! The maximum supported lane size is %i (%s)\n", requested_lane_size, max_lane_size, get_simd_lane_size_name(max_lane_size));
+		exit(EXIT_FAILURE);
+	}
+
+	return requested_lane_size;
+}
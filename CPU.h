@@ -0,0 +1,17 @@
+#pragma once
+
+// Detects which SIMD lane sizes the host CPU can run. The raytracing core is
+// instantiated for every lane size, and main picks the widest one available.
+// The lane size can be forced by passing "--simd <lanes>" on the command line.
+namespace CPU {
+	// Returns the largest SIMD lane size (1, 4, 8 or 16) that is supported by both the CPU and the OS
+	int get_max_simd_lane_size();
+
+	bool is_simd_lane_size_supported(int lane_size);
+
+	const char * get_simd_lane_size_name(int lane_size);
+
+	// Returns the lane size requested using "--simd <lanes>", or the widest supported one if none was requested.
+	// Exits with an error if the requested lane size is not supported
+	int select_simd_lane_size(int argument_count, char ** arguments);
+}
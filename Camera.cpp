@@ -42,7 +42,7 @@ void Camera::update(float delta, const unsigned char * keys) {
 	}
 
 	// Transform view pyramid according to rotation
-	rotated_top_left_corner = SIMD_Vector3(rotation * top_left_corner);
-	rotated_x_axis          = SIMD_Vector3(rotation * x_axis);
-	rotated_y_axis          = SIMD_Vector3(rotation * y_axis);
+	rotated_top_left_corner = rotation * top_left_corner;
+	rotated_x_axis          = rotation * x_axis;
+	rotated_y_axis          = rotation * y_axis;
 }
@@ -18,9 +18,9 @@ struct Camera {
 	Vector3 x_axis;
 	Vector3 y_axis;
 
-	SIMD_Vector3 rotated_top_left_corner;
-	SIMD_Vector3 rotated_x_axis;
-	SIMD_Vector3 rotated_y_axis;
+	Vector3 rotated_top_left_corner;
+	Vector3 rotated_x_axis;
+	Vector3 rotated_y_axis;
 
 	inline Camera(float fov) : fov(fov) { }
 
@@ -1,7 +1,8 @@
 #pragma once
 // Scene settings
-#define SCENE_SPONZA  0
-#define SCENE_DYNAMIC 1
+#define SCENE_SPONZA      0
+#define SCENE_DYNAMIC     1
+#define SCENE_MANY_LIGHTS 2 // Floor and Meshes lit by a grid of 1024 coloured Point Lights
 
 #define SCENE SCENE_SPONZA
 
@@ -9,18 +10,36 @@
 #define SCREEN_WIDTH  900
 #define SCREEN_HEIGHT 600
 
-#define NUMBER_OF_BOUNCES 3 // Number of bounces AFTER primary Rays, meaning 0 has only primary Rays
+#define NUMBER_OF_BOUNCES     3 // Number of bounces AFTER primary Rays, meaning 0 has only primary Rays. Can be changed at runtime
+#define MAX_NUMBER_OF_BOUNCES 8 // Upper limit for the number of bounces at runtime, determines the size of the Ray stack of every thread
 
-#define USE_MULTITHREADING true // When enabled will use the maximum amount of threads available
+#define BOUNCE_TERMINATION           true   // Retires the lanes of reflected and refracted Rays whose weight, relative to their pixel, is too small to be visible. The number of bounces is then only an upper limit per lane
+#define BOUNCE_TERMINATION_THRESHOLD 0.004f // Lanes are retired once all colour channels of their weight drop below this, roughly one step of an 8 bit colour channel
+
+#define PRIMARY_RAY_LARGE_PACKETS     true // The primary Rays of a block of pixels traverse the BVHs together, as one large packet made up of multiple SIMD packets. Not used by RAYTRACER_WAVEFRONT
+#define PRIMARY_RAY_LARGE_PACKET_SIZE 16   // Width and height in pixels of the block covered by a large packet
+
+#define RAYTRACER_WAVEFRONT false // Renders every tile breadth first, one bounce at a time. The Rays of each bounce are sorted for coherence and repacked into full packets
+#define WAVEFRONT_MATERIAL_SORTING true // Only used by RAYTRACER_WAVEFRONT. The hits of each bounce are sorted by Material before shading, so that every shading packet accesses a single Material and Texture
+
+#define SHADOW_OCCLUDER_CACHE true // Every thread remembers the last Triangle that occluded a Shadow Ray towards each Light, and tests it before traversing the Scene
+
+#define SHADOW_RAY_BATCHING   false // Traces the Shadow Rays towards multiple Lights in a single traversal of the Scene, instead of one traversal per Light
+#define SHADOW_RAY_BATCH_SIZE 8     // Maximum number of Lights per traversal, at most 32
 
-#define SIMD_LANE_SIZE 8 // 1 means scalar flow, 4 means SSE, 8 means AVX
+#define LIGHT_CULLING             true   // Only shades the Point and Spot Lights whose region of influence overlaps the hit points, using per tile Light lists and a Light BVH
+#define LIGHT_INFLUENCE_THRESHOLD 0.01f  // Lighting below this intensity is considered negligible, determines the radius of influence of Point and Spot Lights
 
-#define MAX_MATERIALS 256 // Size of the global Material buffer
+#define SHADOW_RAY_CULLING           true                      // Only traces Shadow Rays for lanes that can receive light, checking the angle with the normal, the cone of Spot Lights and the attenuation first
+#define SHADOW_RAY_CULLING_THRESHOLD LIGHT_INFLUENCE_THRESHOLD // Lanes that would receive less lighting than this do not trace a Shadow Ray
+
+#define USE_MULTITHREADING true // When enabled will use the maximum amount of threads available
 
 #define ENABLE_FXAA true // Fast Approximative Anti-Aliasing
 
 // BVH settings
-#define BVH_VISUALIZE_HEATMAP false // Toggle to visualize number of traversal steps through BVH
+#define BVH_VISUALIZE_HEATMAP  false // Toggle to visualize number of traversal steps through BVH
+#define BVH_COUNT_NODE_FETCHES false // Toggle to count the BVH Nodes fetched by primary Rays, shown per pixel in the performance panel. Without PRIMARY_RAY_LARGE_PACKETS the primary Rays share their traversal with the secondary Rays, which then also count but are not reported
 
 #define BVH_TRAVERSAL_STACK_SIZE 64
 
@@ -29,11 +48,35 @@
 
 #define BVH_TRAVERSAL_STRATEGY BVH_TRAVERSE_TREE_ORDERED
 
+#define BVH_PACKET_CULLING false // Rejects BVH Nodes for all lanes at once with a conservative interval arithmetic test, before the per lane slab test. Only pays off for packets wider than a SIMD register
+
+#define BVH_HYBRID_TRAVERSAL                  true // Packets with few active lanes, or whose directions diverge, trace every active lane as a single Ray through a BVH with Nodes as wide as the lane size instead. Not used with a lane size of 1
+#define BVH_HYBRID_TRAVERSAL_MIN_LANE_FRACTION 0.5f // Packets in which fewer than this fraction of the lanes are active are traced as single Rays
+#define BVH_HYBRID_TRAVERSAL_MIN_COHERENCE     0.9f // Packets are traced as single Rays if the cosine of the angle between any active lane and their average direction is below this
+
 #define MESH_ACCELERATOR_BVH  0 // Regular SAH based BVH construction
 #define MESH_ACCELERATOR_SBVH 1 // Spatial BVH. Able to split Triangles (see https://www.nvidia.in/docs/IO/77714/sbvh.pdf)
 
 #define MESH_ACCELERATOR MESH_ACCELERATOR_SBVH // Bottom Level (object space) acceleration structure
 
+#define SBVH_BINNING_SCALAR 0 // Clips every Triangle against the planes of one spatial split Bin at a time
+#define SBVH_BINNING_SIMD   1 // Clips every Triangle against the planes of as many spatial split Bins as the lane size at once. Produces identical Bins to the scalar path, only faster if the lane size is > 1
+
+#define SBVH_BINNING SBVH_BINNING_SIMD
+
+#define BVH_LAYOUT_DEPTH_FIRST   0 // Nodes are stored in the order in which the builder allocated them
+#define BVH_LAYOUT_VAN_EMDE_BOAS 1 // Nodes are reordered into recursively clustered subtrees, so that Nodes that are close in the tree are close in memory
+
+#define BVH_LAYOUT BVH_LAYOUT_VAN_EMDE_BOAS // Memory layout of the Bottom Level BVH Nodes. The layout is stored in the .bvh file, so delete it after changing this setting
+
+#define BVH_LEAF_FORMAT_FLAT       0 // Triangles are stored at full precision in the order of the leaves, duplicated for every SBVH reference
+#define BVH_LEAF_FORMAT_COMPRESSED 1 // Leaves store deduplicated vertex positions as 16 bit offsets quantized against the bounds of the leaf. Saves memory at the cost of decompression and some precision. The .bvh file stores the compressed format, so delete the .bvh files after changing this setting
+#define BVH_LEAF_FORMAT_SOA        2 // Triangles are additionally packed in groups of the lane size in SoA form, so that a single Ray can be intersected with a whole group at once when few lanes of a packet are active. The builders then aim for leaves of that size, which is why the .bvh files are stored per lane size. Delete them after changing this setting
+
+#define BVH_LEAF_FORMAT BVH_LEAF_FORMAT_FLAT
+
+#define BVH_TRIANGLE_RECORDS true // Precomputes a Baldwin-Weber intersection record for every Triangle and stores it in the .bvh file, Meshes can then opt into using them (see Mesh::init). Delete the .bvh files after changing this setting
+
 // Texture settings
 #define TEXTURE_SAMPLE_MODE_NEAREST  0 // No filtering
 #define TEXTURE_SAMPLE_MODE_BILINEAR 1 // Bilinear filtering
@@ -41,6 +84,9 @@
 
 #define TEXTURE_SAMPLE_MODE TEXTURE_SAMPLE_MODE_MIPMAP
 
+#define TEXTURE_TILED     false // Stores every Mipmap level as square tiles of texels, with the texels inside a tile in Morton order, so that filter footprints touch fewer cache lines. Levels that are not a whole number of tiles stay row-major
+#define TEXTURE_TILE_SIZE 4     // Only used by TEXTURE_TILED. Width and height of a tile in texels, should be a power of two. A 4x4 tile of Vector3 texels spans three cache lines
+
 // Ray Differentials are only used to determine the correct mipmap level,
 // so we don't need to compute them if mipmapping is not enabled
 #define RAY_DIFFERENTIALS_ENABLED (TEXTURE_SAMPLE_MODE == TEXTURE_SAMPLE_MODE_MIPMAP)
@@ -5,8 +5,9 @@
 #include "Texture.h"
 
 namespace Debug {
-	inline bool is_valid(const SIMD_float & floats) {
-		for (int i = 0; i < SIMD_LANE_SIZE; i++) {
+	template<int L>
+	inline bool is_valid(const SIMD_float<L> & floats) {
+		for (int i = 0; i < L; i++) {
 			float f = floats[i];
 
 			if (::isinf(f) || ::isnan(f)) {
@@ -17,38 +18,41 @@ namespace Debug {
 		return true;
 	}
 
-	inline bool is_valid(const SIMD_Vector3 & vector) {
+	template<int L>
+	inline bool is_valid(const SIMD_Vector3<L> & vector) {
 		return is_valid(vector.x) && is_valid(vector.y) && is_valid(vector.z);
 	}
 
-	inline bool approx_equal(SIMD_float a, SIMD_float b) {
-		const SIMD_float epsilon(0.01f);
+	template<int L>
+	inline bool approx_equal(SIMD_float<L> a, SIMD_float<L> b) {
+		const SIMD_float<L> epsilon(0.01f);
 
-		SIMD_float diff = a - b;
-		return SIMD_float::all_true((diff > -epsilon) & (diff < epsilon));
+		SIMD_float<L> diff = a - b;
+		return SIMD_float<L>::all_true((diff > -epsilon) & (diff < epsilon));
 	}
 
 	// Check if Snell's Law holds for the given input and output directions
-	inline bool test_refraction(SIMD_float n_1, SIMD_float n_2, const SIMD_Vector3 & direction_in, const SIMD_Vector3 & normal, const SIMD_Vector3 & direction_out, SIMD_float mask) {
-		const SIMD_float zero(0.0f);
-		const SIMD_float one (1.0f);
+	template<int L>
+	inline bool test_refraction(SIMD_float<L> n_1, SIMD_float<L> n_2, const SIMD_Vector3<L> & direction_in, const SIMD_Vector3<L> & normal, const SIMD_Vector3<L> & direction_out, SIMD_float<L> mask) {
+		const SIMD_float<L> zero(0.0f);
+		const SIMD_float<L> one (1.0f);
 		
 		// Vectors are assumed to be normalized
-		assert(approx_equal(SIMD_float::blend(one, SIMD_Vector3::length(direction_in),  mask), one));
-		assert(approx_equal(SIMD_float::blend(one, SIMD_Vector3::length(direction_out), mask), one));
-		assert(approx_equal(SIMD_float::blend(one, SIMD_Vector3::length(normal),        mask), one));
+		assert(approx_equal(SIMD_float<L>::blend(one, SIMD_Vector3<L>::length(direction_in),  mask), one));
+		assert(approx_equal(SIMD_float<L>::blend(one, SIMD_Vector3<L>::length(direction_out), mask), one));
+		assert(approx_equal(SIMD_float<L>::blend(one, SIMD_Vector3<L>::length(normal),        mask), one));
 		
-		assert(SIMD_float::all_true(SIMD_float::blend(one, SIMD_Vector3::dot(-direction_in,   normal), mask) >= SIMD_float(-1e8))); // Opposite of incoming direction and normal should point in the same direction
-		assert(SIMD_float::all_true(SIMD_float::blend(one, SIMD_Vector3::dot( direction_out, -normal), mask) >= SIMD_float(-1e8))); // Outgoing direction and opposite of normal should point in the same direction
+		assert(SIMD_float<L>::all_true(SIMD_float<L>::blend(one, SIMD_Vector3<L>::dot(-direction_in,   normal), mask) >= SIMD_float<L>(-1e8))); // Opposite of incoming direction and normal should point in the same direction
+		assert(SIMD_float<L>::all_true(SIMD_float<L>::blend(one, SIMD_Vector3<L>::dot( direction_out, -normal), mask) >= SIMD_float<L>(-1e8))); // Outgoing direction and opposite of normal should point in the same direction
 		
-		SIMD_float dot_1 = SIMD_Vector3::dot(-direction_in,   normal);
-		SIMD_float dot_2 = SIMD_Vector3::dot( direction_out, -normal);
+		SIMD_float<L> dot_1 = SIMD_Vector3<L>::dot(-direction_in,   normal);
+		SIMD_float<L> dot_2 = SIMD_Vector3<L>::dot( direction_out, -normal);
 		
-		SIMD_float theta_1(SIMD_float::acos(SIMD_float::clamp(dot_1, -one, one)));
-		SIMD_float theta_2(SIMD_float::acos(SIMD_float::clamp(dot_2, -one, one)));
+		SIMD_float<L> theta_1(SIMD_Math::acos(SIMD_Math::clamp(dot_1, -one, one)));
+		SIMD_float<L> theta_2(SIMD_Math::acos(SIMD_Math::clamp(dot_2, -one, one)));
 
-		SIMD_float lhs = SIMD_float::blend(zero, n_1 * SIMD_float::sin(theta_1), mask);
-		SIMD_float rhs = SIMD_float::blend(zero, n_2 * SIMD_float::sin(theta_2), mask);
+		SIMD_float<L> lhs = SIMD_float<L>::blend(zero, n_1 * SIMD_Math::sin(theta_1), mask);
+		SIMD_float<L> rhs = SIMD_float<L>::blend(zero, n_2 * SIMD_Math::sin(theta_2), mask);
 		
 		return approx_equal(lhs, rhs);
 	}
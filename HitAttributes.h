@@ -0,0 +1,22 @@
+#pragma once
+#include "SIMD_Vector3.h"
+
+// Shading attributes of the closest hit of a Ray, see Scene::evaluate_hit
+template<int L>
+struct HitAttributes {
+	SIMD_Vector3<L> point;  // Coordinates of the hit in World Space
+	SIMD_Vector3<L> normal; // Normal      of the hit in World Space
+
+	SIMD_int<L>   material_id;
+	SIMD_float<L> u, v; // Texture coordinates
+
+#if RAY_DIFFERENTIALS_ENABLED
+	// Derivatives of texture space coordinates s, t
+	// with respect to screen space coordinates x, y
+	SIMD_float<L> ds_dx, ds_dy;
+	SIMD_float<L> dt_dx, dt_dy;
+
+	SIMD_Vector3<L> dO_dx, dO_dy;
+	SIMD_Vector3<L> dN_dx, dN_dy;
+#endif
+};
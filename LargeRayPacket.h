@@ -0,0 +1,45 @@
+#pragma once
+#include "AABB.h"
+#include "RayHit.h"
+#include "RayInterval.h"
+
+// The primary Rays of a block of PRIMARY_RAY_LARGE_PACKET_SIZE x PRIMARY_RAY_LARGE_PACKET_SIZE pixels, as multiple SIMD packets that traverse the BVHs together.
+// Every Node is fetched and culled once for the whole block. The SIMD packets are then only tested from the first one that intersects the Node onwards,
+// and that packet is passed down to the children, since packets before it cannot intersect them either (see Wald et al. 2001, Interactive Rendering with Coherent Ray Tracing)
+template<int L>
+struct LargeRayPacket {
+	static const int MAX_PACKET_COUNT = PRIMARY_RAY_LARGE_PACKET_SIZE * PRIMARY_RAY_LARGE_PACKET_SIZE / L;
+
+	Ray<L>    rays[MAX_PACKET_COUNT];
+	RayHit<L> hits[MAX_PACKET_COUNT];
+
+	int packet_count;
+
+	int node_fetches; // Number of BVH Nodes fetched while tracing the whole block, only counted with BVH_COUNT_NODE_FETCHES
+
+	// Traversal stack entry, remembers the first packet that intersected the parent Node
+	struct StackEntry {
+		int node;
+		int first;
+	};
+
+	// Returns the index of the first packet, starting at the given one, of which any lane intersects the AABB, or the packet count if there is none
+	inline static int find_first_active(const AABB & aabb, const Ray<L> rays[], const SIMD_Vector3<L> inv_directions[], const RayHit<L> hits[], int first, int packet_count) {
+		while (first < packet_count && SIMD_float<L>::all_false(aabb.intersect(rays[first], inv_directions[first], hits[first].distance))) {
+			first++;
+		}
+
+		return first;
+	}
+
+	// Largest distance at which any lane of the given packets can still find a closer hit, used for culling with RayInterval
+	inline static float max_distance(const RayHit<L> hits[], int first, int packet_count) {
+		float result = 0.0f;
+
+		for (int p = first; p < packet_count; p++) {
+			result = std::max(result, SIMD_float<L>::hmax(hits[p].distance));
+		}
+
+		return result;
+	}
+};
@@ -4,24 +4,26 @@
 #include "Vector3.h"
 
 struct Light {
-	SIMD_Vector3 colour;
+	Vector3 colour;
 
+	inline Light() { }
 	inline Light(const Vector3 & colour) : colour(colour) { }
 
 	// Calculate lighting using Blinn-Phong model
-	inline SIMD_Vector3 calc_lighting(const SIMD_Vector3 & normal, const SIMD_Vector3 & to_light, const SIMD_Vector3 & to_camera) const {
-		const SIMD_float zero(0.0f);
+	template<int L>
+	inline SIMD_Vector3<L> calc_lighting(const SIMD_Vector3<L> & normal, const SIMD_Vector3<L> & to_light, const SIMD_Vector3<L> & to_camera) const {
+		const SIMD_float<L> zero(0.0f);
 
-        SIMD_float intensity = SIMD_Vector3::dot(normal, to_light);
+        SIMD_float<L> intensity = SIMD_Vector3<L>::dot(normal, to_light);
 
-		SIMD_float mask = intensity > zero;
-        if (SIMD_float::all_false(mask)) return SIMD_Vector3(0.0f);
+		SIMD_float<L> mask = intensity > zero;
+        if (SIMD_float<L>::all_false(mask)) return SIMD_Vector3<L>(0.0f);
 
-        SIMD_Vector3 half_angle = SIMD_Vector3::normalize(to_light + to_camera);
+        SIMD_Vector3<L> half_angle = SIMD_Vector3<L>::normalize(to_light + to_camera);
 
-        SIMD_float specular_factor = SIMD_Vector3::dot(normal, half_angle);
+        SIMD_float<L> specular_factor = SIMD_Vector3<L>::dot(normal, half_angle);
         intensity = intensity + Math::pow2<128>(specular_factor);
 
-        return SIMD_float::blend(zero, intensity, mask) * colour;
+        return SIMD_float<L>::blend(zero, intensity, mask) * SIMD_Vector3<L>(colour);
 	}
 };
@@ -0,0 +1,193 @@
+#include "LightBVH.h"
+
+#include <algorithm>
+
+// Distance at which the inverse square falloff of a Light with the given colour drops below LIGHT_INFLUENCE_THRESHOLD.
+// The diffuse and specular terms of Light::calc_lighting are both at most one, so the unattenuated intensity is at most twice the colour
+static float influence_radius(const Vector3 & colour) {
+	float max_colour = std::max(std::max(colour.x, colour.y), colour.z);
+
+	return sqrtf(2.0f * max_colour / LIGHT_INFLUENCE_THRESHOLD);
+}
+
+static void set_bounds(LightBVH::LightBounds & bounds, const Vector3 & center, float radius) {
+	bounds.center = center;
+	bounds.radius = radius;
+
+	bounds.aabb.min = center - Vector3(radius);
+	bounds.aabb.max = center + Vector3(radius);
+}
+
+void LightBVH::init(const PointLight point_lights[], int point_light_count, const SpotLight spot_lights[], int spot_light_count) {
+	light_count = point_light_count + spot_light_count;
+
+	node_count = 0;
+
+	if (light_count == 0) return;
+
+	bounds = new LightBounds[light_count];
+
+	for (int i = 0; i < point_light_count; i++) {
+		set_bounds(bounds[i], point_lights[i].position, influence_radius(point_lights[i].colour));
+	}
+
+	// The influence of a SpotLight is a cone with a spherical cap, bound it as tightly as possible (see https://bartwronski.com/2017/04/13/cull-that-cone/)
+	for (int i = 0; i < spot_light_count; i++) {
+		const SpotLight & spot_light = spot_lights[i];
+
+		Vector3 position  =  spot_light.position;
+		Vector3 direction = -spot_light.negative_direction;
+
+		float radius = influence_radius(spot_light.colour);
+
+		float cos_angle = spot_light.outer_cutoff;
+		float sin_angle = sqrtf(std::max(0.0f, 1.0f - cos_angle * cos_angle));
+
+		LightBounds & light_bounds = bounds[point_light_count + i];
+
+		if (cos_angle <= 0.0f) {
+			// Cone is wider than a hemisphere
+			set_bounds(light_bounds, position, radius);
+		} else if (cos_angle < 0.70710678f) {
+			// Cone is wider than 90 degrees, the sphere around the cap also contains the apex
+			set_bounds(light_bounds, position + direction * (radius * cos_angle), radius * sin_angle);
+		} else {
+			// Narrow cone, use the sphere through the apex and the rim of the cap
+			float sphere_radius = radius / (2.0f * cos_angle);
+
+			set_bounds(light_bounds, position + direction * sphere_radius, sphere_radius);
+		}
+	}
+
+	int * indices_x = new int[light_count];
+	int * indices_y = new int[light_count];
+	int * indices_z = new int[light_count];
+
+	for (int i = 0; i < light_count; i++) {
+		indices_x[i] = i;
+		indices_y[i] = i;
+		indices_z[i] = i;
+	}
+
+	std::sort(indices_x, indices_x + light_count, [&](int a, int b) { return bounds[a].center.x < bounds[b].center.x; });
+	std::sort(indices_y, indices_y + light_count, [&](int a, int b) { return bounds[a].center.y < bounds[b].center.y; });
+	std::sort(indices_z, indices_z + light_count, [&](int a, int b) { return bounds[a].center.z < bounds[b].center.z; });
+
+	int * indices_xyz[3] = { indices_x, indices_y, indices_z };
+
+	float * sah  = new float[light_count];
+	int   * temp = new int[light_count];
+
+	nodes = Util::aligned_malloc<BVHNode>(2 * light_count, CACHE_LINE_WIDTH);
+
+	node_count = 2;
+	BVHBuilders::build_bvh(nodes[0], bounds, indices_xyz, nodes, node_count, 0, light_count, sah, temp);
+
+	assert(node_count <= 2 * light_count);
+
+	indices = indices_x;
+
+	delete [] indices_y;
+	delete [] indices_z;
+
+	delete [] sah;
+	delete [] temp;
+
+	printf("Light BVH contains %i Lights in %i Nodes\n", light_count, node_count);
+}
+
+int LightBVH::query(const AABB & region, int lights[]) const {
+	if (node_count == 0) return 0;
+
+	int count = 0;
+
+	int stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack[0] = 0;
+
+	while (stack_size > 0) {
+		const BVHNode & node = nodes[stack[--stack_size]];
+
+		// Not using AABB::overlap, since the region may be flat or even a single point
+		if (node.aabb.min.x > region.max.x || node.aabb.max.x < region.min.x ||
+			node.aabb.min.y > region.max.y || node.aabb.max.y < region.min.y ||
+			node.aabb.min.z > region.max.z || node.aabb.max.z < region.min.z) continue;
+
+		if (node.is_leaf()) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				if (overlaps(indices[i], region)) {
+					lights[count++] = indices[i];
+				}
+			}
+		} else {
+			stack[stack_size++] = node.left;
+			stack[stack_size++] = node.left + 1;
+		}
+	}
+
+	return count;
+}
+
+int LightBVH::query(const Vector3 & origin, const Vector3 plane_normals[], int plane_count, int lights[]) const {
+	if (node_count == 0) return 0;
+
+	int count = 0;
+
+	int stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack[0] = 0;
+
+	while (stack_size > 0) {
+		const BVHNode & node = nodes[stack[--stack_size]];
+
+		// Reject the Node if it is entirely behind one of the planes, by checking the corner furthest along the normal
+		bool outside = false;
+
+		for (int p = 0; p < plane_count; p++) {
+			const Vector3 & normal = plane_normals[p];
+
+			Vector3 corner(
+				normal.x > 0.0f ? node.aabb.max.x : node.aabb.min.x,
+				normal.y > 0.0f ? node.aabb.max.y : node.aabb.min.y,
+				normal.z > 0.0f ? node.aabb.max.z : node.aabb.min.z
+			);
+
+			if (Vector3::dot(normal, corner - origin) < 0.0f) {
+				outside = true;
+
+				break;
+			}
+		}
+
+		if (outside) continue;
+
+		if (node.is_leaf()) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				const LightBounds & light_bounds = bounds[indices[i]];
+
+				bool inside = true;
+
+				for (int p = 0; p < plane_count; p++) {
+					if (Vector3::dot(plane_normals[p], light_bounds.center - origin) < -light_bounds.radius) {
+						inside = false;
+
+						break;
+					}
+				}
+
+				if (inside) {
+					lights[count++] = indices[i];
+				}
+			}
+		} else {
+			stack[stack_size++] = node.left;
+			stack[stack_size++] = node.left + 1;
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "BVHBuilders.h"
+
+#include "PointLight.h"
+#include "SpotLight.h"
+
+// BVH over the spheres of influence of all point and spot Lights. Used to find the Lights that can
+// contribute to a region of space, so that the cost of shading does not grow with the total number of Lights
+struct LightBVH {
+	// Bounding sphere of the region in which a Light contributes at least LIGHT_INFLUENCE_THRESHOLD
+	struct LightBounds {
+		Vector3 center;
+		float   radius;
+
+		AABB aabb;
+
+		inline Vector3 get_position() const {
+			return center;
+		}
+	} * bounds; // Indexed by Light, point Lights are numbered first and spot Lights after
+
+	int light_count;
+
+	int * indices;
+
+	BVHNode * nodes;
+	int       node_count;
+
+	void init(const PointLight point_lights[], int point_light_count, const SpotLight spot_lights[], int spot_light_count);
+
+	// Stores the indices of all Lights whose sphere of influence overlaps the given AABB, returns the number of Lights found
+	int query(const AABB & region, int lights[]) const;
+
+	// Stores the indices of all Lights whose sphere of influence is (partially) in front of all given planes, returns the number of Lights found.
+	// The planes all go through the given origin, which allows the Lights that can affect a screen tile to be found using the planes of its frustum
+	int query(const Vector3 & origin, const Vector3 plane_normals[], int plane_count, int lights[]) const;
+
+	// Checks if the sphere of influence of the given Light overlaps the AABB
+	inline bool overlaps(int light, const AABB & region) const {
+		const LightBounds & light_bounds = bounds[light];
+
+		Vector3 closest_point = Vector3::min(Vector3::max(light_bounds.center, region.min), region.max);
+
+		return Vector3::length_squared(closest_point - light_bounds.center) <= light_bounds.radius * light_bounds.radius;
+	}
+};
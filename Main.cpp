@@ -5,6 +5,8 @@
 
 #include "Raytracer.h"
 
+#include "CPU.h"
+
 #include "WorkerThread.h"
 
 // Forces NVIDIA driver to be used 
@@ -14,17 +16,9 @@ extern "C" { _declspec(dllexport) unsigned NvOptimusEnablement = true; }
 float timings[TOTAL_TIMING_COUNT];
 int   current_frame = 0;
 
-int main(int argument_count, char ** arguments) {
-	Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Raytracer");
-
-#if _DEBUG
-	glEnable(GL_DEBUG_OUTPUT);
-	glDebugMessageCallback(glMessageCallback, NULL);
-#endif
-
-	Texture::init();
-	MaterialBuffer::init();
-
+// Runs the program using a SIMD lane size of L for the whole raytracing core
+template<int L>
+static int run(Window & window) {
 	// Initialize timing stuff
 	Uint64 now  = 0;
 	Uint64 last = 0;
@@ -36,11 +30,11 @@ int main(int argument_count, char ** arguments) {
 	int fps    = 0;
 
 	// Initialize Scene
-	Scene scene;
+	Scene<L> scene;
 	scene.camera.resize(SCREEN_WIDTH, SCREEN_HEIGHT);
 
-	Raytracer raytracer;
-	raytracer.scene = &scene;
+	Raytracer<L> raytracer;
+	raytracer.init(&scene);
 
 	// Initialize multi threading stuff
 	WorkerThreads::init(raytracer, window);
@@ -92,7 +86,22 @@ int main(int argument_count, char ** arguments) {
 		float num_reflection_rays = float(performance_stats.num_reflection_rays * fps) * 1e-6f;
 		float num_refraction_rays = float(performance_stats.num_refraction_rays * fps) * 1e-6f;
 
+		float num_shadow_rays_skipped     = float(performance_stats.num_shadow_rays_skipped     * fps) * 1e-6f;
+		float num_bounce_lanes_terminated = float(performance_stats.num_bounce_lanes_terminated * fps) * 1e-6f;
+
 		float num_total_rays = num_primary_rays + num_shadow_rays + num_reflection_rays + num_refraction_rays;
+
+		float shadow_cache_hit_rate = performance_stats.num_shadow_rays > 0 ? float(performance_stats.num_shadow_cache_hits) / float(performance_stats.num_shadow_rays) : 0.0f;
+
+		// A packet traversal traces L lanes at once, a single Ray traversal only one
+		int num_traversed_lanes = performance_stats.num_packet_traversals * L + performance_stats.num_single_ray_traversals;
+
+		float single_ray_traversal_rate = num_traversed_lanes > 0 ? float(performance_stats.num_single_ray_traversals) / float(num_traversed_lanes) : 0.0f;
+
+#if BVH_COUNT_NODE_FETCHES
+		// Every lane of a primary Ray packet is one pixel
+		float primary_node_fetches_per_pixel = performance_stats.num_primary_rays > 0 ? float(performance_stats.num_primary_node_fetches) / float(performance_stats.num_primary_rays) : 0.0f;
+#endif
 		
 		window.gui_begin();
 
@@ -101,13 +110,38 @@ int main(int argument_count, char ** arguments) {
 		ImGui::Text("FPS: %i", fps);
 		ImGui::Text("Delta: %.2f ms", delta_time * 1000.0f);
 		ImGui::Text("Avg:   %.2f ms", avg        * 1000.0f);
+
+		ImGui::SliderInt("Bounces", &raytracer.number_of_bounces, 0, MAX_NUMBER_OF_BOUNCES);
 		
+		if (ImGui::CollapsingHeader("SIMD", ImGuiTreeNodeFlags_DefaultOpen)) {
+			ImGui::Text("Lane size:    %i (%s)", L, CPU::get_simd_lane_size_name(L));
+			ImGui::Text("CPU maximum:  %i (%s)", CPU::get_max_simd_lane_size(), CPU::get_simd_lane_size_name(CPU::get_max_simd_lane_size()));
+		}
+
 		if (ImGui::CollapsingHeader("Ray Counters", ImGuiTreeNodeFlags_DefaultOpen)) {
 			ImGui::Text("Total:      %.2f MRays/s", num_total_rays);
 			ImGui::Text("Primary:    %.2f MRays/s", num_primary_rays);
 			ImGui::Text("Shadow:     %.2f MRays/s", num_shadow_rays);
 			ImGui::Text("Reflection: %.2f MRays/s", num_reflection_rays);
 			ImGui::Text("Refraction: %.2f MRays/s", num_refraction_rays);
+			ImGui::Text("Skipped:    %.2f MRays/s", num_shadow_rays_skipped);
+			ImGui::Text("Terminated: %.2f MRays/s", num_bounce_lanes_terminated);
+		}
+
+		if (ImGui::CollapsingHeader("Shadow Occluder Cache", ImGuiTreeNodeFlags_DefaultOpen)) {
+			ImGui::Text("Hit rate: %.1f%%", shadow_cache_hit_rate * 100.0f);
+		}
+
+		if (ImGui::CollapsingHeader("Hybrid Traversal", ImGuiTreeNodeFlags_DefaultOpen)) {
+			ImGui::Text("Packet:     %i", performance_stats.num_packet_traversals);
+			ImGui::Text("Single Ray: %i (%.1f%% of lanes)", performance_stats.num_single_ray_traversals, single_ray_traversal_rate * 100.0f);
+		}
+
+		if (ImGui::CollapsingHeader("Primary Rays", ImGuiTreeNodeFlags_DefaultOpen)) {
+			ImGui::Text("Large Packets: %s", PRIMARY_RAY_LARGE_PACKETS ? "On" : "Off");
+#if BVH_COUNT_NODE_FETCHES
+			ImGui::Text("Node fetches / pixel: %.2f", primary_node_fetches_per_pixel);
+#endif
 		}
 
 		ImGui::End();
@@ -119,3 +153,26 @@ int main(int argument_count, char ** arguments) {
 
 	return EXIT_SUCCESS;
 }
+
+int main(int argument_count, char ** arguments) {
+	int lane_size = CPU::select_simd_lane_size(argument_count, arguments);
+
+	Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Raytracer");
+
+#if _DEBUG
+	glEnable(GL_DEBUG_OUTPUT);
+	glDebugMessageCallback(glMessageCallback, NULL);
+#endif
+
+	Texture::init();
+	MaterialBuffer::init();
+
+	switch (lane_size) {
+		case 1:  return run<1> (window);
+		case 4:  return run<4> (window);
+		case 8:  return run<8> (window);
+		case 16: return run<16>(window);
+
+		default: abort();
+	}
+}
@@ -1,11 +1,13 @@
 #pragma once
-#include <cstdio>
-#include <cstdlib>
+#include <vector>
 
 #include "Texture.h"
 
+#include "SIMD_Vector3.h"
+
+// Properties of a single Material, used to add Materials to the MaterialBuffer
 struct Material {
-	Vector3 diffuse = 1.0f;	
+	Vector3 diffuse = 1.0f;
 	const Texture * texture = nullptr;
 
 	Vector3 reflection = 0.0f;
@@ -13,42 +15,75 @@ struct Material {
 	Vector3 transmittance       = 0.0f;
 	float   index_of_refraction = 1.0f;
 
-	inline Vector3 get_albedo(float u, float v, float ds_dx, float ds_dy, float dt_dx, float dt_dy) const {
-		if (texture) {
-			return diffuse * texture->sample(u, v, ds_dx, ds_dy, dt_dx, dt_dy);
-		}
-
-		return diffuse;
-	}
-	
 	inline static const float air_index_of_refraction = 1.0f;
-	
 };
 
+// All Materials, indexed by Material id. Every property is stored in its own column (SoA),
+// so that the shading code can gather a property for all lanes of a packet at once.
+// The columns grow as Materials are added, which is only allowed while the Scene is loaded
 namespace MaterialBuffer {
-	inline int      material_count = 0;
-	inline Material materials[MAX_MATERIALS];
+	inline int material_count = 0;
 
-	inline int reserve() {
-		if (material_count >= MAX_MATERIALS) {
-			printf("Max Material limit reached!\n");
+	inline std::vector<Vector3>         diffuse;
+	inline std::vector<const Texture *> texture;
+
+	inline std::vector<Vector3> reflection;
 
-			abort();
-		}
+	inline std::vector<Vector3> transmittance;
+	inline std::vector<float>   index_of_refraction;
+
+	// Vector3 columns are gathered as three interleaved float columns
+	static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 should consist of exactly three floats");
+
+	inline int add(const Material & material) {
+		diffuse.push_back(material.diffuse);
+		texture.push_back(material.texture);
+
+		reflection.push_back(material.reflection);
+
+		transmittance      .push_back(material.transmittance);
+		index_of_refraction.push_back(material.index_of_refraction);
 
 		return material_count++;
 	}
 
-	inline void add(const Material & material) {
-		if (material_count >= MAX_MATERIALS) {
-			printf("Max Material limit reached!\n");
+	// Adds a Material with default properties, which can then be changed through the columns
+	inline int reserve() {
+		return add(Material());
+	}
+
+	inline Material get(int material_id) {
+		Material material;
+		material.diffuse = diffuse[material_id];
+		material.texture = texture[material_id];
+
+		material.reflection = reflection[material_id];
+
+		material.transmittance       = transmittance      [material_id];
+		material.index_of_refraction = index_of_refraction[material_id];
+
+		return material;
+	}
+
+	// Gathers a property of the Materials of all lanes. Every lane must contain a valid Material id
+	template<int L>
+	inline SIMD_Vector3<L> gather(const std::vector<Vector3> & column, SIMD_int<L> material_ids) {
+		const float * floats = &column[0].x;
 
-			abort();
-		}
+		SIMD_int<L> offsets = material_ids * SIMD_int<L>(3);
 
-		materials[material_count++] = material;
+		return SIMD_Vector3<L>(
+			SIMD_float_gather(floats,     offsets),
+			SIMD_float_gather(floats + 1, offsets),
+			SIMD_float_gather(floats + 2, offsets)
+		);
 	}
-	
+
+	template<int L>
+	inline SIMD_float<L> gather(const std::vector<float> & column, SIMD_int<L> material_ids) {
+		return SIMD_float_gather(column.data(), material_ids);
+	}
+
 	inline void init() {
 		Material default_material;
 		default_material.diffuse = 0.0f;
@@ -25,14 +25,16 @@ namespace Math {
 
 	// Reflects the vector in the normal
 	// The sign of the normal is irrelevant, but it should be normalized
-	inline FORCEINLINE SIMD_Vector3 reflect(const SIMD_Vector3 & vector, const SIMD_Vector3 & normal) {
-		return vector - (SIMD_float(2.0f) * SIMD_Vector3::dot(vector, normal)) * normal;
+	template<int L>
+	inline FORCEINLINE SIMD_Vector3<L> reflect(const SIMD_Vector3<L> & vector, const SIMD_Vector3<L> & normal) {
+		return vector - (SIMD_float<L>(2.0f) * SIMD_Vector3<L>::dot(vector, normal)) * normal;
 	}
 
 	// Refracts the vector in the normal, according to Snell's Law
 	// The normal should be oriented such that it makes the smallest angle possible with the vector
-	inline FORCEINLINE SIMD_Vector3 refract(const SIMD_Vector3 & vector, const SIMD_Vector3 & normal, SIMD_float eta, SIMD_float cos_theta, SIMD_float k) {
-		return eta * vector + ((eta * cos_theta) - SIMD_float::sqrt(k)) * normal;
+	template<int L>
+	inline FORCEINLINE SIMD_Vector3<L> refract(const SIMD_Vector3<L> & vector, const SIMD_Vector3<L> & normal, SIMD_float<L> eta, SIMD_float<L> cos_theta, SIMD_float<L> k) {
+		return eta * vector + ((eta * cos_theta) - SIMD_float<L>::sqrt(k)) * normal;
 	}
 	
 	// Checks if n is a power of two
@@ -89,9 +91,17 @@ namespace Math {
 	template<>      inline double pow2<1>(double value) { return value; }
 	template<int N> inline double pow2   (double value) { static_assert(is_power_of_two(N)); double sqrt = pow2<N / 2>(value); return sqrt * sqrt; }
 
-	template<int N> inline SIMD_float pow2(SIMD_float value);
-
-	template<>      inline SIMD_float pow2<0>(SIMD_float value) { return SIMD_float(1.0f); }
-	template<>      inline SIMD_float pow2<1>(SIMD_float value) { return value; }
-	template<int N> inline SIMD_float pow2   (SIMD_float value) { static_assert(is_power_of_two(N)); SIMD_float sqrt = pow2<N / 2>(value); return sqrt * sqrt; }
+	// Function templates can not be partially specialized on N, so the recursion for SIMD floats ends using if constexpr
+	template<int N, int L>
+	inline SIMD_float<L> pow2(SIMD_float<L> value) {
+		if constexpr (N == 0) {
+			return SIMD_float<L>(1.0f);
+		} else if constexpr (N == 1) {
+			return value;
+		} else {
+			static_assert(is_power_of_two(N));
+			SIMD_float<L> sqrt = pow2<N / 2>(value);
+			return sqrt * sqrt;
+		}
+	}
 }
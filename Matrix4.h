@@ -36,24 +36,25 @@ struct Matrix4 {
 		);
 	}
 	
-	inline static SIMD_Vector3 transform_position(const Matrix4 & matrix, const SIMD_Vector3 & direction) {
-		SIMD_float matrix_00 = SIMD_float(matrix(0, 0));
-		SIMD_float matrix_01 = SIMD_float(matrix(0, 1));
-		SIMD_float matrix_02 = SIMD_float(matrix(0, 2));
-		SIMD_float matrix_10 = SIMD_float(matrix(1, 0));
-		SIMD_float matrix_11 = SIMD_float(matrix(1, 1));
-		SIMD_float matrix_12 = SIMD_float(matrix(1, 2));
-		SIMD_float matrix_20 = SIMD_float(matrix(2, 0));
-		SIMD_float matrix_21 = SIMD_float(matrix(2, 1));
-		SIMD_float matrix_22 = SIMD_float(matrix(2, 2));
-		SIMD_float matrix_30 = SIMD_float(matrix(3, 0));
-		SIMD_float matrix_31 = SIMD_float(matrix(3, 1));
-		SIMD_float matrix_32 = SIMD_float(matrix(3, 2));
-
-		return SIMD_Vector3(
-			SIMD_float::madd(matrix_00, direction.x, SIMD_float::madd(matrix_10, direction.y, SIMD_float::madd(matrix_20, direction.z, matrix_30))),
-			SIMD_float::madd(matrix_01, direction.x, SIMD_float::madd(matrix_11, direction.y, SIMD_float::madd(matrix_21, direction.z, matrix_31))),
-			SIMD_float::madd(matrix_02, direction.x, SIMD_float::madd(matrix_12, direction.y, SIMD_float::madd(matrix_22, direction.z, matrix_32)))
+	template<int L>
+	inline static SIMD_Vector3<L> transform_position(const Matrix4 & matrix, const SIMD_Vector3<L> & direction) {
+		SIMD_float<L> matrix_00 = SIMD_float<L>(matrix(0, 0));
+		SIMD_float<L> matrix_01 = SIMD_float<L>(matrix(0, 1));
+		SIMD_float<L> matrix_02 = SIMD_float<L>(matrix(0, 2));
+		SIMD_float<L> matrix_10 = SIMD_float<L>(matrix(1, 0));
+		SIMD_float<L> matrix_11 = SIMD_float<L>(matrix(1, 1));
+		SIMD_float<L> matrix_12 = SIMD_float<L>(matrix(1, 2));
+		SIMD_float<L> matrix_20 = SIMD_float<L>(matrix(2, 0));
+		SIMD_float<L> matrix_21 = SIMD_float<L>(matrix(2, 1));
+		SIMD_float<L> matrix_22 = SIMD_float<L>(matrix(2, 2));
+		SIMD_float<L> matrix_30 = SIMD_float<L>(matrix(3, 0));
+		SIMD_float<L> matrix_31 = SIMD_float<L>(matrix(3, 1));
+		SIMD_float<L> matrix_32 = SIMD_float<L>(matrix(3, 2));
+
+		return SIMD_Vector3<L>(
+			SIMD_float<L>::madd(matrix_00, direction.x, SIMD_float<L>::madd(matrix_10, direction.y, SIMD_float<L>::madd(matrix_20, direction.z, matrix_30))),
+			SIMD_float<L>::madd(matrix_01, direction.x, SIMD_float<L>::madd(matrix_11, direction.y, SIMD_float<L>::madd(matrix_21, direction.z, matrix_31))),
+			SIMD_float<L>::madd(matrix_02, direction.x, SIMD_float<L>::madd(matrix_12, direction.y, SIMD_float<L>::madd(matrix_22, direction.z, matrix_32)))
 		);
 	}
 
@@ -66,21 +67,22 @@ struct Matrix4 {
 		);
 	}
 
-	inline static SIMD_Vector3 transform_direction(const Matrix4 & matrix, const SIMD_Vector3 & direction) {
-		SIMD_float matrix_00 = SIMD_float(matrix(0, 0));
-		SIMD_float matrix_01 = SIMD_float(matrix(0, 1));
-		SIMD_float matrix_02 = SIMD_float(matrix(0, 2));
-		SIMD_float matrix_10 = SIMD_float(matrix(1, 0));
-		SIMD_float matrix_11 = SIMD_float(matrix(1, 1));
-		SIMD_float matrix_12 = SIMD_float(matrix(1, 2));
-		SIMD_float matrix_20 = SIMD_float(matrix(2, 0));
-		SIMD_float matrix_21 = SIMD_float(matrix(2, 1));
-		SIMD_float matrix_22 = SIMD_float(matrix(2, 2));
-
-		return SIMD_Vector3(
-			SIMD_float::madd(matrix_00, direction.x, SIMD_float::madd(matrix_10, direction.y, matrix_20 * direction.z)),
-			SIMD_float::madd(matrix_01, direction.x, SIMD_float::madd(matrix_11, direction.y, matrix_21 * direction.z)),
-			SIMD_float::madd(matrix_02, direction.x, SIMD_float::madd(matrix_12, direction.y, matrix_22 * direction.z))
+	template<int L>
+	inline static SIMD_Vector3<L> transform_direction(const Matrix4 & matrix, const SIMD_Vector3<L> & direction) {
+		SIMD_float<L> matrix_00 = SIMD_float<L>(matrix(0, 0));
+		SIMD_float<L> matrix_01 = SIMD_float<L>(matrix(0, 1));
+		SIMD_float<L> matrix_02 = SIMD_float<L>(matrix(0, 2));
+		SIMD_float<L> matrix_10 = SIMD_float<L>(matrix(1, 0));
+		SIMD_float<L> matrix_11 = SIMD_float<L>(matrix(1, 1));
+		SIMD_float<L> matrix_12 = SIMD_float<L>(matrix(1, 2));
+		SIMD_float<L> matrix_20 = SIMD_float<L>(matrix(2, 0));
+		SIMD_float<L> matrix_21 = SIMD_float<L>(matrix(2, 1));
+		SIMD_float<L> matrix_22 = SIMD_float<L>(matrix(2, 2));
+
+		return SIMD_Vector3<L>(
+			SIMD_float<L>::madd(matrix_00, direction.x, SIMD_float<L>::madd(matrix_10, direction.y, matrix_20 * direction.z)),
+			SIMD_float<L>::madd(matrix_01, direction.x, SIMD_float<L>::madd(matrix_11, direction.y, matrix_21 * direction.z)),
+			SIMD_float<L>::madd(matrix_02, direction.x, SIMD_float<L>::madd(matrix_12, direction.y, matrix_22 * direction.z))
 		);
 	}
 
@@ -2,11 +2,13 @@
 
 #include "Math.h"
 
-void Mesh::init(const char * file_path) {
-	bvh = BottomLevelBVH::load(file_path);
+template<int L>
+void Mesh<L>::init(const char * file_path, int bvh_flags) {
+	bvh = BottomLevelBVH<L>::load(file_path, bvh_flags);
 }
 
-void Mesh::update() {
+template<int L>
+void Mesh<L>::update() {
 	transform.calc_world_matrix();
 
 	aabb = AABB::transform(bvh->nodes[0].aabb, transform.world_matrix);
@@ -14,9 +16,34 @@ void Mesh::update() {
 	transform_inv = Matrix4::invert(transform.world_matrix);
 }
 
-void Mesh::trace(const Ray & ray, RayHit & ray_hit, int bvh_step) const {
+template<int L>
+void Mesh<L>::trace(const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const {
 	// Transform the Ray into Model Space using the inverted World Space matrix of the Mesh
-	Ray ray_model_space;
+	Ray<L> ray_model_space;
+	ray_model_space.origin    = Matrix4::transform_position (transform_inv, ray.origin);
+	ray_model_space.direction = Matrix4::transform_direction(transform_inv, ray.direction);
+
+	bvh->trace(ray_model_space, ray_hit, instance_id);
+}
+
+template<int L>
+void Mesh<L>::trace(LargeRayPacket<L> & packet, int first, int instance_id) const {
+	// Transform the Rays into Model Space using the inverted World Space matrix of the Mesh
+	Ray<L> rays_model_space[LargeRayPacket<L>::MAX_PACKET_COUNT];
+
+	for (int p = first; p < packet.packet_count; p++) {
+		rays_model_space[p].origin    = Matrix4::transform_position (transform_inv, packet.rays[p].origin);
+		rays_model_space[p].direction = Matrix4::transform_direction(transform_inv, packet.rays[p].direction);
+	}
+
+	bvh->trace(rays_model_space, packet.hits, first, packet.packet_count, instance_id, packet.node_fetches);
+}
+
+template<int L>
+template<bool PROPAGATE_DIFFERENTIALS>
+void Mesh<L>::evaluate(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const {
+	// Transform the Ray into Model Space, exactly as during traversal so that the distance of the hit remains valid
+	Ray<L> ray_model_space;
 	ray_model_space.origin    = Matrix4::transform_position (transform_inv, ray.origin);
 	ray_model_space.direction = Matrix4::transform_direction(transform_inv, ray.direction);
 
@@ -27,14 +54,48 @@ void Mesh::trace(const Ray & ray, RayHit & ray_hit, int bvh_step) const {
 	ray_model_space.dD_dy = Matrix4::transform_direction(transform_inv, ray.dD_dy);
 #endif
 
-	bvh->trace(ray_model_space, ray_hit, transform.world_matrix);
+	bvh->template evaluate<PROPAGATE_DIFFERENTIALS>(ray_model_space, ray_hit, mask, attributes, transform.world_matrix);
 }
 
-SIMD_float Mesh::intersect(const Ray & ray, SIMD_float max_distance) const {
+template<int L>
+SIMD_float<L> Mesh<L>::intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const {
 	// Transform the Ray into Model Space using the inverted World Space matrix of the Mesh
-	Ray ray_model_space;
+	Ray<L> ray_model_space;
 	ray_model_space.origin    = Matrix4::transform_position (transform_inv, ray.origin);
 	ray_model_space.direction = Matrix4::transform_direction(transform_inv, ray.direction);
 
-	return bvh->intersect(ray_model_space, max_distance);
+	return bvh->intersect(ray_model_space, max_distance, occluder);
 }
+
+template<int L>
+void Mesh<L>::intersect(ShadowRayBatch<L> & batch, int lights, int instance_id) const {
+	// Transform the Rays into Model Space, the origin is shared by all Lights
+	SIMD_Vector3<L> origin_model_space = Matrix4::transform_position(transform_inv, batch.rays[0].origin);
+
+	Ray<L> rays_model_space[SHADOW_RAY_BATCH_SIZE];
+
+	for (int l = 0; l < batch.size; l++) {
+		if ((lights & (1 << l)) == 0) continue;
+
+		rays_model_space[l].origin    = origin_model_space;
+		rays_model_space[l].direction = Matrix4::transform_direction(transform_inv, batch.rays[l].direction);
+	}
+
+	bvh->intersect(rays_model_space, batch, lights, instance_id);
+}
+
+// Tests only the given Triangle of this Mesh. The Occluder is stored in Model Space, so it remains valid when the Mesh moves
+template<int L>
+SIMD_float<L> Mesh<L>::intersect_occluder(const Occluder & occluder, const Ray<L> & ray, SIMD_float<L> max_distance) const {
+	Ray<L> ray_model_space;
+	ray_model_space.origin    = Matrix4::transform_position (transform_inv, ray.origin);
+	ray_model_space.direction = Matrix4::transform_direction(transform_inv, ray.direction);
+
+	return occluder.intersect(ray_model_space, max_distance);
+}
+
+#define INSTANTIATE_MESH(L) \
+	template struct Mesh<L>; \
+	template void Mesh<L>::evaluate<false>(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const; \
+	template void Mesh<L>::evaluate<true> (const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const;
+SIMD_LANE_SIZES(INSTANTIATE_MESH)
@@ -5,21 +5,31 @@
 
 #include "BottomLevelBVH.h"
 
+#include "LargeRayPacket.h"
+
+template<int L>
 struct Mesh {
 	Transform transform;
 	Matrix4 transform_inv;
 
 	AABB aabb;
 	
-	const BottomLevelBVH * bvh = nullptr;
+	const BottomLevelBVH<L> * bvh = nullptr;
 	
-	void init(const char * file_path);
+	void init(const char * file_path, int bvh_flags = 0); // See BottomLevelBVH::FLAG_*
 
 	void update();
 
-	void trace(const Ray & ray, RayHit & ray_hit, int bvh_step) const;
+	void trace(const Ray<L> & ray, RayHit<L> & ray_hit, int instance_id) const;
+	void trace(LargeRayPacket<L> & packet, int first, int instance_id) const; // Only traces the packets from the given one onwards
+
+	SIMD_float<L> intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const;
+
+	void          intersect(ShadowRayBatch<L> & batch, int lights, int instance_id) const;
+
+	SIMD_float<L> intersect_occluder(const Occluder & occluder, const Ray<L> & ray, SIMD_float<L> max_distance) const;
 
-	SIMD_float intersect(const Ray & ray, SIMD_float max_distance) const;
+	template<bool PROPAGATE_DIFFERENTIALS> void evaluate(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const;
 
 	inline Vector3 get_position() const {
 		return transform.position;
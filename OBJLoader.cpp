@@ -5,7 +5,8 @@
 
 #include "Material.h"
 
-static int load_materials(BottomLevelBVH * bvh, std::vector<tinyobj::material_t> & materials, const char * path) {
+template<int L>
+static int load_materials(BottomLevelBVH<L> * bvh, std::vector<tinyobj::material_t> & materials, const char * path) {
 	bvh->material_offset = MaterialBuffer::material_count;
 
 	// Load Materials
@@ -40,7 +41,8 @@ static int load_materials(BottomLevelBVH * bvh, std::vector<tinyobj::material_t>
 	return material_count;
 }
 
-void OBJLoader::load_mtl(BottomLevelBVH * bvh, const char * filename) {
+template<int L>
+void OBJLoader::load_mtl(BottomLevelBVH<L> * bvh, const char * filename) {
 	// Load only the mtl file
 	std::map<std::string, int> material_map;
 	std::vector<tinyobj::material_t> materials;
@@ -66,7 +68,8 @@ void OBJLoader::load_mtl(BottomLevelBVH * bvh, const char * filename) {
 	}
 }
 
-const Triangle * OBJLoader::load_obj(BottomLevelBVH * bvh, const char * filename) {
+template<int L>
+const Triangle * OBJLoader::load_obj(BottomLevelBVH<L> * bvh, const char * filename) {
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
@@ -154,9 +157,11 @@ const Triangle * OBJLoader::load_obj(BottomLevelBVH * bvh, const char * filename
 			triangles[index_triangle].calc_aabb();
 
 			// Store positions, texcoords, and normals in SoA layout in the BVH itself
+#if BVH_LEAF_FORMAT != BVH_LEAF_FORMAT_COMPRESSED
 			bvh->triangles_hot[index_triangle].position_0      = position_0;
 			bvh->triangles_hot[index_triangle].position_edge_1 = position_1 - position_0;
 			bvh->triangles_hot[index_triangle].position_edge_2 = position_2 - position_0;
+#endif
 
 			bvh->triangles_cold[index_triangle].tex_coord_0      = tex_coord_0;
 			bvh->triangles_cold[index_triangle].tex_coord_edge_1 = tex_coord_1 - tex_coord_0;
@@ -185,4 +190,9 @@ const Triangle * OBJLoader::load_obj(BottomLevelBVH * bvh, const char * filename
 	delete [] path;
 
 	return triangles;
-}
\ No newline at end of file
+}
+
+#define INSTANTIATE_OBJ_LOADER(L) \
+	template void             OBJLoader::load_mtl(BottomLevelBVH<L> * bvh, const char * filename); \
+	template const Triangle * OBJLoader::load_obj(BottomLevelBVH<L> * bvh, const char * filename);
+SIMD_LANE_SIZES(INSTANTIATE_OBJ_LOADER)
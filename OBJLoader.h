@@ -2,7 +2,7 @@
 #include "BottomLevelBVH.h"
 
 namespace OBJLoader {
-	void load_mtl(BottomLevelBVH * bvh, const char * filename);
+	template<int L> void load_mtl(BottomLevelBVH<L> * bvh, const char * filename);
 
-	const Triangle * load_obj(BottomLevelBVH * bvh, const char * filename);
+	template<int L> const Triangle * load_obj(BottomLevelBVH<L> * bvh, const char * filename);
 }
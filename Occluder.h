@@ -0,0 +1,19 @@
+#pragma once
+#include "Triangle.h"
+#include "Util.h"
+
+// Triangle that occluded a Shadow Ray, stored in the Model Space of the Mesh it belongs to.
+// Every thread keeps the last Occluder of each Light, since neighbouring Ray packets are usually occluded by the same Triangle
+struct Occluder {
+	int instance_id = INVALID; // Index of the Mesh in the Top Level BVH, INVALID if nothing has been recorded yet
+
+	Vector3 position_0;
+	Vector3 position_edge_1;
+	Vector3 position_edge_2;
+
+	// Checks which lanes of the Ray packet, given in the Model Space of the Mesh, are occluded by this Triangle
+	template<int L>
+	inline SIMD_float<L> intersect(const Ray<L> & ray, SIMD_float<L> max_distance) const {
+		return Triangle::intersect(position_0, position_edge_1, position_edge_2, ray, max_distance);
+	}
+};
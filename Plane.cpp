@@ -10,70 +10,94 @@ void Plane::update() {
 	v_axis = Vector3::cross(u_axis, world_normal);
 }
 
-void Plane::trace(const Ray & ray, RayHit & ray_hit) const {
-	SIMD_Vector3 normal  (world_normal);
-	SIMD_float   distance(world_distance);
+template<int L>
+void Plane::trace(const Ray<L> & ray, RayHit<L> & ray_hit, int id) const {
+	SIMD_Vector3<L> normal  (world_normal);
+	SIMD_float<L>   distance(world_distance);
 
 	// Solve plane equation for t
-	SIMD_float t = -(SIMD_Vector3::dot(normal, ray.origin) + distance) / SIMD_Vector3::dot(normal, ray.direction);
+	SIMD_float<L> t = -(SIMD_Vector3<L>::dot(normal, ray.origin) + distance) / SIMD_Vector3<L>::dot(normal, ray.direction);
 
-	SIMD_float mask = (t > Ray::EPSILON) & (t < ray_hit.distance);
+	SIMD_float<L> mask = (t > SIMD_float<L>(Ray<L>::EPSILON)) & (t < ray_hit.distance);
 
-	if (SIMD_float::all_false(mask)) return;
-
-	const SIMD_float   one (1.0f);
-	const SIMD_Vector3 zero(0.0f);
+	if (SIMD_float<L>::all_false(mask)) return;
 
 	ray_hit.hit      = ray_hit.hit | mask;
-	ray_hit.distance = SIMD_float::blend(ray_hit.distance, t, mask);
+	ray_hit.distance = SIMD_float<L>::blend(ray_hit.distance, t, mask);
+
+	ray_hit.primitive_id = SIMD_int<L>::blend(ray_hit.primitive_id, SIMD_int<L>(id),                           SIMD_float_as_int(mask));
+	ray_hit.instance_id  = SIMD_int<L>::blend(ray_hit.instance_id,  SIMD_int<L>(RayHit<L>::INSTANCE_ID_PLANE), SIMD_float_as_int(mask));
+}
+
+template<bool PROPAGATE_DIFFERENTIALS, int L>
+void Plane::evaluate(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const {
+	const SIMD_float<L>   one (1.0f);
+	const SIMD_Vector3<L> zero(0.0f);
+
+	SIMD_Vector3<L> normal(world_normal);
 
-	ray_hit.point  = SIMD_Vector3::blend(ray_hit.point, ray.origin + t * ray.direction, mask);
-	ray_hit.normal = SIMD_Vector3::blend(ray_hit.normal, normal,                        mask);
+	SIMD_float<L> t = ray_hit.distance;
 
-	ray_hit.material_id = SIMD_int::blend(ray_hit.material_id, SIMD_int(material_id), *reinterpret_cast<SIMD_int *>(&mask));
+	SIMD_Vector3<L> point = ray.origin + t * ray.direction;
 
-	SIMD_Vector3 u(u_axis);
-	SIMD_Vector3 v(v_axis);
+	attributes.point  = SIMD_Vector3<L>::blend(attributes.point,  point,  mask);
+	attributes.normal = SIMD_Vector3<L>::blend(attributes.normal, normal, mask);
+
+	attributes.material_id = SIMD_int<L>::blend(attributes.material_id, SIMD_int<L>(material_id), SIMD_float_as_int(mask));
+
+	SIMD_Vector3<L> u(u_axis);
+	SIMD_Vector3<L> v(v_axis);
 
 	// Obtain u,v by projecting the hit point onto the u and v axes
-	ray_hit.u = SIMD_float::blend(ray_hit.u, SIMD_Vector3::dot(ray_hit.point, u), mask);
-	ray_hit.v = SIMD_float::blend(ray_hit.v, SIMD_Vector3::dot(ray_hit.point, v), mask);
+	attributes.u = SIMD_float<L>::blend(attributes.u, SIMD_Vector3<L>::dot(point, u), mask);
+	attributes.v = SIMD_float<L>::blend(attributes.v, SIMD_Vector3<L>::dot(point, v), mask);
 	
 #if RAY_DIFFERENTIALS_ENABLED
 	// Formulae for Transfer Ray Differential from Igehy 99
-	SIMD_Vector3 dP_dx_plus_t_dD_dx = SIMD_Vector3::madd(ray.dD_dx, t, ray.dO_dx);
-	SIMD_Vector3 dP_dy_plus_t_dD_dy = SIMD_Vector3::madd(ray.dD_dy, t, ray.dO_dy);
+	SIMD_Vector3<L> dP_dx_plus_t_dD_dx = SIMD_Vector3<L>::madd(ray.dD_dx, t, ray.dO_dx);
+	SIMD_Vector3<L> dP_dy_plus_t_dD_dy = SIMD_Vector3<L>::madd(ray.dD_dy, t, ray.dO_dy);
 
-	SIMD_float denom = -one / (SIMD_Vector3::dot(ray.direction, ray_hit.normal) + SIMD_float(1e-8f));
-	SIMD_float dt_dx = SIMD_Vector3::dot(dP_dx_plus_t_dD_dx, ray_hit.normal) * denom;
-	SIMD_float dt_dy = SIMD_Vector3::dot(dP_dy_plus_t_dD_dy, ray_hit.normal) * denom;
+	SIMD_float<L> denom = -one / (SIMD_Vector3<L>::dot(ray.direction, normal) + SIMD_float<L>(1e-8f));
+	SIMD_float<L> dt_dx = SIMD_Vector3<L>::dot(dP_dx_plus_t_dD_dx, normal) * denom;
+	SIMD_float<L> dt_dy = SIMD_Vector3<L>::dot(dP_dy_plus_t_dD_dy, normal) * denom;
 	
-	SIMD_Vector3 dP_dx = SIMD_Vector3::madd(ray.direction, dt_dx, dP_dx_plus_t_dD_dx);
-	SIMD_Vector3 dP_dy = SIMD_Vector3::madd(ray.direction, dt_dy, dP_dy_plus_t_dD_dy);
+	SIMD_Vector3<L> dP_dx = SIMD_Vector3<L>::madd(ray.direction, dt_dx, dP_dx_plus_t_dD_dx);
+	SIMD_Vector3<L> dP_dy = SIMD_Vector3<L>::madd(ray.direction, dt_dy, dP_dy_plus_t_dD_dy);
 
-	ray_hit.dO_dx = SIMD_Vector3::blend(ray_hit.dO_dx, dP_dx, mask);
-	ray_hit.dO_dy = SIMD_Vector3::blend(ray_hit.dO_dy, dP_dy, mask);
+	if constexpr (PROPAGATE_DIFFERENTIALS) {
+		attributes.dO_dx = SIMD_Vector3<L>::blend(attributes.dO_dx, dP_dx, mask);
+		attributes.dO_dy = SIMD_Vector3<L>::blend(attributes.dO_dy, dP_dy, mask);
 
-	// Normal does not depend on screenspace coordinates x,y
-	// Thus, the derivative is zero
-	ray_hit.dN_dx = SIMD_Vector3::blend(ray_hit.dN_dx, zero, mask);
-	ray_hit.dN_dy = SIMD_Vector3::blend(ray_hit.dN_dy, zero, mask);
+		// Normal does not depend on screenspace coordinates x,y
+		// Thus, the derivative is zero
+		attributes.dN_dx = SIMD_Vector3<L>::blend(attributes.dN_dx, zero, mask);
+		attributes.dN_dy = SIMD_Vector3<L>::blend(attributes.dN_dy, zero, mask);
+	}
 
 	// Formulae derived by differentiating the above formulae for u and v
-	ray_hit.ds_dx = SIMD_float::blend(ray_hit.ds_dx, SIMD_Vector3::dot(dP_dx, u), mask);
-	ray_hit.ds_dy = SIMD_float::blend(ray_hit.ds_dy, SIMD_Vector3::dot(dP_dy, u), mask);
+	attributes.ds_dx = SIMD_float<L>::blend(attributes.ds_dx, SIMD_Vector3<L>::dot(dP_dx, u), mask);
+	attributes.ds_dy = SIMD_float<L>::blend(attributes.ds_dy, SIMD_Vector3<L>::dot(dP_dy, u), mask);
 
-	ray_hit.dt_dx = SIMD_float::blend(ray_hit.dt_dx, SIMD_Vector3::dot(dP_dx, v), mask);
-	ray_hit.dt_dy = SIMD_float::blend(ray_hit.dt_dy, SIMD_Vector3::dot(dP_dy, v), mask);
+	attributes.dt_dx = SIMD_float<L>::blend(attributes.dt_dx, SIMD_Vector3<L>::dot(dP_dx, v), mask);
+	attributes.dt_dy = SIMD_float<L>::blend(attributes.dt_dy, SIMD_Vector3<L>::dot(dP_dy, v), mask);
 #endif
 }
 
-SIMD_float Plane::intersect(const Ray & ray, SIMD_float max_distance) const {
-	SIMD_Vector3 normal  (world_normal);
-	SIMD_float   distance(world_distance);
+
+template<int L>
+SIMD_float<L> Plane::intersect(const Ray<L> & ray, SIMD_float<L> max_distance) const {
+	SIMD_Vector3<L> normal  (world_normal);
+	SIMD_float<L>   distance(world_distance);
 
 	// Solve plane equation for t
-	SIMD_float t = -(SIMD_Vector3::dot(normal, ray.origin) + distance) / SIMD_Vector3::dot(normal, ray.direction);
+	SIMD_float<L> t = -(SIMD_Vector3<L>::dot(normal, ray.origin) + distance) / SIMD_Vector3<L>::dot(normal, ray.direction);
 
-	return (t > Ray::EPSILON) & (t < max_distance);
+	return (t > SIMD_float<L>(Ray<L>::EPSILON)) & (t < max_distance);
 }
+
+#define INSTANTIATE_PLANE(L) \
+	template void          Plane::trace          (const Ray<L> & ray, RayHit<L> & ray_hit, int id) const; \
+	template SIMD_float<L> Plane::intersect      (const Ray<L> & ray, SIMD_float<L> max_distance) const; \
+	template void          Plane::evaluate<false>(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const; \
+	template void          Plane::evaluate<true> (const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const;
+SIMD_LANE_SIZES(INSTANTIATE_PLANE)
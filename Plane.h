@@ -3,6 +3,7 @@
 
 #include "Ray.h"
 #include "RayHit.h"
+#include "HitAttributes.h"
 
 struct Plane : Primitive {
 private:
@@ -15,6 +16,8 @@ private:
 public:
 	void update();
 
-	void       trace    (const Ray & ray, RayHit & ray_hit) const;
-	SIMD_float intersect(const Ray & ray, SIMD_float max_distance) const;
+	template<int L> void          trace    (const Ray<L> & ray, RayHit<L> & ray_hit, int id) const;
+	template<int L> SIMD_float<L> intersect(const Ray<L> & ray, SIMD_float<L> max_distance) const;
+
+	template<bool PROPAGATE_DIFFERENTIALS, int L> void evaluate(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const;
 };
@@ -26,19 +26,21 @@ struct PrimitiveList {
 		}
 	}
 
-	inline void trace(const Ray & ray, RayHit & ray_hit) const {
+	template<int L>
+	inline void trace(const Ray<L> & ray, RayHit<L> & ray_hit) const {
 		for (int i = 0; i < primitive_count; i++) {
-			primitives[i].trace(ray, ray_hit);
+			primitives[i].trace(ray, ray_hit, i);
 		}
 	}
 
-	inline SIMD_float intersect(const Ray & ray, SIMD_float max_distance) const {
-		SIMD_float result(0.0f);
+	template<int L>
+	inline SIMD_float<L> intersect(const Ray<L> & ray, SIMD_float<L> max_distance) const {
+		SIMD_float<L> result(0.0f);
 
 		for (int i = 0; i < primitive_count; i++) {
 			result = result | primitives[i].intersect(ray, max_distance);
 
-			if (SIMD_float::all_true(result)) break;
+			if (SIMD_float<L>::all_true(result)) break;
 		}
 
 		return result;
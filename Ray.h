@@ -1,17 +1,18 @@
 #pragma once
 #include "SIMD_Vector3.h"
 
+template<int L>
 struct Ray {
-	inline static const SIMD_float EPSILON = SIMD_float(0.005f);
+	static constexpr float EPSILON = 0.005f;
 
-	SIMD_Vector3 origin;
-	SIMD_Vector3 direction;
+	SIMD_Vector3<L> origin;
+	SIMD_Vector3<L> direction;
 
 #if RAY_DIFFERENTIALS_ENABLED
 	// Ray Differentials with respect to screen space coordinates x, y
-	SIMD_Vector3 dO_dx;
-	SIMD_Vector3 dO_dy;
-	SIMD_Vector3 dD_dx;
-	SIMD_Vector3 dD_dy;
+	SIMD_Vector3<L> dO_dx;
+	SIMD_Vector3<L> dO_dy;
+	SIMD_Vector3<L> dD_dx;
+	SIMD_Vector3<L> dD_dy;
 #endif
 };
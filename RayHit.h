@@ -1,36 +1,49 @@
 #pragma once
 #include "SIMD_Vector3.h"
 
+// Result of tracing a Ray through the Scene. Only stores what is needed to identify the closest hit,
+// the shading attributes are evaluated once after traversal has finished (see HitAttributes)
+template<int L>
 struct RayHit {
-	SIMD_float hit;
-	SIMD_float distance;
+	static const int INSTANCE_ID_SPHERE = -1;
+	static const int INSTANCE_ID_PLANE  = -2;
 
-	SIMD_Vector3 point;  // Coordinates of the hit in World Space
-	SIMD_Vector3 normal; // Normal      of the hit in World Space
+	SIMD_float<L> hit;
+	SIMD_float<L> distance;
 
-	SIMD_int   material_id;
-	SIMD_float u, v;
+	SIMD_float<L> u, v; // Barycentric coordinates of the hit, only used by Triangles
 
-#if RAY_DIFFERENTIALS_ENABLED
-	// Derivatives of texture space coordinates s, t
-	// with respect to screen space coordinates x, y
-	SIMD_float ds_dx, ds_dy;
-	SIMD_float dt_dx, dt_dy;
+	SIMD_int<L> primitive_id; // Index of the Sphere or Plane, or of the Triangle within the Bottom Level BVH
+	SIMD_int<L> instance_id;  // Index of the Mesh in the Top Level BVH, or INSTANCE_ID_SPHERE / INSTANCE_ID_PLANE
 
-	SIMD_Vector3 dO_dx, dO_dy;
-	SIMD_Vector3 dN_dx, dN_dy;
+#if BVH_COUNT_NODE_FETCHES && !PRIMARY_RAY_LARGE_PACKETS
+	int node_fetches; // Number of BVH Nodes fetched during traversal, only reported for primary Rays
 #endif
 
 #if BVH_VISUALIZE_HEATMAP
 	int bvh_steps;
 #endif
 
+#if BVH_HYBRID_TRAVERSAL
+	int packet_traversals;     // Number of Bottom Level BVHs traversed by the packet as a whole
+	int single_ray_traversals; // Number of Bottom Level BVHs traversed by a single lane, see BottomLevelBVH::trace
+#endif
+
 	inline RayHit() {
-		hit      = SIMD_float(0.0f);
-		distance = SIMD_float(INFINITY);
+		hit      = SIMD_float<L>(0.0f);
+		distance = SIMD_float<L>(INFINITY);
+
+#if BVH_COUNT_NODE_FETCHES && !PRIMARY_RAY_LARGE_PACKETS
+		node_fetches = 0;
+#endif
 
 #if BVH_VISUALIZE_HEATMAP
 		bvh_steps = 0;
 #endif
+
+#if BVH_HYBRID_TRAVERSAL
+		packet_traversals     = 0;
+		single_ray_traversals = 0;
+#endif
 	}
 };
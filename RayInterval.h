@@ -0,0 +1,81 @@
+#pragma once
+#include "Ray.h"
+
+// Conservative bounds over all lanes of a Ray packet, computed once at the start of BVH traversal.
+// Allows Nodes to be rejected for the entire packet using a single interval arithmetic test,
+// before doing the more expensive per lane slab test (see AABB::intersect)
+struct RayInterval {
+	// Bounds of the origins along every axis that give the smallest entry and the largest exit distance
+	Vector3 origin_near;
+	Vector3 origin_far;
+
+	Vector3 inv_direction_min;
+	Vector3 inv_direction_max;
+
+	// The interval test is only valid if the direction of all lanes has the same sign along every axis
+	bool is_coherent;
+
+	// Sign of the direction along every axis that the majority of lanes agrees on, used to order traversal
+	bool direction_positive[3];
+
+	inline RayInterval() = default;
+
+	template<int L>
+	inline RayInterval(const Ray<L> & ray, const SIMD_Vector3<L> & inv_direction) : RayInterval(&ray, &inv_direction, 1) { }
+
+	// Bounds over all lanes of multiple packets, see LargeRayPacket
+	template<int L>
+	inline RayInterval(const Ray<L> rays[], const SIMD_Vector3<L> inv_directions[], int packet_count) {
+		const SIMD_float<L> zero(0.0f);
+
+		int positive_lane_count[3] = { 0, 0, 0 };
+
+		Vector3 origin_min(+INFINITY);
+		Vector3 origin_max(-INFINITY);
+
+		inv_direction_min = Vector3(+INFINITY);
+		inv_direction_max = Vector3(-INFINITY);
+
+		for (int p = 0; p < packet_count; p++) {
+			const Ray<L> & ray = rays[p];
+
+			int sign_masks[3] = {
+				SIMD_float<L>::mask(ray.direction.x > zero),
+				SIMD_float<L>::mask(ray.direction.y > zero),
+				SIMD_float<L>::mask(ray.direction.z > zero)
+			};
+
+			for (int dimension = 0; dimension < 3; dimension++) {
+				for (int i = 0; i < L; i++) {
+					if (sign_masks[dimension] & (1 << i)) positive_lane_count[dimension]++;
+				}
+			}
+
+			origin_min = Vector3::min(origin_min, Vector3(SIMD_float<L>::hmin(ray.origin.x), SIMD_float<L>::hmin(ray.origin.y), SIMD_float<L>::hmin(ray.origin.z)));
+			origin_max = Vector3::max(origin_max, Vector3(SIMD_float<L>::hmax(ray.origin.x), SIMD_float<L>::hmax(ray.origin.y), SIMD_float<L>::hmax(ray.origin.z)));
+
+			const SIMD_Vector3<L> & inv_direction = inv_directions[p];
+
+			inv_direction_min = Vector3::min(inv_direction_min, Vector3(SIMD_float<L>::hmin(inv_direction.x), SIMD_float<L>::hmin(inv_direction.y), SIMD_float<L>::hmin(inv_direction.z)));
+			inv_direction_max = Vector3::max(inv_direction_max, Vector3(SIMD_float<L>::hmax(inv_direction.x), SIMD_float<L>::hmax(inv_direction.y), SIMD_float<L>::hmax(inv_direction.z)));
+		}
+
+		int lane_count = packet_count * L;
+
+		is_coherent = true;
+
+		for (int dimension = 0; dimension < 3; dimension++) {
+			direction_positive[dimension] = 2 * positive_lane_count[dimension] >= lane_count;
+
+			is_coherent &= positive_lane_count[dimension] == 0 || positive_lane_count[dimension] == lane_count;
+
+			origin_near[dimension] = direction_positive[dimension] ? origin_max[dimension] : origin_min[dimension];
+			origin_far [dimension] = direction_positive[dimension] ? origin_min[dimension] : origin_max[dimension];
+		}
+
+		// Directions that are zero along an axis have an infinite inverse, for which the interval bounds would not be valid
+		for (int dimension = 0; dimension < 3; dimension++) {
+			is_coherent &= fabsf(inv_direction_min[dimension]) < INFINITY && fabsf(inv_direction_max[dimension]) < INFINITY;
+		}
+	}
+};
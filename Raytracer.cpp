@@ -1,400 +1,1307 @@
 #include "Raytracer.h"
 
-void Raytracer::render_tile(const Window & window, int tile_x, int tile_y, int tile_width, int tile_height, PerformanceStats & stats) const {
-	Ray ray;
-	ray.origin.x = SIMD_float(scene->camera.position.x);
-	ray.origin.y = SIMD_float(scene->camera.position.y);
-	ray.origin.z = SIMD_float(scene->camera.position.z);
-	
+// Looks up the albedo of the Material of every lane that hit something. Lanes that missed get Material 0 and a black albedo.
+// Lanes are grouped by Texture, so that every Texture is sampled once for all lanes that use it
+template<int L>
+static SIMD_Vector3<L> sample_albedo(HitAttributes<L> & hit_attributes, int hit_mask) {
+	for (int i = 0; i < L; i++) {
+		if ((hit_mask & (1 << i)) == 0) hit_attributes.material_id[i] = 0;
+	}
+
+	SIMD_Vector3<L> material_diffuse = MaterialBuffer::gather(MaterialBuffer::diffuse, hit_attributes.material_id);
+
+	const Texture * textures[L];
+	int             texture_count = 0;
+
+	// Index into textures for every lane, or -1 if its Material has no Texture
+	SIMD_float<L> texture_indices(-1.0f);
+
+	for (int i = 0; i < L; i++) {
+		const Texture * texture = MaterialBuffer::texture[hit_attributes.material_id[i]];
+		if (texture == nullptr) continue;
+
+		int index = 0;
+		while (index < texture_count && textures[index] != texture) index++;
+
+		if (index == texture_count) textures[texture_count++] = texture;
+
+		texture_indices[i] = float(index);
+	}
+
+	for (int i = 0; i < texture_count; i++) {
+		SIMD_float<L> mask = texture_indices == SIMD_float<L>(float(i));
+
 #if RAY_DIFFERENTIALS_ENABLED
-	ray.dO_dx = SIMD_Vector3(0.0f);
-	ray.dO_dy = SIMD_Vector3(0.0f);
+		SIMD_Vector3<L> albedo = textures[i]->sample(
+			hit_attributes.u,     hit_attributes.v, 
+			hit_attributes.ds_dx, hit_attributes.ds_dy, 
+			hit_attributes.dt_dx, hit_attributes.dt_dy, 
+			mask
+		);
+#else
+		SIMD_Vector3<L> albedo = textures[i]->sample(hit_attributes.u, hit_attributes.v, SIMD_float<L>(0.0f), SIMD_float<L>(0.0f), SIMD_float<L>(0.0f), SIMD_float<L>(0.0f), mask);
 #endif
 
-#if SIMD_LANE_SIZE == 1
-	const int step_x = 1;
-	const int step_y = 1;
-#elif SIMD_LANE_SIZE == 4
-	const int step_x = 2;
-	const int step_y = 2;
-#elif SIMD_LANE_SIZE == 8
-	const int step_x = 4;
-	const int step_y = 2;
-#endif
+		material_diffuse = SIMD_Vector3<L>::blend(material_diffuse, material_diffuse * albedo, mask);
+	}
 
-	assert(tile_width  % step_x == 0);
-	assert(tile_height % step_y == 0);
-	
-	for (int j = tile_y; j < tile_y + tile_height; j += step_y) {
-		for (int i = tile_x; i < tile_x + tile_width; i += step_x) {
-			float i_f = float(i);
-			float j_f = float(j);
+	return material_diffuse;
+}
+
+#if RAYTRACER_WAVEFRONT && WAVEFRONT_MATERIAL_SORTING
+// Samples the albedo of a packet in which all lanes share the same Material, see Raytracer::render_tile_wavefront
+template<int L>
+static SIMD_Vector3<L> sample_albedo(const Material & material, const HitAttributes<L> & hit_attributes, int hit_mask) {
+	if (material.texture == nullptr) return SIMD_Vector3<L>(material.diffuse);
+
+	SIMD_float<L> lane_bits;
+	for (int i = 0; i < L; i++) {
+		lane_bits[i] = (hit_mask & (1 << i)) ? 1.0f : 0.0f;
+	}
 
-			// Calulcate pixel coordinates for all pixels in the current Ray Packet
-#if SIMD_LANE_SIZE == 1
-			SIMD_float is(i_f);
-			SIMD_float js(j_f);
-#elif SIMD_LANE_SIZE == 4
-			SIMD_float is(i_f, i_f + 1.0f, i_f,        i_f + 1.0f);
-			SIMD_float js(j_f, j_f,        j_f + 1.0f, j_f + 1.0f);
-#elif SIMD_LANE_SIZE == 8
-			SIMD_float is(i_f, i_f + 1.0f, i_f + 2.0f, i_f + 3.0f, i_f,        i_f + 1.0f, i_f + 2.0f, i_f + 3.0f);
-			SIMD_float js(j_f, j_f,        j_f,        j_f,        j_f + 1.0f, j_f + 1.0f, j_f + 1.0f, j_f + 1.0f);
+	SIMD_float<L> mask = lane_bits > SIMD_float<L>(0.0f);
+
+#if RAY_DIFFERENTIALS_ENABLED
+	SIMD_Vector3<L> albedo = material.texture->sample(
+		hit_attributes.u,     hit_attributes.v, 
+		hit_attributes.ds_dx, hit_attributes.ds_dy, 
+		hit_attributes.dt_dx, hit_attributes.dt_dy, 
+		mask
+	);
+#else
+	SIMD_Vector3<L> albedo = material.texture->sample(hit_attributes.u, hit_attributes.v, SIMD_float<L>(0.0f), SIMD_float<L>(0.0f), SIMD_float<L>(0.0f), SIMD_float<L>(0.0f), mask);
 #endif
 
-			SIMD_Vector3 direction = 
-				SIMD_Vector3::madd(scene->camera.rotated_x_axis, is, 
-				SIMD_Vector3::madd(scene->camera.rotated_y_axis, js, scene->camera.rotated_top_left_corner));
+	return SIMD_Vector3<L>(material.diffuse) * albedo;
+}
+#endif
 
-			SIMD_float          d_dot_d = SIMD_Vector3::dot(direction, direction);
-			SIMD_float inv_sqrt_d_dot_d = SIMD_float::inv_sqrt(d_dot_d);
+template<int L>
+static Ray<L> get_reflected_ray(const Ray<L> & ray, const HitAttributes<L> & hit_attributes) {
+	Ray<L> reflected_ray;
+	reflected_ray.origin    = hit_attributes.point;
+	reflected_ray.direction = Math::reflect(ray.direction, hit_attributes.normal);
 
-			SIMD_float denom = inv_sqrt_d_dot_d / d_dot_d; // d_dot_d ^ -3/2
+#if RAY_DIFFERENTIALS_ENABLED
+	reflected_ray.dO_dx = hit_attributes.dO_dx;
+	reflected_ray.dO_dy = hit_attributes.dO_dy;
+
+	SIMD_float<L> dDN_dx = SIMD_Vector3<L>::dot(ray.dD_dx, hit_attributes.normal) + SIMD_Vector3<L>::dot(ray.direction, hit_attributes.dN_dx);
+	SIMD_float<L> dDN_dy = SIMD_Vector3<L>::dot(ray.dD_dy, hit_attributes.normal) + SIMD_Vector3<L>::dot(ray.direction, hit_attributes.dN_dy);
+
+	reflected_ray.dD_dx = ray.dD_dx - SIMD_float<L>(2.0f) * (SIMD_Vector3<L>::dot(ray.direction, hit_attributes.normal) * hit_attributes.dN_dx + dDN_dx * hit_attributes.normal);
+	reflected_ray.dD_dy = ray.dD_dy - SIMD_float<L>(2.0f) * (SIMD_Vector3<L>::dot(ray.direction, hit_attributes.normal) * hit_attributes.dN_dy + dDN_dy * hit_attributes.normal);
+#endif
+
+	return reflected_ray;
+}
+
+template<int L>
+static Ray<L> get_refracted_ray(const Ray<L> & ray, const HitAttributes<L> & hit_attributes, const SIMD_Vector3<L> & normal, SIMD_float<L> eta, SIMD_float<L> cos_theta, SIMD_float<L> k) {
+	Ray<L> refracted_ray;
+	refracted_ray.origin    = hit_attributes.point;
+	refracted_ray.direction = Math::refract(ray.direction, normal, eta, cos_theta, k);
 
 #if RAY_DIFFERENTIALS_ENABLED
-			ray.dD_dx = (d_dot_d * scene->camera.rotated_x_axis - SIMD_Vector3::dot(direction, scene->camera.rotated_x_axis) * direction) * denom;
-			ray.dD_dy = (d_dot_d * scene->camera.rotated_y_axis - SIMD_Vector3::dot(direction, scene->camera.rotated_y_axis) * direction) * denom;
+	refracted_ray.dO_dx = hit_attributes.dO_dx;
+	refracted_ray.dO_dy = hit_attributes.dO_dy;
+
+	SIMD_float<L> dDN_dx = SIMD_Vector3<L>::dot(ray.dD_dx, hit_attributes.normal) + SIMD_Vector3<L>::dot(ray.direction, hit_attributes.dN_dx);
+	SIMD_float<L> dDN_dy = SIMD_Vector3<L>::dot(ray.dD_dy, hit_attributes.normal) + SIMD_Vector3<L>::dot(ray.direction, hit_attributes.dN_dy);
+
+	SIMD_float<L> D_dot_N      = -cos_theta;
+	SIMD_float<L> Dprime_dot_N = -SIMD_float<L>::sqrt(k);
+
+	SIMD_float<L> mu = -(eta * cos_theta + Dprime_dot_N);
+
+	SIMD_float<L> factor = (eta + (eta*eta * cos_theta) / Dprime_dot_N);
+	SIMD_float<L> dmu_dx = factor * dDN_dx;
+	SIMD_float<L> dmu_dy = factor * dDN_dy;
+
+	refracted_ray.dD_dx = eta * ray.dD_dx - (mu * D_dot_N + hit_attributes.dN_dx * hit_attributes.normal) * dDN_dx;
+	refracted_ray.dD_dy = eta * ray.dD_dy - (mu * D_dot_N + hit_attributes.dN_dy * hit_attributes.normal) * dDN_dy;
 #endif
 
-			ray.direction = direction * inv_sqrt_d_dot_d; // Normalize direction
+	return refracted_ray;
+}
 
-			stats.num_primary_rays++;
+#if BOUNCE_TERMINATION
+// Retires the lanes of a reflected or refracted Ray whose weight is too small for them to visibly contribute to their pixel
+template<int L>
+static SIMD_float<L> terminate_lanes(SIMD_float<L> mask, const SIMD_Vector3<L> & weight, PerformanceStats & stats) {
+	SIMD_float<L> max_weight = SIMD_float<L>::max(SIMD_float<L>::max(weight.x, weight.y), weight.z);
 
-			SIMD_float distance;
-			SIMD_Vector3 colour = bounce(ray, NUMBER_OF_BOUNCES, distance, stats);
-
-#if SIMD_LANE_SIZE == 1
-			window.plot(i, j, Vector3(colour.x[0], colour.y[0], colour.z[0]));
-#elif SIMD_LANE_SIZE == 4
-			window.plot(i,     j,     Vector3(colour.x[3], colour.y[3], colour.z[3]));
-			window.plot(i + 1, j,     Vector3(colour.x[2], colour.y[2], colour.z[2]));
-			window.plot(i,     j + 1, Vector3(colour.x[1], colour.y[1], colour.z[1]));
-			window.plot(i + 1, j + 1, Vector3(colour.x[0], colour.y[0], colour.z[0]));
-#elif SIMD_LANE_SIZE == 8
-			window.plot(i,     j,     Vector3(colour.x[7], colour.y[7], colour.z[7]));
-			window.plot(i + 1, j,     Vector3(colour.x[6], colour.y[6], colour.z[6]));
-			window.plot(i + 2, j,     Vector3(colour.x[5], colour.y[5], colour.z[5]));
-			window.plot(i + 3, j,     Vector3(colour.x[4], colour.y[4], colour.z[4]));
-			window.plot(i,     j + 1, Vector3(colour.x[3], colour.y[3], colour.z[3]));
-			window.plot(i + 1, j + 1, Vector3(colour.x[2], colour.y[2], colour.z[2]));
-			window.plot(i + 2, j + 1, Vector3(colour.x[1], colour.y[1], colour.z[1]));
-			window.plot(i + 3, j + 1, Vector3(colour.x[0], colour.y[0], colour.z[0]));
+	SIMD_float<L> active_mask = mask & (max_weight >= SIMD_float<L>(BOUNCE_TERMINATION_THRESHOLD));
+
+	stats.num_bounce_lanes_terminated += _mm_popcnt_u32(SIMD_float<L>::mask(mask) & ~SIMD_float<L>::mask(active_mask));
+
+	return active_mask;
+}
 #endif
+
+// Pushes a secondary Ray onto the Ray stack of the thread, see Raytracer::shade
+template<int L>
+static void push_ray(ThreadState<L> & thread_state, const Ray<L> & ray, SIMD_float<L> max_distance, const SIMD_Vector3<L> & weight, const SIMD_Vector3<L> & absorption, int bounces_left) {
+	assert(thread_state.ray_stack_size < RAY_STACK_SIZE);
+
+	PendingRay<L> & pending = thread_state.ray_stack[thread_state.ray_stack_size++];
+	pending.ray          = ray;
+	pending.max_distance = max_distance;
+	pending.weight       = weight;
+	pending.absorption   = absorption;
+	pending.bounces_left = bounces_left;
+}
+
+// Size of the block of pixels covered by a primary Ray packet
+template<int L> static constexpr int step_x = L == 1 ? 1 : L == 4 ? 2 : 4;
+template<int L> static constexpr int step_y = L / step_x<L>;
+
+static_assert(PRIMARY_RAY_LARGE_PACKET_SIZE % step_x<16> == 0 && PRIMARY_RAY_LARGE_PACKET_SIZE % step_y<16> == 0, "Large packets should consist of whole SIMD packets");
+
+// Generates the packet of primary Rays for the block of step_x by step_y pixels with the given top left corner
+template<int L>
+static Ray<L> generate_primary_ray(const Camera & camera, int i, int j) {
+	Ray<L> ray;
+	ray.origin.x = SIMD_float<L>(camera.position.x);
+	ray.origin.y = SIMD_float<L>(camera.position.y);
+	ray.origin.z = SIMD_float<L>(camera.position.z);
+
+	float i_f = float(i);
+	float j_f = float(j);
+
+	// Calulcate pixel coordinates for all pixels in the current Ray Packet, the first pixel of the block is stored in the last lane
+	SIMD_float<L> is;
+	SIMD_float<L> js;
+	for (int lane = 0; lane < L; lane++) {
+		int index = L - 1 - lane;
+
+		is[lane] = i_f + float(index % step_x<L>);
+		js[lane] = j_f + float(index / step_x<L>);
+	}
+
+	SIMD_Vector3<L> x_axis(camera.rotated_x_axis);
+	SIMD_Vector3<L> y_axis(camera.rotated_y_axis);
+
+	SIMD_Vector3<L> direction = 
+		SIMD_Vector3<L>::madd(x_axis, is, 
+		SIMD_Vector3<L>::madd(y_axis, js, SIMD_Vector3<L>(camera.rotated_top_left_corner)));
+
+	SIMD_float<L>          d_dot_d = SIMD_Vector3<L>::dot(direction, direction);
+	SIMD_float<L> inv_sqrt_d_dot_d = SIMD_float<L>::inv_sqrt(d_dot_d);
+
+	SIMD_float<L> denom = inv_sqrt_d_dot_d / d_dot_d; // d_dot_d ^ -3/2
+
+#if RAY_DIFFERENTIALS_ENABLED
+	ray.dO_dx = SIMD_Vector3<L>(0.0f);
+	ray.dO_dy = SIMD_Vector3<L>(0.0f);
+	ray.dD_dx = (d_dot_d * x_axis - SIMD_Vector3<L>::dot(direction, x_axis) * direction) * denom;
+	ray.dD_dy = (d_dot_d * y_axis - SIMD_Vector3<L>::dot(direction, y_axis) * direction) * denom;
+#endif
+
+	ray.direction = direction * inv_sqrt_d_dot_d; // Normalize direction
+
+	return ray;
+}
+
+// Plots the colours of a packet generated by generate_primary_ray, the first pixel of the block is stored in the last lane
+template<int L>
+static void plot_packet(const Window & window, int i, int j, const SIMD_Vector3<L> & colour) {
+	for (int lane = 0; lane < L; lane++) {
+		int index = L - 1 - lane;
+
+		window.plot(i + index % step_x<L>, j + index / step_x<L>, Vector3(colour.x[lane], colour.y[lane], colour.z[lane]));
+	}
+}
+
+template<int L>
+void Raytracer<L>::init(const Scene<L> * scene) {
+	this->scene = scene;
+
+	bool has_refraction = false;
+
+	for (int i = 0; i < MaterialBuffer::material_count; i++) {
+		const Vector3 & transmittance = MaterialBuffer::transmittance[i];
+
+		if (transmittance.x > 0.0f || transmittance.y > 0.0f || transmittance.z > 0.0f) {
+			has_refraction = true;
+
+			break;
 		}
 	}
+
+	shade_kernel = has_refraction ? &Raytracer<L>::shade<true> : &Raytracer<L>::shade<false>;
 }
 
-SIMD_Vector3 Raytracer::bounce(const Ray & ray, int bounces_left, SIMD_float & distance, PerformanceStats & stats) const {
-	SIMD_Vector3 result;
-	
-	const SIMD_float zero(0.0f);
-	const SIMD_float one (1.0f);
-	const SIMD_float inf (INFINITY);
+template<int L>
+void Raytracer<L>::render_tile(const Window & window, int tile_x, int tile_y, int tile_width, int tile_height, PerformanceStats & stats, ThreadState<L> & thread_state) const {
+#if LIGHT_CULLING
+	// Find the Lights that can affect the primary hits of this tile, using the four side planes of its frustum
+	const Camera & camera = scene->camera;
+
+	const Vector3 & top_left_corner = camera.rotated_top_left_corner;
+	const Vector3 & x_axis          = camera.rotated_x_axis;
+	const Vector3 & y_axis          = camera.rotated_y_axis;
+
+	Vector3 corners[4] = {
+		top_left_corner + float(tile_x)              * x_axis + float(tile_y)               * y_axis,
+		top_left_corner + float(tile_x + tile_width) * x_axis + float(tile_y)               * y_axis,
+		top_left_corner + float(tile_x + tile_width) * x_axis + float(tile_y + tile_height) * y_axis,
+		top_left_corner + float(tile_x)              * x_axis + float(tile_y + tile_height) * y_axis
+	};
+	Vector3 center = 0.25f * (corners[0] + corners[1] + corners[2] + corners[3]);
+
+	Vector3 plane_normals[4];
+	for (int i = 0; i < 4; i++) {
+		plane_normals[i] = Vector3::normalize(Vector3::cross(corners[i], corners[(i + 1) & 3]));
+
+		// Make sure the normal points into the frustum
+		if (Vector3::dot(plane_normals[i], center) < 0.0f) {
+			plane_normals[i] = -plane_normals[i];
+		}
+	}
 
-	RayHit closest_hit;
-	scene->trace_primitives(ray, closest_hit);
+	thread_state.tile_light_count = scene->light_bvh.query(camera.position, plane_normals, 4, thread_state.tile_lights);
+#endif
+
+#if RAYTRACER_WAVEFRONT
+	render_tile_wavefront(window, tile_x, tile_y, tile_width, tile_height, stats, thread_state);
+#else
+	assert(tile_width  % step_x<L> == 0);
+	assert(tile_height % step_y<L> == 0);
 
+#if PRIMARY_RAY_LARGE_PACKETS
+	LargeRayPacket<L> packet;
+
+	for (int block_y = tile_y; block_y < tile_y + tile_height; block_y += PRIMARY_RAY_LARGE_PACKET_SIZE) {
+		for (int block_x = tile_x; block_x < tile_x + tile_width; block_x += PRIMARY_RAY_LARGE_PACKET_SIZE) {
+			// Blocks at the edge of the tile are clipped, their size remains a multiple of step_x and step_y
+			int block_width  = std::min(PRIMARY_RAY_LARGE_PACKET_SIZE, tile_x + tile_width  - block_x);
+			int block_height = std::min(PRIMARY_RAY_LARGE_PACKET_SIZE, tile_y + tile_height - block_y);
+
+			packet.packet_count = 0;
+			packet.node_fetches = 0;
+
+			for (int j = block_y; j < block_y + block_height; j += step_y<L>) {
+				for (int i = block_x; i < block_x + block_width; i += step_x<L>) {
+					packet.rays[packet.packet_count] = generate_primary_ray<L>(scene->camera, i, j);
+					packet.hits[packet.packet_count] = RayHit<L>();
+
+					packet.packet_count++;
+				}
+			}
+
+			scene->trace_primitives(packet);
+
+			stats.num_primary_rays += packet.packet_count;
+#if BVH_COUNT_NODE_FETCHES
+			stats.num_primary_node_fetches += packet.node_fetches;
+#endif
+
+			int p = 0;
+
+			for (int j = block_y; j < block_y + block_height; j += step_y<L>) {
+				for (int i = block_x; i < block_x + block_width; i += step_x<L>) {
+					SIMD_Vector3<L> colour = (this->*shade_kernel)(packet.rays[p], packet.hits[p], stats, thread_state);
+
+					plot_packet(window, i, j, colour);
+
+					p++;
+				}
+			}
+		}
+	}
+#else
+	for (int j = tile_y; j < tile_y + tile_height; j += step_y<L>) {
+		for (int i = tile_x; i < tile_x + tile_width; i += step_x<L>) {
+			Ray<L> ray = generate_primary_ray<L>(scene->camera, i, j);
+
+			stats.num_primary_rays++;
+
+			RayHit<L> closest_hit;
+			scene->trace_primitives(ray, closest_hit);
+
+#if BVH_COUNT_NODE_FETCHES
+			stats.num_primary_node_fetches += closest_hit.node_fetches;
+#endif
+
+			SIMD_Vector3<L> colour = (this->*shade_kernel)(ray, closest_hit, stats, thread_state);
+
+			plot_packet(window, i, j, colour);
+		}
+	}
+#endif
+#endif
+}
+
+template<int L>
+template<bool HAS_REFRACTION>
+SIMD_Vector3<L> Raytracer<L>::shade(const Ray<L> & ray, const RayHit<L> & closest_hit, PerformanceStats & stats, ThreadState<L> & thread_state) const {
 #if BVH_VISUALIZE_HEATMAP
 	const float one_over_32  = 1.0f / 32.0f;
 	const float one_over_256 = 1.0f / 256.0f;
 	const float one_over_512 = 1.0f / 512.0f;
-	return SIMD_Vector3(Vector3(closest_hit.bvh_steps * one_over_32, closest_hit.bvh_steps * one_over_256, closest_hit.bvh_steps * one_over_512));
+	return SIMD_Vector3<L>(Vector3(closest_hit.bvh_steps * one_over_32, closest_hit.bvh_steps * one_over_256, closest_hit.bvh_steps * one_over_512));
+#endif
+
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> inf (INFINITY);
+
+	thread_state.ray_stack_size = 0;
+
+	SIMD_Vector3<L> colour = number_of_bounces > 0 ?
+		bounce<false, HAS_REFRACTION>(ray, closest_hit, SIMD_Vector3<L>(1.0f), number_of_bounces, stats, thread_state) :
+		bounce<true,  HAS_REFRACTION>(ray, closest_hit, SIMD_Vector3<L>(1.0f), number_of_bounces, stats, thread_state);
+
+	// Trace the secondary Rays depth first, until none are left
+	while (thread_state.ray_stack_size > 0) {
+		PendingRay<L> pending = thread_state.ray_stack[--thread_state.ray_stack_size];
+
+		RayHit<L> closest_hit;
+		closest_hit.distance = pending.max_distance;
+
+		scene->trace_primitives(pending.ray, closest_hit);
+
+		// Apply Beer's Law, now that the distance travelled through the medium is known
+		SIMD_float<L> distance = SIMD_float<L>::blend(inf, closest_hit.distance, closest_hit.hit);
+
+		SIMD_Vector3<L> & weight = pending.weight;
+		weight.x = SIMD_float<L>::blend(weight.x, weight.x * SIMD_Math::exp(pending.absorption.x * distance), pending.absorption.x != zero);
+		weight.y = SIMD_float<L>::blend(weight.y, weight.y * SIMD_Math::exp(pending.absorption.y * distance), pending.absorption.y != zero);
+		weight.z = SIMD_float<L>::blend(weight.z, weight.z * SIMD_Math::exp(pending.absorption.z * distance), pending.absorption.z != zero);
+
+		SIMD_Vector3<L> colour_bounce = pending.bounces_left > 0 ?
+			bounce<false, HAS_REFRACTION>(pending.ray, closest_hit, weight, pending.bounces_left, stats, thread_state) :
+			bounce<true,  HAS_REFRACTION>(pending.ray, closest_hit, weight, pending.bounces_left, stats, thread_state);
+
+		// Retired lanes have an undefined colour
+		colour = SIMD_Vector3<L>::blend(colour, SIMD_Vector3<L>::madd(colour_bounce, weight, colour), pending.max_distance > zero);
+	}
+
+	return colour;
+}
+
+template<int L>
+template<bool IS_LAST_BOUNCE, bool HAS_REFRACTION>
+SIMD_Vector3<L> Raytracer<L>::bounce(const Ray<L> & ray, const RayHit<L> & closest_hit, const SIMD_Vector3<L> & weight, int bounces_left, PerformanceStats & stats, ThreadState<L> & thread_state) const {
+	SIMD_Vector3<L> result;
+	
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+	const SIMD_float<L> two (2.0f);
+	const SIMD_float<L> inf (INFINITY);
+
+#if BVH_HYBRID_TRAVERSAL
+	stats.num_packet_traversals     += closest_hit.packet_traversals;
+	stats.num_single_ray_traversals += closest_hit.single_ray_traversals;
 #endif
 
 	// If any of the Rays did not hit
-	if (!SIMD_float::all_true(closest_hit.hit)) {
-		result = SIMD_Vector3::blend(scene->sky.sample(ray.direction), result, closest_hit.hit);
-		distance = inf;
+	if (!SIMD_float<L>::all_true(closest_hit.hit)) {
+		result = SIMD_Vector3<L>::blend(scene->sky.sample(ray.direction), result, closest_hit.hit);
 
 		// If none of the Rays hit, early out
-		if (SIMD_float::all_false(closest_hit.hit)) return result;
+		if (SIMD_float<L>::all_false(closest_hit.hit)) return result;
 	}
 
-	distance = SIMD_float::blend(distance, closest_hit.distance, closest_hit.hit);
-	
-	SIMD_Vector3 material_diffuse;
+	// Evaluate the shading attributes only once, for the closest hit
+	HitAttributes<L> hit_attributes;
+	scene->template evaluate_hit<!IS_LAST_BOUNCE>(ray, closest_hit, hit_attributes);
 	
-	int hit_mask = SIMD_float::mask(closest_hit.hit);
-	
-	for (int i = 0; i < SIMD_LANE_SIZE; i++) {
-		if (hit_mask & (1 << i)) {
-#if RAY_DIFFERENTIALS_ENABLED
-			Vector3 diffuse = MaterialBuffer::materials[closest_hit.material_id[i]].get_albedo(
-				closest_hit.u[i],     closest_hit.v[i], 
-				closest_hit.ds_dx[i], closest_hit.ds_dy[i], 
-				closest_hit.dt_dx[i], closest_hit.dt_dy[i]
-			);
+	SIMD_Vector3<L> material_diffuse = sample_albedo(hit_attributes, SIMD_float<L>::mask(closest_hit.hit));
+
+	SIMD_float<L> diffuse_mask = SIMD_Vector3<L>::length_squared(material_diffuse) > zero;
+
+	if (!SIMD_float<L>::all_false(diffuse_mask)) {
+		SIMD_Vector3<L> diffuse = SIMD_Vector3<L>(scene->ambient_lighting);
+
+		SIMD_Vector3<L> to_camera = SIMD_Vector3<L>::normalize(SIMD_Vector3<L>(scene->camera.position) - hit_attributes.point);
+
+		// Only the Lights that can affect the hit points are shaded. The Light list is shared by all bounces, so it is used up before the next bounce
+		int   light_count = gather_lights(hit_attributes.point, closest_hit.hit, bounces_left == number_of_bounces, thread_state);
+		int * lights      = thread_state.lights;
+
+#if SHADOW_RAY_BATCHING
+		// Shadow Rays towards all Lights are traced in batches, so that the BVH Nodes around the hit points are visited once per batch instead of once per Light
+		int next_light = 0;
+
+		while (next_light < light_count) {
+			ShadowRayBatch<L> batch;
+			batch.size = 0;
+
+			int           batch_lights             [SHADOW_RAY_BATCH_SIZE];
+			SIMD_float<L> distance_to_light_squared[SHADOW_RAY_BATCH_SIZE];
+
+			while (batch.size < SHADOW_RAY_BATCH_SIZE && next_light < light_count) {
+				int light = lights[next_light++];
+				int l     = batch.size;
+
+				get_light_direction(light, hit_attributes.point, batch.rays[l].direction, batch.max_distance[l], distance_to_light_squared[l]);
+
+#if SHADOW_RAY_CULLING
+				SIMD_float<L> contribution_mask = diffuse_mask & calc_contribution_mask(light, hit_attributes.normal, batch.rays[l].direction, distance_to_light_squared[l]);
+				if (SIMD_float<L>::all_false(contribution_mask)) {
+					stats.num_shadow_rays_skipped++;
+
+					continue;
+				}
+
+				// Lanes that cannot receive light count as occluded and are retired
+				batch.max_distance[l] = SIMD_float<L>::blend(zero, batch.max_distance[l], contribution_mask);
+				batch.occluded    [l] = ~contribution_mask;
 #else
-			Vector3 diffuse = MaterialBuffer::materials[closest_hit.material_id[i]].get_albedo(closest_hit.u[i], closest_hit.v[i], 0.0f, 0.0f, 0.0f, 0.0f);
+				batch.occluded[l] = zero;
 #endif
+				batch.rays     [l].origin = hit_attributes.point;
+				batch.occluders[l] = thread_state.occluders + light;
 
-			material_diffuse.x[i] = diffuse.x;
-			material_diffuse.y[i] = diffuse.y;
-			material_diffuse.z[i] = diffuse.z;
-		} else {
-			closest_hit.material_id[i] = 0;
+				batch_lights[l] = light;
 
-			material_diffuse.x[i] = 0.0f;
-			material_diffuse.y[i] = 0.0f;
-			material_diffuse.z[i] = 0.0f;
-		}
-	}
+				batch.size++;
+			}
+
+			if (batch.size == 0) break;
 
-	SIMD_float diffuse_mask = SIMD_Vector3::length_squared(material_diffuse) > zero;
+			batch.active_mask = (1 << batch.size) - 1;
 
-	if (!SIMD_float::all_false(diffuse_mask)) {
-		SIMD_Vector3 diffuse = SIMD_Vector3(scene->ambient_lighting);
+			stats.num_shadow_rays += batch.size;
 
+			intersect_shadow(batch, stats);
+
+			for (int l = 0; l < batch.size; l++) {
+				if (SIMD_float<L>::all_true(batch.occluded[l])) continue;
+
+				SIMD_Vector3<L> lighting = calc_lighting(batch_lights[l], hit_attributes.normal, batch.rays[l].direction, to_camera, distance_to_light_squared[l]);
+
+				diffuse = SIMD_Vector3<L>::blend(diffuse + lighting, diffuse, batch.occluded[l]);
+			}
+		}
+#else
 		// Shadow Ray starts at hit location
-		Ray shadow_ray;
-		shadow_ray.origin = closest_hit.point;
+		Ray<L> shadow_ray;
+		shadow_ray.origin = hit_attributes.point;
 
-		SIMD_Vector3 to_camera = SIMD_Vector3::normalize(SIMD_Vector3(scene->camera.position) - closest_hit.point);
+		for (int l = 0; l < light_count; l++) {
+			int light = lights[l];
 
-		// Check Point Lights
-		for (int i = 0; i < scene->point_light_count; i++) {
-			SIMD_Vector3 to_light = scene->point_lights[i].position - closest_hit.point;
-			SIMD_float   distance_to_light_squared = SIMD_Vector3::length_squared(to_light);
-			SIMD_float   distance_to_light         = SIMD_float::sqrt(distance_to_light_squared);
+			SIMD_float<L> distance_to_light;
+			SIMD_float<L> distance_to_light_squared;
+			get_light_direction(light, hit_attributes.point, shadow_ray.direction, distance_to_light, distance_to_light_squared);
 
-			to_light /= distance_to_light;
-			shadow_ray.direction = to_light;
+#if SHADOW_RAY_CULLING
+			SIMD_float<L> contribution_mask = diffuse_mask & calc_contribution_mask(light, hit_attributes.normal, shadow_ray.direction, distance_to_light_squared);
+			if (SIMD_float<L>::all_false(contribution_mask)) {
+				stats.num_shadow_rays_skipped++;
+
+				continue;
+			}
+
+			// Lanes that cannot receive light are retired
+			distance_to_light = SIMD_float<L>::blend(zero, distance_to_light, contribution_mask);
+#endif
 
 			stats.num_shadow_rays++;
 
-			SIMD_float shadow_mask = scene->intersect_primitives(shadow_ray, distance_to_light);
-			if (SIMD_float::all_true(shadow_mask)) continue;
+			// Every Light has its own Occluder
+			SIMD_float<L> shadow_mask = intersect_shadow(shadow_ray, distance_to_light, thread_state.occluders[light], stats);
+#if SHADOW_RAY_CULLING
+			shadow_mask = shadow_mask | ~contribution_mask;
+#endif
+			if (SIMD_float<L>::all_true(shadow_mask)) continue;
 
-			diffuse = SIMD_Vector3::blend(diffuse + scene->point_lights[i].calc_lighting(closest_hit.normal, to_light, to_camera, distance_to_light_squared), diffuse, shadow_mask);
+			diffuse = SIMD_Vector3<L>::blend(diffuse + calc_lighting(light, hit_attributes.normal, shadow_ray.direction, to_camera, distance_to_light_squared), diffuse, shadow_mask);
 		}
+#endif
+
+		result = SIMD_Vector3<L>::madd(diffuse, material_diffuse, result);
+	}
+	
+	// If we have bounces left to do, push the reflected and refracted Rays onto the Ray stack
+	if constexpr (!IS_LAST_BOUNCE) {
+		// Lanes that missed were given Material 0 by sample_albedo(), so all Material ids are valid
+		SIMD_Vector3<L> material_reflection = MaterialBuffer::gather(MaterialBuffer::reflection, hit_attributes.material_id);
 
-		// Check Spot Lights
-		for (int i = 0; i < scene->spot_light_count; i++) {
-			SIMD_Vector3 to_light = scene->spot_lights[i].position - closest_hit.point;
-			SIMD_float   distance_to_light_squared = SIMD_Vector3::length_squared(to_light);
-			SIMD_float   distance_to_light         = SIMD_float::sqrt(distance_to_light_squared);
+		SIMD_float<L> reflection_mask = closest_hit.hit & (SIMD_Vector3<L>::length_squared(material_reflection) > zero);
 
-			to_light /= distance_to_light;
-			shadow_ray.direction = to_light;
-			
-			stats.num_shadow_rays++;
+		// The reflected colour is added once, and added again as part of the Fresnel blend for lanes that also refract
+		SIMD_float<L> reflection_factor = one;
+
+		if constexpr (HAS_REFRACTION) {
+			SIMD_Vector3<L> material_transmittance = MaterialBuffer::gather(MaterialBuffer::transmittance, hit_attributes.material_id);
+
+			SIMD_float<L> refraction_mask = closest_hit.hit & (SIMD_Vector3<L>::length_squared(material_transmittance) > zero);
+
+			if (!SIMD_float<L>::all_false(refraction_mask)) {
+				SIMD_float<L> dot      = SIMD_Vector3<L>::dot(ray.direction, hit_attributes.normal);
+				SIMD_float<L> dot_mask = dot < zero;
+
+				SIMD_float<L> air(Material::air_index_of_refraction);
+				SIMD_float<L> ior = MaterialBuffer::gather(MaterialBuffer::index_of_refraction, hit_attributes.material_id);
+
+				SIMD_float<L> n_1 = SIMD_float<L>::blend(ior, air, dot_mask);
+				SIMD_float<L> n_2 = SIMD_float<L>::blend(air, ior, dot_mask);
+
+				SIMD_float<L>   cos_theta = SIMD_float<L>::blend(dot, zero - dot, dot_mask);
+				SIMD_Vector3<L> normal    = SIMD_Vector3<L>::blend(-hit_attributes.normal, hit_attributes.normal, dot_mask);
+
+				SIMD_float<L> eta = n_1 / n_2;
+				SIMD_float<L> k   = one - (eta*eta * (one - (cos_theta * cos_theta)));
+				
+				// In case of Total Internal Reflection only the reflection is used
+				SIMD_float<L> tir_mask       = refraction_mask & (k <  zero);
+				SIMD_float<L> refracted_mask = refraction_mask & (k >= zero);
+
+				reflection_factor = SIMD_float<L>::blend(reflection_factor, two, tir_mask);
+
+				if (!SIMD_float<L>::all_false(refracted_mask)) {
+					Ray<L> refracted_ray = get_refracted_ray(ray, hit_attributes, normal, eta, cos_theta, k);
+
+					// Make sure that Snell's Law is correctly obeyed
+					assert(Debug::test_refraction(n_1, n_2, ray.direction, normal, refracted_ray.direction, refracted_mask));
 
-			SIMD_float shadow_mask = scene->intersect_primitives(shadow_ray, distance_to_light);
-			if (SIMD_float::all_true(shadow_mask)) continue;
+					// Beer's Law only applies to Rays that enter the medium, it is applied to the weight once the distance travelled is known
+					SIMD_Vector3<L> material_absorption = material_transmittance - SIMD_Vector3<L>(one);
+					material_absorption = SIMD_Vector3<L>::blend(SIMD_Vector3<L>(zero), material_absorption, dot_mask);
 
-			diffuse = SIMD_Vector3::blend(diffuse + scene->spot_lights[i].calc_lighting(closest_hit.normal, to_light, to_camera, distance_to_light_squared), diffuse, shadow_mask);
+					// Use Schlick's Approximation to simulate the Fresnel effect
+					SIMD_float<L> r_0 = (n_1 - n_2) / (n_1 + n_2);
+					r_0 = r_0 * r_0;
+
+					// In case n_1 is larger than n_2, theta should be the angle
+					// between the normal and the refracted Ray direction
+					cos_theta = SIMD_float<L>::blend(cos_theta, zero - SIMD_Vector3<L>::dot(refracted_ray.direction, normal), n_1 > n_2);
+
+					// Calculate (1 - cos(theta))^5 efficiently, without using pow
+					SIMD_float<L> one_minus_cos         = one - cos_theta;
+					SIMD_float<L> one_minus_cos_squared = one_minus_cos * one_minus_cos;
+
+					SIMD_float<L> F_r = r_0 + ((one - r_0) * one_minus_cos_squared) * (one_minus_cos_squared * one_minus_cos); // r_0 + (1 - r_0) * (1 - cos)^5
+					SIMD_float<L> F_t = one - F_r;
+
+					reflection_factor = SIMD_float<L>::blend(reflection_factor, one + F_r, refracted_mask);
+
+					SIMD_Vector3<L> refracted_weight = F_t * weight;
+#if BOUNCE_TERMINATION
+					refracted_mask = terminate_lanes(refracted_mask, refracted_weight, stats);
+#endif
+					if (!SIMD_float<L>::all_false(refracted_mask)) {
+						stats.num_refraction_rays++;
+
+						push_ray(thread_state, refracted_ray, SIMD_float<L>::blend(zero, inf, refracted_mask), refracted_weight, material_absorption, bounces_left - 1);
+					}
+				}
+			}
 		}
 
-		// Check Directional Lights
-		for (int i = 0; i < scene->directional_light_count; i++) {			
-			shadow_ray.direction = scene->directional_lights[i].negative_direction;
-			
-			stats.num_shadow_rays++;
+		SIMD_Vector3<L> reflected_weight = reflection_factor * (material_reflection * weight);
+#if BOUNCE_TERMINATION
+		reflection_mask = terminate_lanes(reflection_mask, reflected_weight, stats);
+#endif
+		if (!SIMD_float<L>::all_false(reflection_mask)) {
+			Ray<L> reflected_ray = get_reflected_ray(ray, hit_attributes);
 
-			SIMD_float shadow_mask = scene->intersect_primitives(shadow_ray, inf);
-			if (SIMD_float::all_true(shadow_mask)) continue;
+			stats.num_reflection_rays++;
 
-			diffuse = SIMD_Vector3::blend(diffuse + scene->directional_lights[i].calc_lighting(closest_hit.normal, to_camera), diffuse, shadow_mask);
+			// The reflected Ray is pushed last, so that it is traced first
+			push_ray(thread_state, reflected_ray, SIMD_float<L>::blend(zero, inf, reflection_mask), reflected_weight, SIMD_Vector3<L>(zero), bounces_left - 1);
 		}
+	}
+
+	return result; 
+}
+
+#if RAYTRACER_WAVEFRONT
+// Loads the Rays into the lanes of a packet. Lanes beyond the Ray count repeat the last Ray, so that they only contain valid values
+template<int L>
+static void load_packet(const WavefrontRay rays[], int ray_count, Ray<L> & ray) {
+	for (int i = 0; i < L; i++) {
+		const WavefrontRay & wavefront_ray = rays[i < ray_count ? i : ray_count - 1];
+
+		ray.origin.x[i] = wavefront_ray.origin.x;
+		ray.origin.y[i] = wavefront_ray.origin.y;
+		ray.origin.z[i] = wavefront_ray.origin.z;
 
-		result = SIMD_Vector3::madd(diffuse, material_diffuse, result);
+		ray.direction.x[i] = wavefront_ray.direction.x;
+		ray.direction.y[i] = wavefront_ray.direction.y;
+		ray.direction.z[i] = wavefront_ray.direction.z;
+
+#if RAY_DIFFERENTIALS_ENABLED
+		ray.dO_dx.x[i] = wavefront_ray.dO_dx.x; ray.dO_dx.y[i] = wavefront_ray.dO_dx.y; ray.dO_dx.z[i] = wavefront_ray.dO_dx.z;
+		ray.dO_dy.x[i] = wavefront_ray.dO_dy.x; ray.dO_dy.y[i] = wavefront_ray.dO_dy.y; ray.dO_dy.z[i] = wavefront_ray.dO_dy.z;
+		ray.dD_dx.x[i] = wavefront_ray.dD_dx.x; ray.dD_dx.y[i] = wavefront_ray.dD_dx.y; ray.dD_dx.z[i] = wavefront_ray.dD_dx.z;
+		ray.dD_dy.x[i] = wavefront_ray.dD_dy.x; ray.dD_dy.y[i] = wavefront_ray.dD_dy.y; ray.dD_dy.z[i] = wavefront_ray.dD_dy.z;
+#endif
 	}
-	
-	// If we have bounces left to do, recurse one level deeper
-	if (bounces_left > 0) {	
-		SIMD_Vector3 colour_reflection;
-		SIMD_Vector3 colour_refraction;
-
-#if SIMD_LANE_SIZE == 1
-		SIMD_Vector3 material_reflection   (MaterialBuffer::materials[closest_hit.material_id[0]].reflection);
-		SIMD_Vector3 material_transmittance(MaterialBuffer::materials[closest_hit.material_id[0]].transmittance);
-#elif SIMD_LANE_SIZE == 4
-		SIMD_Vector3 material_reflection(
-			MaterialBuffer::materials[closest_hit.material_id[3]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[2]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[1]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[0]].reflection
-		);
-		SIMD_Vector3 material_transmittance(
-			MaterialBuffer::materials[closest_hit.material_id[3]].transmittance, 
-			MaterialBuffer::materials[closest_hit.material_id[2]].transmittance, 
-			MaterialBuffer::materials[closest_hit.material_id[1]].transmittance, 
-			MaterialBuffer::materials[closest_hit.material_id[0]].transmittance
-		);
-#elif SIMD_LANE_SIZE == 8
-		SIMD_Vector3 material_reflection(
-			MaterialBuffer::materials[closest_hit.material_id[7]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[6]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[5]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[4]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[3]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[2]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[1]].reflection,
-			MaterialBuffer::materials[closest_hit.material_id[0]].reflection
-		);
-		SIMD_Vector3 material_transmittance(
-			MaterialBuffer::materials[closest_hit.material_id[7]].transmittance,
-			MaterialBuffer::materials[closest_hit.material_id[6]].transmittance,
-			MaterialBuffer::materials[closest_hit.material_id[5]].transmittance,
-			MaterialBuffer::materials[closest_hit.material_id[4]].transmittance,
-			MaterialBuffer::materials[closest_hit.material_id[3]].transmittance,
-			MaterialBuffer::materials[closest_hit.material_id[2]].transmittance,
-			MaterialBuffer::materials[closest_hit.material_id[1]].transmittance,
-			MaterialBuffer::materials[closest_hit.material_id[0]].transmittance
-		);
+}
+
+template<int L>
+static Vector3 get_lane(const SIMD_Vector3<L> & vector, int lane) {
+	return Vector3(vector.x[lane], vector.y[lane], vector.z[lane]);
+}
+
+// Appends a single lane of the packet to the queue
+template<int L>
+static void store_lane(std::vector<WavefrontRay> & queue, const Ray<L> & ray, int lane, const Vector3 & weight, const Vector3 & absorption, int pixel, bool is_refraction) {
+	WavefrontRay wavefront_ray;
+	wavefront_ray.origin    = get_lane(ray.origin,    lane);
+	wavefront_ray.direction = get_lane(ray.direction, lane);
+
+#if RAY_DIFFERENTIALS_ENABLED
+	wavefront_ray.dO_dx = get_lane(ray.dO_dx, lane);
+	wavefront_ray.dO_dy = get_lane(ray.dO_dy, lane);
+	wavefront_ray.dD_dx = get_lane(ray.dD_dx, lane);
+	wavefront_ray.dD_dy = get_lane(ray.dD_dy, lane);
 #endif
-		SIMD_float reflection_mask = SIMD_Vector3::length_squared(material_reflection)    > zero;
-		SIMD_float refraction_mask = SIMD_Vector3::length_squared(material_transmittance) > zero;
-		
-		if (!SIMD_float::all_false(reflection_mask)) {
-			Ray reflected_ray;
-			reflected_ray.origin    = closest_hit.point;
-			reflected_ray.direction = Math::reflect(ray.direction, closest_hit.normal);
+
+	wavefront_ray.weight     = weight;
+	wavefront_ray.absorption = absorption;
+	wavefront_ray.pixel      = pixel;
+
+	wavefront_ray.is_refraction = is_refraction;
+
+	queue.push_back(wavefront_ray);
+}
+
+#if BOUNCE_TERMINATION
+// Scalar equivalent of terminate_lanes(), for a single queued Ray
+static bool is_weight_negligible(const Vector3 & weight) {
+	return weight.x < BOUNCE_TERMINATION_THRESHOLD && weight.y < BOUNCE_TERMINATION_THRESHOLD && weight.z < BOUNCE_TERMINATION_THRESHOLD;
+}
+#endif
+
+// Loads the hits into the lanes of a packet, together with the incoming Rays. Lanes beyond the hit count repeat the last hit
+template<int L>
+static void load_hits(const WavefrontHit hits[], int hit_count, Ray<L> & ray, HitAttributes<L> & hit_attributes) {
+	for (int i = 0; i < L; i++) {
+		const WavefrontHit & hit = hits[i < hit_count ? i : hit_count - 1];
+
+		hit_attributes.point.x[i] = hit.point.x;
+		hit_attributes.point.y[i] = hit.point.y;
+		hit_attributes.point.z[i] = hit.point.z;
+
+		hit_attributes.normal.x[i] = hit.normal.x;
+		hit_attributes.normal.y[i] = hit.normal.y;
+		hit_attributes.normal.z[i] = hit.normal.z;
+
+		hit_attributes.material_id[i] = hit.material_id;
+		hit_attributes.u[i] = hit.u;
+		hit_attributes.v[i] = hit.v;
+
+		ray.origin.x[i] = hit.point.x;
+		ray.origin.y[i] = hit.point.y;
+		ray.origin.z[i] = hit.point.z;
+
+		ray.direction.x[i] = hit.direction.x;
+		ray.direction.y[i] = hit.direction.y;
+		ray.direction.z[i] = hit.direction.z;
 
 #if RAY_DIFFERENTIALS_ENABLED
-			reflected_ray.dO_dx = closest_hit.dO_dx;
-			reflected_ray.dO_dy = closest_hit.dO_dy;
+		hit_attributes.ds_dx[i] = hit.ds_dx;
+		hit_attributes.ds_dy[i] = hit.ds_dy;
+		hit_attributes.dt_dx[i] = hit.dt_dx;
+		hit_attributes.dt_dy[i] = hit.dt_dy;
+
+		hit_attributes.dO_dx.x[i] = hit.dO_dx.x; hit_attributes.dO_dx.y[i] = hit.dO_dx.y; hit_attributes.dO_dx.z[i] = hit.dO_dx.z;
+		hit_attributes.dO_dy.x[i] = hit.dO_dy.x; hit_attributes.dO_dy.y[i] = hit.dO_dy.y; hit_attributes.dO_dy.z[i] = hit.dO_dy.z;
+		hit_attributes.dN_dx.x[i] = hit.dN_dx.x; hit_attributes.dN_dx.y[i] = hit.dN_dx.y; hit_attributes.dN_dx.z[i] = hit.dN_dx.z;
+		hit_attributes.dN_dy.x[i] = hit.dN_dy.x; hit_attributes.dN_dy.y[i] = hit.dN_dy.y; hit_attributes.dN_dy.z[i] = hit.dN_dy.z;
+
+		ray.dD_dx.x[i] = hit.dD_dx.x; ray.dD_dx.y[i] = hit.dD_dx.y; ray.dD_dx.z[i] = hit.dD_dx.z;
+		ray.dD_dy.x[i] = hit.dD_dy.x; ray.dD_dy.y[i] = hit.dD_dy.y; ray.dD_dy.z[i] = hit.dD_dy.z;
+#endif
+	}
+}
+
+// Renders the tile one bounce at a time. Instead of recursing per packet, every bounce traces the Rays of the whole tile,
+// and the reflection, refraction and Shadow Rays they spawn are queued. Before the next bounce the queues are sorted,
+// so that the partially filled and incoherent packets of the recursive renderer are replaced by full, coherent packets.
+// Every Ray carries the weight that the recursion in bounce() would apply to its colour, so both renderers give the same image
+template<int L>
+void Raytracer<L>::render_tile_wavefront(const Window & window, int tile_x, int tile_y, int tile_width, int tile_height, PerformanceStats & stats, ThreadState<L> & thread_state) const {
+	WavefrontQueues & queues = thread_state.wavefront;
+
+	queues.colours.assign(tile_width * tile_height, Vector3(0.0f));
+	queues.rays.clear();
+
+	const Camera & camera = scene->camera;
+
+	const Vector3 & top_left_corner = camera.rotated_top_left_corner;
+	const Vector3 & x_axis          = camera.rotated_x_axis;
+	const Vector3 & y_axis          = camera.rotated_y_axis;
+
+	// Primary Rays are generated in the same blocks as the packets of render_tile, they need no sorting
+	for (int j = 0; j < tile_height; j += step_y<L>) {
+		for (int i = 0; i < tile_width; i += step_x<L>) {
+			for (int y = j; y < j + step_y<L>; y++) {
+				for (int x = i; x < i + step_x<L>; x++) {
+					Vector3 direction = top_left_corner + float(tile_x + x) * x_axis + float(tile_y + y) * y_axis;
 
-			SIMD_float dDN_dx = SIMD_Vector3::dot(ray.dD_dx, closest_hit.normal) + SIMD_Vector3::dot(ray.direction, closest_hit.dN_dx);
-			SIMD_float dDN_dy = SIMD_Vector3::dot(ray.dD_dy, closest_hit.normal) + SIMD_Vector3::dot(ray.direction, closest_hit.dN_dy);
+					float d_dot_d = Vector3::dot(direction, direction);
 
-			reflected_ray.dD_dx = ray.dD_dx - SIMD_float(2.0f) * (SIMD_Vector3::dot(ray.direction, closest_hit.normal) * closest_hit.dN_dx + dDN_dx * closest_hit.normal);
-			reflected_ray.dD_dy = ray.dD_dy - SIMD_float(2.0f) * (SIMD_Vector3::dot(ray.direction, closest_hit.normal) * closest_hit.dN_dy + dDN_dy * closest_hit.normal);
+					WavefrontRay ray;
+					ray.origin    = camera.position;
+					ray.direction = direction / sqrtf(d_dot_d);
+
+#if RAY_DIFFERENTIALS_ENABLED
+					float denom = 1.0f / (d_dot_d * sqrtf(d_dot_d)); // d_dot_d ^ -3/2
+
+					ray.dO_dx = Vector3(0.0f);
+					ray.dO_dy = Vector3(0.0f);
+					ray.dD_dx = (d_dot_d * x_axis - Vector3::dot(direction, x_axis) * direction) * denom;
+					ray.dD_dy = (d_dot_d * y_axis - Vector3::dot(direction, y_axis) * direction) * denom;
 #endif
 
-			stats.num_reflection_rays++;
+					ray.weight     = Vector3(1.0f);
+					ray.absorption = Vector3(0.0f);
+					ray.pixel      = x + y * tile_width;
+
+					ray.is_refraction = false;
+
+					queues.rays.push_back(ray);
+				}
+			}
+		}
+	}
+
+	for (int bounce = 0; bounce <= number_of_bounces && queues.rays.size() > 0; bounce++) {
+		int ray_count = queues.rays.size();
+
+		if (bounce == 0) {
+			stats.num_primary_rays += ray_count / L;
+		} else {
+			Wavefront::sort(queues.rays, queues.rays_sorted, queues.sort_keys);
+
+			int refraction_count = 0;
+			for (int i = 0; i < ray_count; i++) {
+				refraction_count += queues.rays[i].is_refraction;
+			}
+
+			stats.num_reflection_rays += (ray_count - refraction_count + L - 1) / L;
+			stats.num_refraction_rays += (refraction_count              + L - 1) / L;
+		}
+
+		queues.rays_next.clear();
+		queues.hits.clear();
+		queues.shadow_rays.clear();
+
+		for (int first = 0; first < ray_count; first += L) {
+			int packet_size = ray_count - first < L ? ray_count - first : L;
+
+			trace_wavefront_packet(queues.rays.data() + first, packet_size, stats, thread_state);
+		}
+
+#if WAVEFRONT_MATERIAL_SORTING
+		Wavefront::sort(queues.hits, queues.hits_sorted, queues.sort_keys);
+#endif
+
+		int hit_count = queues.hits.size();
+		int first     = 0;
+
+		while (first < hit_count) {
+			int packet_size = 1;
+
+#if WAVEFRONT_MATERIAL_SORTING
+			// Packets do not cross Material boundaries, so that every packet has a single Material
+			int material_id = queues.hits[first].material_id;
+
+			while (packet_size < L && first + packet_size < hit_count && queues.hits[first + packet_size].material_id == material_id) {
+				packet_size++;
+			}
+#else
+			packet_size = hit_count - first < L ? hit_count - first : L;
+#endif
 
-			SIMD_float reflection_distance;
-			colour_reflection = material_reflection * bounce(reflected_ray, bounces_left - 1, reflection_distance, stats);
+			shade_wavefront_packet(queues.hits.data() + first, packet_size, bounce, stats, thread_state);
 
-			result = SIMD_Vector3::blend(result, result + colour_reflection, reflection_mask);
+			first += packet_size;
 		}
 
-		if (!SIMD_float::all_false(refraction_mask)) {		
-			SIMD_float dot      = SIMD_Vector3::dot(ray.direction, closest_hit.normal);
-			SIMD_float dot_mask = dot < zero;
-
-			SIMD_float air(Material::air_index_of_refraction);
-			
-#if SIMD_LANE_SIZE == 1
-			SIMD_float ior(MaterialBuffer::materials[closest_hit.material_id[0]].index_of_refraction);
-#elif SIMD_LANE_SIZE == 4
-			SIMD_float ior(
-				MaterialBuffer::materials[closest_hit.material_id[3]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[2]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[1]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[0]].index_of_refraction
-			);
-#elif SIMD_LANE_SIZE == 8
-			SIMD_float ior(
-				MaterialBuffer::materials[closest_hit.material_id[7]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[6]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[5]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[4]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[3]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[2]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[1]].index_of_refraction,
-				MaterialBuffer::materials[closest_hit.material_id[0]].index_of_refraction
-			);
-#endif
-			SIMD_float n_1 = SIMD_float::blend(ior, air, dot_mask);
-			SIMD_float n_2 = SIMD_float::blend(air, ior, dot_mask);
-
-			SIMD_float   cos_theta = SIMD_float::blend(dot, zero - dot, dot_mask);
-			SIMD_Vector3 normal    = SIMD_Vector3::blend(-closest_hit.normal, closest_hit.normal, dot_mask);
-
-			SIMD_float eta = n_1 / n_2;
-			SIMD_float k   = one - (eta*eta * (one - (cos_theta * cos_theta)));
-			
-			// In case of Total Internal Reflection, return only the reflection component
-			SIMD_float tir_mask = closest_hit.hit & (k < zero);
-
-			if (SIMD_float::mask(tir_mask) == SIMD_float::mask(refraction_mask)) {
-				return SIMD_Vector3::blend(result, result + colour_reflection, reflection_mask & refraction_mask);
+		trace_wavefront_shadow_rays(stats, thread_state);
+
+		queues.rays.swap(queues.rays_next);
+	}
+
+	for (int y = 0; y < tile_height; y++) {
+		for (int x = 0; x < tile_width; x++) {
+			window.plot(tile_x + x, tile_y + y, queues.colours[x + y * tile_width]);
+		}
+	}
+}
+
+// Traces a packet of Rays from the queue. Rays that miss add the colour of the Sky,
+// the hits are queued so that they can be shaded once all Rays of the bounce have been traced
+template<int L>
+void Raytracer<L>::trace_wavefront_packet(const WavefrontRay rays[], int ray_count, PerformanceStats & stats, ThreadState<L> & thread_state) const {
+	WavefrontQueues & queues = thread_state.wavefront;
+
+	Ray<L> ray;
+	load_packet(rays, ray_count, ray);
+
+	RayHit<L> closest_hit;
+
+	// Retire the lanes beyond the Ray count
+	for (int i = ray_count; i < L; i++) {
+		closest_hit.distance[i] = 0.0f;
+	}
+
+	scene->trace_primitives(ray, closest_hit);
+
+#if BVH_HYBRID_TRAVERSAL
+	stats.num_packet_traversals     += closest_hit.packet_traversals;
+	stats.num_single_ray_traversals += closest_hit.single_ray_traversals;
+#endif
+
+	int active_mask = (1 << ray_count) - 1;
+	int hit_mask    = SIMD_float<L>::mask(closest_hit.hit) & active_mask;
+
+	Vector3 weights[L];
+
+	for (int i = 0; i < ray_count; i++) {
+		weights[i] = rays[i].weight;
+
+		// Apply Beer's Law, now that the distance travelled through the medium is known
+		const Vector3 & absorption = rays[i].absorption;
+		if (absorption.x != 0.0f) weights[i].x *= expf(absorption.x * closest_hit.distance[i]);
+		if (absorption.y != 0.0f) weights[i].y *= expf(absorption.y * closest_hit.distance[i]);
+		if (absorption.z != 0.0f) weights[i].z *= expf(absorption.z * closest_hit.distance[i]);
+	}
+
+	// Rays that did not hit anything sample the Sky
+	if (hit_mask != active_mask) {
+		SIMD_Vector3<L> sky = scene->sky.sample(ray.direction);
+
+		for (int i = 0; i < ray_count; i++) {
+			if ((hit_mask & (1 << i)) == 0) {
+				queues.colours[rays[i].pixel] += weights[i] * get_lane(sky, i);
 			}
+		}
+	}
+
+	if (hit_mask == 0) return;
+
+	HitAttributes<L> hit_attributes;
+	scene->template evaluate_hit<true>(ray, closest_hit, hit_attributes);
+
+	for (int i = 0; i < ray_count; i++) {
+		if ((hit_mask & (1 << i)) == 0) continue;
 
-			Ray refracted_ray;
-			refracted_ray.origin    = closest_hit.point;
-			refracted_ray.direction = Math::refract(ray.direction, normal, eta, cos_theta, k);
+		WavefrontHit hit;
+		hit.point  = get_lane(hit_attributes.point,  i);
+		hit.normal = get_lane(hit_attributes.normal, i);
 
-			stats.num_refraction_rays++;
+		hit.material_id = hit_attributes.material_id[i];
+		hit.u = hit_attributes.u[i];
+		hit.v = hit_attributes.v[i];
+
+		hit.direction = rays[i].direction;
 
-			// Make sure that Snell's Law is correctly obeyed
-			assert(Debug::test_refraction(n_1, n_2, ray.direction, normal, refracted_ray.direction, closest_hit.hit & (k >= zero)));
-			
 #if RAY_DIFFERENTIALS_ENABLED
-			refracted_ray.dO_dx = closest_hit.dO_dx;
-			refracted_ray.dO_dy = closest_hit.dO_dy;
-
-			SIMD_float dDN_dx = SIMD_Vector3::dot(ray.dD_dx, closest_hit.normal) + SIMD_Vector3::dot(ray.direction, closest_hit.dN_dx);
-			SIMD_float dDN_dy = SIMD_Vector3::dot(ray.dD_dy, closest_hit.normal) + SIMD_Vector3::dot(ray.direction, closest_hit.dN_dy);
-
-			SIMD_float D_dot_N      = -cos_theta;
-			SIMD_float Dprime_dot_N = -SIMD_float::sqrt(k);
-
-			SIMD_float mu = -(eta * cos_theta + Dprime_dot_N);
-
-			SIMD_float factor = (eta + (eta*eta * cos_theta) / Dprime_dot_N);
-			SIMD_float dmu_dx = factor * dDN_dx;
-			SIMD_float dmu_dy = factor * dDN_dy;
-
-			refracted_ray.dD_dx = eta * ray.dD_dx - (mu * D_dot_N + closest_hit.dN_dx * closest_hit.normal) * dDN_dx;
-			refracted_ray.dD_dy = eta * ray.dD_dy - (mu * D_dot_N + closest_hit.dN_dy * closest_hit.normal) * dDN_dy;
-#endif
-
-			SIMD_float refraction_distance;
-			colour_refraction = bounce(refracted_ray, bounces_left - 1, refraction_distance, stats);
-
-			// Apply Beer's Law
-#if SIMD_LANE_SIZE == 1
-			SIMD_Vector3 material_absorption(MaterialBuffer::materials[closest_hit.material_id[0]].transmittance - Vector3(1.0f));
-#elif SIMD_LANE_SIZE == 4
-			SIMD_Vector3 material_absorption(
-				MaterialBuffer::materials[closest_hit.material_id[3]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[2]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[1]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[0]].transmittance - Vector3(1.0f)
-			);
-#elif SIMD_LANE_SIZE == 8
-			SIMD_Vector3 material_absorption(
-				MaterialBuffer::materials[closest_hit.material_id[7]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[6]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[5]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[4]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[3]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[2]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[1]].transmittance - Vector3(1.0f),
-				MaterialBuffer::materials[closest_hit.material_id[0]].transmittance - Vector3(1.0f)
-			);
-#endif
-			SIMD_float beer_x = SIMD_float::exp(material_absorption.x * refraction_distance);
-			SIMD_float beer_y = SIMD_float::exp(material_absorption.y * refraction_distance);
-			SIMD_float beer_z = SIMD_float::exp(material_absorption.z * refraction_distance);
-			
-			colour_refraction.x = SIMD_float::blend(colour_refraction.x, colour_refraction.x * beer_x, dot_mask);
-			colour_refraction.y = SIMD_float::blend(colour_refraction.y, colour_refraction.y * beer_y, dot_mask);
-			colour_refraction.z = SIMD_float::blend(colour_refraction.z, colour_refraction.z * beer_z, dot_mask);
-
-			// Use Schlick's Approximation to simulate the Fresnel effect
-			SIMD_float r_0 = (n_1 - n_2) / (n_1 + n_2);
-			r_0 = r_0 * r_0;
-
-			// In case n_1 is larger than n_2, theta should be the angle
-			// between the normal and the refracted Ray direction
-			cos_theta = SIMD_float::blend(cos_theta, zero - SIMD_Vector3::dot(refracted_ray.direction, normal), n_1 > n_2);
-
-			// Calculate (1 - cos(theta))^5 efficiently, without using pow
-			SIMD_float one_minus_cos         = one - cos_theta;
-			SIMD_float one_minus_cos_squared = one_minus_cos * one_minus_cos;
-
-			SIMD_float F_r = r_0 + ((one - r_0) * one_minus_cos_squared) * (one_minus_cos_squared * one_minus_cos); // r_0 + (1 - r_0) * (1 - cos)^5
-			SIMD_float F_t = one - F_r;
-
-			SIMD_Vector3 blend = SIMD_Vector3::blend(F_r * colour_reflection + F_t * colour_refraction, colour_reflection, tir_mask);
-
-			return SIMD_Vector3::blend(result, result + blend, refraction_mask);
+		hit.ds_dx = hit_attributes.ds_dx[i];
+		hit.ds_dy = hit_attributes.ds_dy[i];
+		hit.dt_dx = hit_attributes.dt_dx[i];
+		hit.dt_dy = hit_attributes.dt_dy[i];
+
+		hit.dO_dx = get_lane(hit_attributes.dO_dx, i);
+		hit.dO_dy = get_lane(hit_attributes.dO_dy, i);
+		hit.dN_dx = get_lane(hit_attributes.dN_dx, i);
+		hit.dN_dy = get_lane(hit_attributes.dN_dy, i);
+
+		hit.dD_dx = rays[i].dD_dx;
+		hit.dD_dy = rays[i].dD_dy;
+#endif
+
+		hit.weight = weights[i];
+		hit.pixel  = rays[i].pixel;
+
+		queues.hits.push_back(hit);
+	}
+}
+
+// Shades a packet of queued hits. Lighting is not added directly, instead a Shadow Ray is queued
+// for every lane and Light that can contribute. Reflection and refraction Rays are queued for the next bounce
+template<int L>
+void Raytracer<L>::shade_wavefront_packet(const WavefrontHit hits[], int hit_count, int bounce, PerformanceStats & stats, ThreadState<L> & thread_state) const {
+	WavefrontQueues & queues = thread_state.wavefront;
+
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+
+	Ray<L>           ray;
+	HitAttributes<L> hit_attributes;
+	load_hits(hits, hit_count, ray, hit_attributes);
+
+	int hit_mask = (1 << hit_count) - 1;
+
+#if WAVEFRONT_MATERIAL_SORTING
+	SIMD_Vector3<L> material_diffuse = sample_albedo(MaterialBuffer::get(hits[0].material_id), hit_attributes, hit_mask);
+#else
+	SIMD_Vector3<L> material_diffuse = sample_albedo(hit_attributes, hit_mask);
+#endif
+
+	SIMD_float<L> diffuse_mask = SIMD_Vector3<L>::length_squared(material_diffuse) > zero;
+
+	if (!SIMD_float<L>::all_false(diffuse_mask)) {
+		SIMD_Vector3<L> weight;
+		for (int i = 0; i < hit_count; i++) {
+			weight.x[i] = hits[i].weight.x;
+			weight.y[i] = hits[i].weight.y;
+			weight.z[i] = hits[i].weight.z;
+		}
+
+		SIMD_Vector3<L> weighted_diffuse = weight * material_diffuse;
+		SIMD_Vector3<L> ambient          = weighted_diffuse * SIMD_Vector3<L>(scene->ambient_lighting);
+
+		for (int i = 0; i < hit_count; i++) {
+			queues.colours[hits[i].pixel] += get_lane(ambient, i);
+		}
+
+		SIMD_Vector3<L> to_camera = SIMD_Vector3<L>::normalize(SIMD_Vector3<L>(scene->camera.position) - hit_attributes.point);
+
+		int   light_count = gather_lights(hit_attributes.point, diffuse_mask, bounce == 0, thread_state);
+		int * lights      = thread_state.lights;
+
+		for (int l = 0; l < light_count; l++) {
+			int light = lights[l];
+
+			SIMD_Vector3<L> to_light;
+			SIMD_float<L>   distance_to_light;
+			SIMD_float<L>   distance_to_light_squared;
+			get_light_direction(light, hit_attributes.point, to_light, distance_to_light, distance_to_light_squared);
+
+			SIMD_float<L> contribution_mask = diffuse_mask;
+#if SHADOW_RAY_CULLING
+			contribution_mask = contribution_mask & calc_contribution_mask(light, hit_attributes.normal, to_light, distance_to_light_squared);
+			if (SIMD_float<L>::all_false(contribution_mask)) {
+				stats.num_shadow_rays_skipped++;
+
+				continue;
+			}
+#endif
+			SIMD_Vector3<L> lighting = weighted_diffuse * calc_lighting(light, hit_attributes.normal, to_light, to_camera, distance_to_light_squared);
+
+			int mask = SIMD_float<L>::mask(contribution_mask) & hit_mask;
+
+			for (int i = 0; i < hit_count; i++) {
+				if (mask & (1 << i)) {
+					WavefrontShadowRay shadow_ray;
+					shadow_ray.origin       = get_lane(hit_attributes.point, i);
+					shadow_ray.direction    = get_lane(to_light, i);
+					shadow_ray.max_distance = distance_to_light[i];
+					shadow_ray.colour       = get_lane(lighting, i);
+					shadow_ray.pixel        = hits[i].pixel;
+					shadow_ray.light        = light;
+
+					queues.shadow_rays.push_back(shadow_ray);
+				}
+			}
 		}
 	}
 
-	return result; 
+	if (bounce == number_of_bounces) return;
+
+	// Lanes beyond the hit count repeat the last hit, so all of their Material ids are valid
+	SIMD_Vector3<L> material_reflection    = MaterialBuffer::gather(MaterialBuffer::reflection,          hit_attributes.material_id);
+	SIMD_Vector3<L> material_transmittance = MaterialBuffer::gather(MaterialBuffer::transmittance,       hit_attributes.material_id);
+	SIMD_float<L>   ior                    = MaterialBuffer::gather(MaterialBuffer::index_of_refraction, hit_attributes.material_id);
+
+	int reflection_mask = SIMD_float<L>::mask(SIMD_Vector3<L>::length_squared(material_reflection)    > zero) & hit_mask;
+	int refraction_mask = SIMD_float<L>::mask(SIMD_Vector3<L>::length_squared(material_transmittance) > zero) & hit_mask;
+
+	// In bounce() the reflected colour is added once, and added again as part of the Fresnel blend for lanes that also refract
+	SIMD_float<L> reflection_factor = one;
+
+	if (refraction_mask) {
+		SIMD_float<L> dot      = SIMD_Vector3<L>::dot(ray.direction, hit_attributes.normal);
+		SIMD_float<L> dot_mask = dot < zero;
+
+		SIMD_float<L> air(Material::air_index_of_refraction);
+
+		SIMD_float<L> n_1 = SIMD_float<L>::blend(ior, air, dot_mask);
+		SIMD_float<L> n_2 = SIMD_float<L>::blend(air, ior, dot_mask);
+
+		SIMD_float<L>   cos_theta = SIMD_float<L>::blend(dot, zero - dot, dot_mask);
+		SIMD_Vector3<L> normal    = SIMD_Vector3<L>::blend(-hit_attributes.normal, hit_attributes.normal, dot_mask);
+
+		SIMD_float<L> eta = n_1 / n_2;
+		SIMD_float<L> k   = one - (eta*eta * (one - (cos_theta * cos_theta)));
+
+		int tir_mask = SIMD_float<L>::mask(k < zero);
+
+		Ray<L> refracted_ray = get_refracted_ray(ray, hit_attributes, normal, eta, cos_theta, k);
+
+		// Use Schlick's Approximation to simulate the Fresnel effect
+		SIMD_float<L> r_0 = (n_1 - n_2) / (n_1 + n_2);
+		r_0 = r_0 * r_0;
+
+		cos_theta = SIMD_float<L>::blend(cos_theta, zero - SIMD_Vector3<L>::dot(refracted_ray.direction, normal), n_1 > n_2);
+
+		SIMD_float<L> one_minus_cos         = one - cos_theta;
+		SIMD_float<L> one_minus_cos_squared = one_minus_cos * one_minus_cos;
+
+		SIMD_float<L> F_r = r_0 + ((one - r_0) * one_minus_cos_squared) * (one_minus_cos_squared * one_minus_cos); // r_0 + (1 - r_0) * (1 - cos)^5
+		SIMD_float<L> F_t = one - F_r;
+
+		int entering_mask = SIMD_float<L>::mask(dot_mask);
+
+		for (int i = 0; i < hit_count; i++) {
+			if ((refraction_mask & (1 << i)) == 0) continue;
+
+			// In case of Total Internal Reflection only the reflection is used
+			if (tir_mask & (1 << i)) {
+				reflection_factor[i] = 2.0f;
+
+				continue;
+			}
+
+			reflection_factor[i] = 1.0f + F_r[i];
+
+			// Beer's Law only applies to Rays that enter the medium
+			Vector3 absorption = entering_mask & (1 << i) ? get_lane(material_transmittance, i) - Vector3(1.0f) : Vector3(0.0f);
+
+			Vector3 refracted_weight = F_t[i] * hits[i].weight;
+#if BOUNCE_TERMINATION
+			if (is_weight_negligible(refracted_weight)) {
+				stats.num_bounce_lanes_terminated++;
+
+				continue;
+			}
+#endif
+			store_lane(queues.rays_next, refracted_ray, i, refracted_weight, absorption, hits[i].pixel, true);
+		}
+	}
+
+	if (reflection_mask) {
+		Ray<L> reflected_ray = get_reflected_ray(ray, hit_attributes);
+
+		for (int i = 0; i < hit_count; i++) {
+			if ((reflection_mask & (1 << i)) == 0) continue;
+
+			Vector3 reflected_weight = reflection_factor[i] * get_lane(material_reflection, i) * hits[i].weight;
+#if BOUNCE_TERMINATION
+			if (is_weight_negligible(reflected_weight)) {
+				stats.num_bounce_lanes_terminated++;
+
+				continue;
+			}
+#endif
+			store_lane(queues.rays_next, reflected_ray, i, reflected_weight, Vector3(0.0f), hits[i].pixel, false);
+		}
+	}
+}
+
+// Traces all queued Shadow Rays of the current bounce. They are sorted by Light first, so that every packet
+// can use the Occluder of its Light, and by the Morton code of their origin second
+template<int L>
+void Raytracer<L>::trace_wavefront_shadow_rays(PerformanceStats & stats, ThreadState<L> & thread_state) const {
+	WavefrontQueues & queues = thread_state.wavefront;
+
+	Wavefront::sort(queues.shadow_rays, queues.shadow_rays_sorted, queues.sort_keys);
+
+	int shadow_ray_count = queues.shadow_rays.size();
+	int first = 0;
+
+	while (first < shadow_ray_count) {
+		int light = queues.shadow_rays[first].light;
+
+		int packet_size = 1;
+		while (packet_size < L && first + packet_size < shadow_ray_count && queues.shadow_rays[first + packet_size].light == light) {
+			packet_size++;
+		}
+
+		// Unused lanes repeat the first Shadow Ray, with a max distance of zero they cannot be occluded
+		Ray<L>        ray;
+		SIMD_float<L> max_distance(0.0f);
+
+		for (int i = 0; i < L; i++) {
+			const WavefrontShadowRay & shadow_ray = queues.shadow_rays[first + (i < packet_size ? i : 0)];
+
+			ray.origin.x[i] = shadow_ray.origin.x;
+			ray.origin.y[i] = shadow_ray.origin.y;
+			ray.origin.z[i] = shadow_ray.origin.z;
+
+			ray.direction.x[i] = shadow_ray.direction.x;
+			ray.direction.y[i] = shadow_ray.direction.y;
+			ray.direction.z[i] = shadow_ray.direction.z;
+
+			if (i < packet_size) max_distance[i] = shadow_ray.max_distance;
+		}
+
+		stats.num_shadow_rays++;
+
+		int occluded_mask = SIMD_float<L>::mask(intersect_shadow(ray, max_distance, thread_state.occluders[light], stats));
+
+		for (int i = 0; i < packet_size; i++) {
+			if ((occluded_mask & (1 << i)) == 0) {
+				const WavefrontShadowRay & shadow_ray = queues.shadow_rays[first + i];
+
+				queues.colours[shadow_ray.pixel] += shadow_ray.colour;
+			}
+		}
+
+		first += packet_size;
+	}
+}
+#endif
+
+// Stores the Lights that can affect any of the hit points in ThreadState::lights and returns their count.
+// Primary hits only need to check the Lights of their tile, other hits query the Light BVH. Directional Lights are always included
+template<int L>
+int Raytracer<L>::gather_lights(const SIMD_Vector3<L> & points, SIMD_float<L> hit_mask, bool is_primary, ThreadState<L> & thread_state) const {
+	int light_count = 0;
+
+#if LIGHT_CULLING
+	// Bounds of the hit points of all lanes that hit something
+	const SIMD_float<L> pos_inf(+INFINITY);
+	const SIMD_float<L> neg_inf(-INFINITY);
+
+	AABB region;
+	region.min = Vector3(
+		SIMD_float<L>::hmin(SIMD_float<L>::blend(pos_inf, points.x, hit_mask)),
+		SIMD_float<L>::hmin(SIMD_float<L>::blend(pos_inf, points.y, hit_mask)),
+		SIMD_float<L>::hmin(SIMD_float<L>::blend(pos_inf, points.z, hit_mask))
+	);
+	region.max = Vector3(
+		SIMD_float<L>::hmax(SIMD_float<L>::blend(neg_inf, points.x, hit_mask)),
+		SIMD_float<L>::hmax(SIMD_float<L>::blend(neg_inf, points.y, hit_mask)),
+		SIMD_float<L>::hmax(SIMD_float<L>::blend(neg_inf, points.z, hit_mask))
+	);
+
+	if (is_primary) {
+		for (int i = 0; i < thread_state.tile_light_count; i++) {
+			int light = thread_state.tile_lights[i];
+
+			if (scene->light_bvh.overlaps(light, region)) {
+				thread_state.lights[light_count++] = light;
+			}
+		}
+	} else {
+		light_count = scene->light_bvh.query(region, thread_state.lights);
+	}
+#else
+	for (int i = 0; i < scene->point_light_count + scene->spot_light_count; i++) {
+		thread_state.lights[light_count++] = i;
+	}
+#endif
+
+	for (int i = 0; i < scene->directional_light_count; i++) {
+		thread_state.lights[light_count++] = scene->point_light_count + scene->spot_light_count + i;
+	}
+
+	return light_count;
+}
+
+template<int L>
+void Raytracer<L>::get_light_direction(int light, const SIMD_Vector3<L> & point, SIMD_Vector3<L> & to_light, SIMD_float<L> & distance_to_light, SIMD_float<L> & distance_to_light_squared) const {
+	if (light < scene->point_light_count + scene->spot_light_count) {
+		// SpotLight derives from PointLight
+		const PointLight & point_light = light < scene->point_light_count ?
+			scene->point_lights[light] :
+			scene->spot_lights [light - scene->point_light_count];
+
+		to_light = SIMD_Vector3<L>(point_light.position) - point;
+		distance_to_light_squared = SIMD_Vector3<L>::length_squared(to_light);
+		distance_to_light         = SIMD_float<L>::sqrt(distance_to_light_squared);
+
+		to_light /= distance_to_light;
+	} else {
+		to_light          = SIMD_Vector3<L>(scene->directional_lights[light - scene->point_light_count - scene->spot_light_count].negative_direction);
+		distance_to_light = SIMD_float<L>(INFINITY);
+	}
+}
+
+// Determines which lanes can receive light from the given Light, ignoring occlusion. This is the case if the Light is in front of
+// the surface, inside the cone of a SpotLight, and close enough that the upper bound on its lighting reaches SHADOW_RAY_CULLING_THRESHOLD
+template<int L>
+SIMD_float<L> Raytracer<L>::calc_contribution_mask(int light, const SIMD_Vector3<L> & normal, const SIMD_Vector3<L> & to_light, SIMD_float<L> distance_to_light_squared) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+
+	SIMD_float<L> n_dot_l = SIMD_Vector3<L>::dot(normal, to_light);
+
+	SIMD_float<L> mask = n_dot_l > zero;
+
+	if (light < scene->point_light_count + scene->spot_light_count) {
+		const PointLight & point_light = light < scene->point_light_count ?
+			scene->point_lights[light] :
+			scene->spot_lights [light - scene->point_light_count];
+
+		if (light >= scene->point_light_count) {
+			const SpotLight & spot_light = scene->spot_lights[light - scene->point_light_count];
+
+			mask = mask & (SIMD_Vector3<L>::dot(to_light, SIMD_Vector3<L>(spot_light.negative_direction)) > SIMD_float<L>(spot_light.outer_cutoff));
+		}
+
+		// The specular term of Light::calc_lighting is at most one
+		SIMD_float<L> max_colour(std::max(std::max(point_light.colour.x, point_light.colour.y), point_light.colour.z));
+
+		mask = mask & (max_colour * (n_dot_l + one) >= SIMD_float<L>(SHADOW_RAY_CULLING_THRESHOLD) * distance_to_light_squared);
+	}
+
+	return mask;
+}
+
+template<int L>
+SIMD_Vector3<L> Raytracer<L>::calc_lighting(int light, const SIMD_Vector3<L> & normal, const SIMD_Vector3<L> & to_light, const SIMD_Vector3<L> & to_camera, SIMD_float<L> distance_to_light_squared) const {
+	if (light < scene->point_light_count) {
+		return scene->point_lights[light].calc_lighting(normal, to_light, to_camera, distance_to_light_squared);
+	} else if (light < scene->point_light_count + scene->spot_light_count) {
+		return scene->spot_lights[light - scene->point_light_count].calc_lighting(normal, to_light, to_camera, distance_to_light_squared);
+	} else {
+		return scene->directional_lights[light - scene->point_light_count - scene->spot_light_count].calc_lighting(normal, to_camera);
+	}
+}
+
+// Checks which lanes of the Shadow Ray packet are occluded. The last Occluder of the Light is tested first,
+// if it occludes all lanes the traversal of the Scene is skipped. Otherwise the Occluder is updated by the traversal
+template<int L>
+SIMD_float<L> Raytracer<L>::intersect_shadow(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder, PerformanceStats & stats) const {
+	SIMD_float<L> result(0.0f);
+
+#if SHADOW_OCCLUDER_CACHE
+	if (occluder.instance_id != INVALID) {
+		result = scene->top_level_bvh.primitives[occluder.instance_id].intersect_occluder(occluder, ray, max_distance);
+
+		if (SIMD_float<L>::all_true(result)) {
+			stats.num_shadow_cache_hits++;
+
+			return result;
+		}
+
+		// Lanes that are already occluded are retired
+		max_distance = SIMD_float<L>::blend(max_distance, SIMD_float<L>(0.0f), result);
+	}
+#endif
+
+	return result | scene->intersect_primitives(ray, max_distance, occluder);
+}
+
+// Batched version of the above, every Light in the batch tests its own Occluder first
+template<int L>
+void Raytracer<L>::intersect_shadow(ShadowRayBatch<L> & batch, PerformanceStats & stats) const {
+#if SHADOW_OCCLUDER_CACHE
+	for (int l = 0; l < batch.size; l++) {
+		const Occluder & occluder = *batch.occluders[l];
+		if (occluder.instance_id == INVALID) continue;
+
+		batch.occlude(l, scene->top_level_bvh.primitives[occluder.instance_id].intersect_occluder(occluder, batch.rays[l], batch.max_distance[l]));
+
+		if ((batch.active_mask & (1 << l)) == 0) stats.num_shadow_cache_hits++;
+	}
+
+	if (batch.active_mask == 0) return;
+#endif
+
+	// A single remaining Light is cheaper to trace with the regular traversal, which keeps the state of the Ray in registers
+	if (_mm_popcnt_u32(batch.active_mask) == 1) {
+		int l = _tzcnt_u32(batch.active_mask);
+
+		batch.occlude(l, scene->intersect_primitives(batch.rays[l], batch.max_distance[l], *batch.occluders[l]));
+
+		return;
+	}
+
+	scene->intersect_primitives(batch);
 }
+
+#define INSTANTIATE_RAYTRACER(L) template struct Raytracer<L>;
+
+SIMD_LANE_SIZES(INSTANTIATE_RAYTRACER)
@@ -1,18 +1,107 @@
 #pragma once
 #include "Scene.h"
 
+#include "Wavefront.h"
+
 struct PerformanceStats {
 	int num_primary_rays;
 	int num_shadow_rays;
 	int num_reflection_rays;
 	int num_refraction_rays;
+
+	int num_shadow_cache_hits; // Shadow Rays that were occluded by the cached Occluder of their Light, without traversing the Scene
+
+	int num_shadow_rays_skipped; // Shadow Rays that were not traced because their Light could not contribute to any lane, see Raytracer::calc_contribution_mask
+
+	int num_bounce_lanes_terminated; // Lanes of reflected and refracted Rays that were not traced because their weight was too small, see BOUNCE_TERMINATION
+
+	int num_packet_traversals;     // Bottom Level BVH traversals by a whole packet
+	int num_single_ray_traversals; // Bottom Level BVH traversals by a single lane of an incoherent packet, see BVH_HYBRID_TRAVERSAL
+
+	int num_primary_node_fetches; // BVH Nodes fetched while tracing primary Rays, see PRIMARY_RAY_LARGE_PACKETS. Only counted with BVH_COUNT_NODE_FETCHES
+};
+
+// Secondary Ray packet waiting to be traced, see Raytracer::shade
+template<int L>
+struct PendingRay {
+	Ray<L> ray;
+
+	SIMD_float<L> max_distance; // Zero for retired lanes
+
+	SIMD_Vector3<L> weight;     // Fraction of the colour found along this Ray that ends up in its pixel
+	SIMD_Vector3<L> absorption; // Beer's Law is applied to the weight once the distance travelled through the medium is known, zero outside of a medium
+
+	int bounces_left;
+};
+
+// Shading is depth first and every bounce pushes at most two Rays, so the stack holds at most one pending Ray per bounce plus one
+#define RAY_STACK_SIZE (MAX_NUMBER_OF_BOUNCES + 1)
+
+// Memory owned by a single thread, every array contains one entry per Light, see Raytracer::get_light_count()
+template<int L>
+struct ThreadState {
+	Occluder * occluders; // Last Occluder of every Light, see Raytracer::intersect_shadow
+
+	int * tile_lights; // Lights whose region of influence overlaps the frustum of the current tile
+	int   tile_light_count;
+
+	int * lights; // Lights that are shaded at the current hit, see Raytracer::gather_lights
+
+	PendingRay<L> * ray_stack; // Holds RAY_STACK_SIZE Rays
+	int             ray_stack_size;
+
+#if RAYTRACER_WAVEFRONT
+	WavefrontQueues wavefront;
+#endif
 };
 
+template<int L>
 struct Raytracer {
-	const Scene * scene;
+	const Scene<L> * scene;
+
+	int number_of_bounces = NUMBER_OF_BOUNCES; // Can be changed between frames, up to MAX_NUMBER_OF_BOUNCES
+
+	// Selects the shading kernel that is specialized for the features used by the Scene, see Raytracer::shade
+	void init(const Scene<L> * scene);
 	
-	void render_tile(const Window & window, int tile_x, int tile_y, int tile_width, int tile_height, PerformanceStats & stats) const;
+	void render_tile(const Window & window, int tile_x, int tile_y, int tile_width, int tile_height, PerformanceStats & stats, ThreadState<L> & thread_state) const;
+
+	inline int get_light_count() const {
+		return scene->point_light_count + scene->spot_light_count + scene->directional_light_count;
+	}
 
 private:
-	SIMD_Vector3 bounce(const Ray & ray, int bounces_left, SIMD_float & distance, PerformanceStats & stats) const;
+	typedef SIMD_Vector3<L> (Raytracer::* ShadeKernel)(const Ray<L> & ray, const RayHit<L> & closest_hit, PerformanceStats & stats, ThreadState<L> & thread_state) const;
+
+	ShadeKernel shade_kernel = nullptr; // Instantiation of shade() for the current Scene, see Raytracer::init
+
+	// Shades the closest hit of a primary Ray packet, including all of its bounces.
+	// The reflected and refracted Rays are not traced recursively, but kept on the Ray stack of the thread.
+	// Scenes without refractive Materials use an instantiation from which all refraction code is compiled out
+	template<bool HAS_REFRACTION>
+	SIMD_Vector3<L> shade(const Ray<L> & ray, const RayHit<L> & closest_hit, PerformanceStats & stats, ThreadState<L> & thread_state) const;
+
+	// Shades a single bounce and pushes its reflected and refracted Rays, with their weight relative to the pixel, onto the Ray stack.
+	// The last bounce pushes no Rays, so it neither gathers the reflective Materials nor propagates Ray Differentials
+	template<bool IS_LAST_BOUNCE, bool HAS_REFRACTION>
+	SIMD_Vector3<L> bounce(const Ray<L> & ray, const RayHit<L> & closest_hit, const SIMD_Vector3<L> & weight, int bounces_left, PerformanceStats & stats, ThreadState<L> & thread_state) const;
+
+#if RAYTRACER_WAVEFRONT
+	void render_tile_wavefront(const Window & window, int tile_x, int tile_y, int tile_width, int tile_height, PerformanceStats & stats, ThreadState<L> & thread_state) const;
+
+	void trace_wavefront_packet     (const WavefrontRay rays[], int ray_count,            PerformanceStats & stats, ThreadState<L> & thread_state) const;
+	void shade_wavefront_packet     (const WavefrontHit hits[], int hit_count, int bounce, PerformanceStats & stats, ThreadState<L> & thread_state) const;
+	void trace_wavefront_shadow_rays(                                                     PerformanceStats & stats, ThreadState<L> & thread_state) const;
+#endif
+
+	int gather_lights(const SIMD_Vector3<L> & points, SIMD_float<L> hit_mask, bool is_primary, ThreadState<L> & thread_state) const;
+
+	// Lights are numbered in the order point, spot, directional
+	void            get_light_direction(int light, const SIMD_Vector3<L> & point, SIMD_Vector3<L> & to_light, SIMD_float<L> & distance_to_light, SIMD_float<L> & distance_to_light_squared) const;
+	SIMD_Vector3<L> calc_lighting      (int light, const SIMD_Vector3<L> & normal, const SIMD_Vector3<L> & to_light, const SIMD_Vector3<L> & to_camera, SIMD_float<L> distance_to_light_squared) const;
+
+	SIMD_float<L> calc_contribution_mask(int light, const SIMD_Vector3<L> & normal, const SIMD_Vector3<L> & to_light, SIMD_float<L> distance_to_light_squared) const;
+
+	SIMD_float<L> intersect_shadow(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder, PerformanceStats & stats) const;
+	void          intersect_shadow(ShadowRayBatch<L> & batch,                                            PerformanceStats & stats) const;
 };
@@ -4,37 +4,218 @@
 
 #include "Config.h"
 
-#if SIMD_LANE_SIZE == 1
-typedef SIMD_float1 SIMD_float;
-typedef SIMD_int1   SIMD_int;
+// Lane sizes that the SIMD types are specialized for. Code that is templated on the lane size
+// is compiled for all of them, by passing a macro that explicitly instantiates it for one lane size
+#define SIMD_LANE_SIZES(INSTANTIATE) INSTANTIATE(1) INSTANTIATE(4) INSTANTIATE(8) INSTANTIATE(16)
 
-inline FORCEINLINE SIMD_int   SIMD_float_to_int(SIMD_float floats) { return SIMD_int  (floats.data); }
-inline FORCEINLINE SIMD_float SIMD_int_to_float(SIMD_int   ints)   { return SIMD_float(ints.data); }
+// Scalar
+inline FORCEINLINE SIMD_int<1>   SIMD_float_to_int(SIMD_float<1> floats) { return SIMD_int<1>  (Util::float_to_int(floats.data)); } // Rounds to nearest, like the wider lane sizes
+inline FORCEINLINE SIMD_float<1> SIMD_int_to_float(SIMD_int<1>   ints)   { return SIMD_float<1>(float(ints.data)); }
 
-inline FORCEINLINE SIMD_int   SIMD_float_as_int(SIMD_float floats) { return SIMD_int  (*reinterpret_cast<int   *>(&floats.data)); }
-inline FORCEINLINE SIMD_float SIMD_int_as_float(SIMD_int   ints)   { return SIMD_float(*reinterpret_cast<float *>(&ints.data)); }
-#elif SIMD_LANE_SIZE == 4
-typedef SIMD_float4 SIMD_float;
-typedef SIMD_int4   SIMD_int;
+inline FORCEINLINE SIMD_int<1>   SIMD_float_as_int(SIMD_float<1> floats) { return SIMD_int<1>  (*reinterpret_cast<int   *>(&floats.data)); }
+inline FORCEINLINE SIMD_float<1> SIMD_int_as_float(SIMD_int<1>   ints)   { return SIMD_float<1>(*reinterpret_cast<float *>(&ints.data)); }
 
-inline FORCEINLINE SIMD_int   SIMD_float_to_int(SIMD_float floats) { return SIMD_int  (_mm_cvtps_epi32(floats.data)); }
-inline FORCEINLINE SIMD_float SIMD_int_to_float(SIMD_int   ints)   { return SIMD_float(_mm_cvtepi32_ps(ints.data)); }
+inline FORCEINLINE SIMD_float<1> SIMD_float_gather(const float * memory, SIMD_int<1> indices) { return SIMD_float<1>(memory[indices.data]); }
+inline FORCEINLINE SIMD_int<1>   SIMD_int_gather  (const int   * memory, SIMD_int<1> indices) { return SIMD_int<1>  (memory[indices.data]); }
 
-inline FORCEINLINE SIMD_int   SIMD_float_as_int(SIMD_float floats) { return SIMD_int  (_mm_castps_si128(floats.data)); }
-inline FORCEINLINE SIMD_float SIMD_int_as_float(SIMD_int   ints)   { return SIMD_float(_mm_castsi128_ps(ints.data)); }
-#elif SIMD_LANE_SIZE == 8
-typedef SIMD_float8 SIMD_float;
-typedef SIMD_int8   SIMD_int;
+// SSE
+inline FORCEINLINE SIMD_int<4>   SIMD_float_to_int(SIMD_float<4> floats) { return SIMD_int<4>  (_mm_cvtps_epi32(floats.data)); }
+inline FORCEINLINE SIMD_float<4> SIMD_int_to_float(SIMD_int<4>   ints)   { return SIMD_float<4>(_mm_cvtepi32_ps(ints.data)); }
 
-inline FORCEINLINE SIMD_int   SIMD_float_to_int(SIMD_float floats) { return SIMD_int  (_mm256_cvtps_epi32(floats.data)); }
-inline FORCEINLINE SIMD_float SIMD_int_to_float(SIMD_int   ints)   { return SIMD_float(_mm256_cvtepi32_ps(ints.data)); }
+inline FORCEINLINE SIMD_int<4>   SIMD_float_as_int(SIMD_float<4> floats) { return SIMD_int<4>  (_mm_castps_si128(floats.data)); }
+inline FORCEINLINE SIMD_float<4> SIMD_int_as_float(SIMD_int<4>   ints)   { return SIMD_float<4>(_mm_castsi128_ps(ints.data)); }
 
-inline FORCEINLINE SIMD_int   SIMD_float_as_int(SIMD_float floats) { return SIMD_int  (_mm256_castps_si256(floats.data)); }
-inline FORCEINLINE SIMD_float SIMD_int_as_float(SIMD_int   ints)   { return SIMD_float(_mm256_castsi256_ps(ints.data)); }
-#else
-static_assert(false, "Unsupported Lane Size!");
-#endif
+// SSE has no gather instruction
+inline FORCEINLINE SIMD_float<4> SIMD_float_gather(const float * memory, SIMD_int<4> indices) { return SIMD_float<4>(memory[indices.ints[3]], memory[indices.ints[2]], memory[indices.ints[1]], memory[indices.ints[0]]); }
+inline FORCEINLINE SIMD_int<4>   SIMD_int_gather  (const int   * memory, SIMD_int<4> indices) { return SIMD_int<4>  (_mm_set_epi32(memory[indices.ints[3]], memory[indices.ints[2]], memory[indices.ints[1]], memory[indices.ints[0]])); }
 
-inline FORCEINLINE SIMD_float SIMD_float::mod(const SIMD_float & v, const SIMD_float & m) { return SIMD_float(v - m * SIMD_float::floor(v / m)); }
+// AVX
+inline FORCEINLINE SIMD_int<8>   SIMD_float_to_int(SIMD_float<8> floats) { return SIMD_int<8>  (_mm256_cvtps_epi32(floats.data)); }
+inline FORCEINLINE SIMD_float<8> SIMD_int_to_float(SIMD_int<8>   ints)   { return SIMD_float<8>(_mm256_cvtepi32_ps(ints.data)); }
 
-inline FORCEINLINE SIMD_float SIMD_float::clamp(const SIMD_float & val, const SIMD_float & min, const SIMD_float & max) { return SIMD_float::min(SIMD_float::max(val, min), max); }
+inline FORCEINLINE SIMD_int<8>   SIMD_float_as_int(SIMD_float<8> floats) { return SIMD_int<8>  (_mm256_castps_si256(floats.data)); }
+inline FORCEINLINE SIMD_float<8> SIMD_int_as_float(SIMD_int<8>   ints)   { return SIMD_float<8>(_mm256_castsi256_ps(ints.data)); }
+
+inline FORCEINLINE SIMD_float<8> SIMD_float_gather(const float * memory, SIMD_int<8> indices) { return SIMD_float<8>(_mm256_i32gather_ps(memory, indices.data, sizeof(float))); }
+inline FORCEINLINE SIMD_int<8>   SIMD_int_gather  (const int   * memory, SIMD_int<8> indices) { return SIMD_int<8>  (_mm256_i32gather_epi32(memory, indices.data, sizeof(int))); }
+
+// AVX-512
+inline FORCEINLINE SIMD_int<16>   SIMD_float_to_int(SIMD_float<16> floats) { return SIMD_int<16>  (_mm512_cvtps_epi32(floats.data)); }
+inline FORCEINLINE SIMD_float<16> SIMD_int_to_float(SIMD_int<16>   ints)   { return SIMD_float<16>(_mm512_cvtepi32_ps(ints.data)); }
+
+inline FORCEINLINE SIMD_int<16>   SIMD_float_as_int(SIMD_float<16> floats) { return SIMD_int<16>  (_mm512_castps_si512(floats.data)); }
+inline FORCEINLINE SIMD_float<16> SIMD_int_as_float(SIMD_int<16>   ints)   { return SIMD_float<16>(_mm512_castsi512_ps(ints.data)); }
+
+inline FORCEINLINE SIMD_float<16> SIMD_float_gather(const float * memory, SIMD_int<16> indices) { return SIMD_float<16>(_mm512_i32gather_ps(indices.data, memory, sizeof(float))); }
+inline FORCEINLINE SIMD_int<16>   SIMD_int_gather  (const int   * memory, SIMD_int<16> indices) { return SIMD_int<16>  (_mm512_i32gather_epi32(indices.data, memory, sizeof(int))); }
+
+// Polynomial approximations of the transcendental functions, shared by all lane sizes so that they
+// do not depend on SVML. The coefficients are the single precision minimax polynomials from Cephes.
+// Maximum errors, measured against double precision libm:
+//   sin, cos   |x| <= pi        2 ulp
+//              |x| <= 8192      absolute error below 1e-7
+//   tan        |x| <= 1.5       3 ulp
+//   asin, acos [-1, 1]          2 ulp  (|x| slightly above 1 is clamped instead of giving NaN)
+//   atan       all x            2 ulp
+//   atan2      all x, y         3 ulp  (atan2(0, 0) gives 0)
+//   exp        [-87.3, 88.3]    1 ulp  (results below 2^-126 flush to 0, inputs above 88.37 saturate)
+//   log2       positive normal  2 ulp  (0 gives -127 instead of -inf, infinity and NaN are passed through)
+namespace SIMD_Math {
+	template<int L> inline FORCEINLINE SIMD_float<L> sign_bit() { return SIMD_int_as_float(SIMD_int<L>(int(0x80000000))); }
+
+	template<int L> inline FORCEINLINE SIMD_float<L> abs(const SIMD_float<L> & x) { return SIMD_float<L>::andnot(sign_bit<L>(), x); }
+
+	// Rounds to the nearest integer, halfway cases are rounded up
+	template<int L> inline FORCEINLINE SIMD_float<L> round(const SIMD_float<L> & x) { return SIMD_float<L>::floor(x + SIMD_float<L>(0.5f)); }
+
+	// Computes 2^n for integral n in [-126, 127]
+	template<int L> inline FORCEINLINE SIMD_float<L> exp2i(const SIMD_float<L> & n) { return SIMD_int_as_float((SIMD_float_to_int(n) + SIMD_int<L>(127)) * SIMD_int<L>(1 << 23)); }
+
+	// Evaluates sin(x) or cos(x), based on the quadrant offset
+	template<int L> inline FORCEINLINE SIMD_float<L> sin_cos(const SIMD_float<L> & x, const SIMD_float<L> & quadrant_offset) {
+		// Reduce x to r in [-pi/4, pi/4], such that x = q * pi/2 + r, using an extended precision pi/2
+		SIMD_float<L> q = round(x * SIMD_float<L>(0.63661977236f));
+		SIMD_float<L> r = SIMD_float<L>::madd(q, SIMD_float<L>(-1.5703125f),               x);
+		r               = SIMD_float<L>::madd(q, SIMD_float<L>(-4.837512969970703125e-4f), r);
+		r               = SIMD_float<L>::madd(q, SIMD_float<L>(-7.54978995489188216e-8f),  r);
+
+		SIMD_float<L> r2 = r * r;
+
+		SIMD_float<L> poly_sin = SIMD_float<L>::madd(SIMD_float<L>::madd(SIMD_float<L>::madd(SIMD_float<L>(-1.9515295891e-4f), r2, SIMD_float<L>(8.3321608736e-3f)), r2, SIMD_float<L>(-1.6666654611e-1f)), r2 * r, r);
+		SIMD_float<L> poly_cos = SIMD_float<L>::madd(SIMD_float<L>::madd(SIMD_float<L>::madd(SIMD_float<L>(2.443315711809948e-5f), r2, SIMD_float<L>(-1.388731625493765e-3f)), r2, SIMD_float<L>(4.166664568298827e-2f)), r2 * r2, SIMD_float<L>::madd(SIMD_float<L>(-0.5f), r2, SIMD_float<L>(1.0f)));
+
+		// The quadrant determines whether the sine or cosine polynomial is used, and its sign
+		q = q + quadrant_offset;
+		SIMD_float<L> quadrant = q - SIMD_float<L>(4.0f) * SIMD_float<L>::floor(q * SIMD_float<L>(0.25f)); // q mod 4
+
+		SIMD_float<L> result = SIMD_float<L>::blend(poly_sin, poly_cos, (quadrant == SIMD_float<L>(1.0f)) | (quadrant == SIMD_float<L>(3.0f)));
+		return SIMD_float<L>::blend(result, -result, quadrant >= SIMD_float<L>(2.0f));
+	}
+
+	// Evaluates asin(s) for s in [0, 0.5], z should be s*s
+	template<int L> inline FORCEINLINE SIMD_float<L> asin_poly(const SIMD_float<L> & s, const SIMD_float<L> & z) {
+		SIMD_float<L> p = SIMD_float<L>::madd(SIMD_float<L>(4.2163199048e-2f), z, SIMD_float<L>(2.4181311049e-2f));
+		p = SIMD_float<L>::madd(p, z, SIMD_float<L>(4.5470025998e-2f));
+		p = SIMD_float<L>::madd(p, z, SIMD_float<L>(7.4953002686e-2f));
+		p = SIMD_float<L>::madd(p, z, SIMD_float<L>(1.6666752422e-1f));
+
+		return SIMD_float<L>::madd(p * z, s, s);
+	}
+
+	template<int L> inline FORCEINLINE SIMD_float<L> mod(const SIMD_float<L> & v, const SIMD_float<L> & m) { return v - m * SIMD_float<L>::floor(v / m); }
+
+	template<int L> inline FORCEINLINE SIMD_float<L> clamp(const SIMD_float<L> & val, const SIMD_float<L> & min, const SIMD_float<L> & max) { return SIMD_float<L>::min(SIMD_float<L>::max(val, min), max); }
+
+	template<int L> inline FORCEINLINE SIMD_float<L> sin(const SIMD_float<L> & floats) { return sin_cos(floats, SIMD_float<L>(0.0f)); }
+	template<int L> inline FORCEINLINE SIMD_float<L> cos(const SIMD_float<L> & floats) { return sin_cos(floats, SIMD_float<L>(1.0f)); }
+	template<int L> inline FORCEINLINE SIMD_float<L> tan(const SIMD_float<L> & floats) { return sin(floats) / cos(floats); }
+
+	template<int L> inline FORCEINLINE SIMD_float<L> asin(const SIMD_float<L> & floats) {
+		SIMD_float<L> a   = abs(floats);
+		SIMD_float<L> big = a > SIMD_float<L>(0.5f);
+
+		// For |x| > 0.5 use asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2))
+		SIMD_float<L> z = SIMD_float<L>::blend(a * a, SIMD_float<L>::max(SIMD_float<L>(0.5f) - SIMD_float<L>(0.5f) * a, SIMD_float<L>(0.0f)), big);
+		SIMD_float<L> s = SIMD_float<L>::blend(a,     SIMD_float<L>::sqrt(z), big);
+
+		SIMD_float<L> p = asin_poly(s, z);
+		SIMD_float<L> result = SIMD_float<L>::blend(p, SIMD_float<L>::madd(SIMD_float<L>(-2.0f), p, SIMD_float<L>(1.57079632679f)), big);
+
+		return result | (floats & sign_bit<L>());
+	}
+
+	template<int L> inline FORCEINLINE SIMD_float<L> acos(const SIMD_float<L> & floats) {
+		SIMD_float<L> a   = abs(floats);
+		SIMD_float<L> big = a > SIMD_float<L>(0.5f);
+
+		// For |x| > 0.5 use acos(x) = 2 asin(sqrt((1 - x) / 2)), which is accurate near x = 1
+		SIMD_float<L> z = SIMD_float<L>::blend(a * a, SIMD_float<L>::max(SIMD_float<L>(0.5f) - SIMD_float<L>(0.5f) * a, SIMD_float<L>(0.0f)), big);
+		SIMD_float<L> s = SIMD_float<L>::blend(a,     SIMD_float<L>::sqrt(z), big);
+
+		SIMD_float<L> p = asin_poly(s, z);
+		SIMD_float<L> result = SIMD_float<L>::blend(SIMD_float<L>(1.57079632679f) - p, p + p, big); // acos(|x|)
+
+		return SIMD_float<L>::blend(result, SIMD_float<L>(3.14159265359f) - result, floats < SIMD_float<L>(0.0f));
+	}
+
+	template<int L> inline FORCEINLINE SIMD_float<L> atan(const SIMD_float<L> & floats) {
+		SIMD_float<L> a = abs(floats);
+
+		// Reduce the argument using atan(x) = pi/2 + atan(-1/x) and atan(x) = pi/4 + atan((x - 1) / (x + 1))
+		SIMD_float<L> big    = a > SIMD_float<L>(2.414213562373095f);  // tan(3pi/8)
+		SIMD_float<L> medium = a > SIMD_float<L>(0.4142135623730950f); // tan( pi/8)
+
+		SIMD_float<L> offset = SIMD_float<L>::blend(SIMD_float<L>::blend(SIMD_float<L>(0.0f), SIMD_float<L>(0.78539816339f), medium), SIMD_float<L>(1.57079632679f), big);
+		SIMD_float<L> t      = SIMD_float<L>::blend(SIMD_float<L>::blend(a, (a - SIMD_float<L>(1.0f)) / (a + SIMD_float<L>(1.0f)), medium), SIMD_float<L>(-1.0f) / a, big);
+
+		SIMD_float<L> z = t * t;
+		SIMD_float<L> p = SIMD_float<L>::madd(SIMD_float<L>(8.05374449538e-2f), z, SIMD_float<L>(-1.38776856032e-1f));
+		p = SIMD_float<L>::madd(p, z, SIMD_float<L>(1.99777106478e-1f));
+		p = SIMD_float<L>::madd(p, z, SIMD_float<L>(-3.33329491539e-1f));
+
+		SIMD_float<L> result = offset + SIMD_float<L>::madd(p * z, t, t);
+
+		return result | (floats & sign_bit<L>());
+	}
+
+	template<int L> inline FORCEINLINE SIMD_float<L> atan2(const SIMD_float<L> & y, const SIMD_float<L> & x) {
+		SIMD_float<L> result = atan(y / x);
+
+		// Move the result into the left half plane if x is negative, using the sign of y
+		SIMD_float<L> pi = SIMD_float<L>(3.14159265359f) | (y & sign_bit<L>());
+		result = SIMD_float<L>::blend(result, result + pi, x < SIMD_float<L>(0.0f));
+
+		// Division by zero would lose the sign of y if x is -0, and gives NaN if y is 0 as well
+		SIMD_float<L> x_zero = x == SIMD_float<L>(0.0f);
+		result = SIMD_float<L>::blend(result, SIMD_float<L>(1.57079632679f) | (y & sign_bit<L>()), x_zero);
+		return SIMD_float<L>::blend(result, SIMD_float<L>(0.0f), x_zero & (y == SIMD_float<L>(0.0f)));
+	}
+
+	template<int L> inline FORCEINLINE SIMD_float<L> exp(const SIMD_float<L> & floats) {
+		SIMD_float<L> x = clamp(floats, SIMD_float<L>(-88.3762626647949f), SIMD_float<L>(88.3762626647949f));
+
+		// Write exp(x) as 2^n * exp(r), where n = round(x / ln(2)) and r in [-ln(2)/2, ln(2)/2]
+		SIMD_float<L> n = round(x * SIMD_float<L>(1.44269504088896341f));
+		SIMD_float<L> r = SIMD_float<L>::madd(n, SIMD_float<L>(-0.693359375f), x);
+		r               = SIMD_float<L>::madd(n, SIMD_float<L>(2.12194440e-4f),  r);
+
+		SIMD_float<L> p = SIMD_float<L>::madd(SIMD_float<L>(1.9875691500e-4f), r, SIMD_float<L>(1.3981999507e-3f));
+		p = SIMD_float<L>::madd(p, r, SIMD_float<L>(8.3334519073e-3f));
+		p = SIMD_float<L>::madd(p, r, SIMD_float<L>(4.1665795894e-2f));
+		p = SIMD_float<L>::madd(p, r, SIMD_float<L>(1.6666665459e-1f));
+		p = SIMD_float<L>::madd(p, r, SIMD_float<L>(5.0000001201e-1f));
+		p = SIMD_float<L>::madd(p, r * r, r + SIMD_float<L>(1.0f));
+
+		return p * exp2i(n);
+	}
+
+	template<int L> inline FORCEINLINE SIMD_float<L> log2(const SIMD_float<L> & floats) {
+		// Write x as 2^e * m, with the exponent e and mantissa m in [1, 2) read directly from the bits of x
+		SIMD_float<L> e = SIMD_int_to_float(SIMD_float_as_int(floats & SIMD_int_as_float(SIMD_int<L>(0x7f800000)))) * SIMD_float<L>(1.0f / float(1 << 23)) - SIMD_float<L>(127.0f);
+		SIMD_float<L> m = (floats & SIMD_int_as_float(SIMD_int<L>(0x007fffff))) | SIMD_float<L>(1.0f);
+
+		// Move m into [sqrt(1/2), sqrt(2)) so that the polynomial is evaluated around ln(1) = 0
+		SIMD_float<L> big = m > SIMD_float<L>(1.41421356237f);
+		m = SIMD_float<L>::blend(m, m * SIMD_float<L>(0.5f), big);
+		e = SIMD_float<L>::blend(e, e + SIMD_float<L>(1.0f), big);
+
+		SIMD_float<L> x = m - SIMD_float<L>(1.0f);
+		SIMD_float<L> z = x * x;
+
+		SIMD_float<L> p = SIMD_float<L>::madd(SIMD_float<L>(7.0376836292e-2f), x, SIMD_float<L>(-1.1514610310e-1f));
+		p = SIMD_float<L>::madd(p, x, SIMD_float<L>(1.1676998740e-1f));
+		p = SIMD_float<L>::madd(p, x, SIMD_float<L>(-1.2420140846e-1f));
+		p = SIMD_float<L>::madd(p, x, SIMD_float<L>(1.4249322787e-1f));
+		p = SIMD_float<L>::madd(p, x, SIMD_float<L>(-1.6668057665e-1f));
+		p = SIMD_float<L>::madd(p, x, SIMD_float<L>(2.0000714765e-1f));
+		p = SIMD_float<L>::madd(p, x, SIMD_float<L>(-2.4999993993e-1f));
+		p = SIMD_float<L>::madd(p, x, SIMD_float<L>(3.3333331174e-1f));
+
+		SIMD_float<L> ln_m = x + SIMD_float<L>::madd(p * x, z, SIMD_float<L>(-0.5f) * z);
+
+		SIMD_float<L> result = SIMD_float<L>::madd(ln_m, SIMD_float<L>(1.44269504088896341f), e);
+
+		// Infinity and NaN are passed through
+		return SIMD_float<L>::blend(floats, result, floats < SIMD_float<L>(INFINITY));
+	}
+}
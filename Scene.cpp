@@ -4,32 +4,33 @@
 #include "Spline.h"
 
 #if SCENE == SCENE_DYNAMIC
-Scene::Scene() : camera(DEG_TO_RAD(110.0f)), spheres(2), planes(1), sky(DATA_PATH("Sky_Probes/rnl_probe.float")) {
+template<int L>
+Scene<L>::Scene() : camera(DEG_TO_RAD(110.0f)), spheres(2), planes(1), sky(DATA_PATH("Sky_Probes/rnl_probe.float")) {
 	spheres[0].init(1.0f);
 	spheres[1].init(1.0f);
 	spheres[0].transform.position = Vector3(-2.0f, 0.0f, 10.0f);
 	spheres[1].transform.position = Vector3(+2.0f, 0.0f, 10.0f);
-	MaterialBuffer::materials[spheres[0].material_id].diffuse = Vector3(0.2f, 0.2f, 0.0f);
-	MaterialBuffer::materials[spheres[1].material_id].diffuse = Vector3(0.0f, 0.2f, 0.2f);
-	MaterialBuffer::materials[spheres[0].material_id].reflection = Vector3(0.6f, 0.6f, 0.0f);
-	MaterialBuffer::materials[spheres[1].material_id].reflection = Vector3(0.0f, 0.6f, 0.6f);
-	MaterialBuffer::materials[spheres[0].material_id].transmittance = 0.6f;
-	MaterialBuffer::materials[spheres[1].material_id].transmittance = 0.6f;
-	MaterialBuffer::materials[spheres[0].material_id].index_of_refraction = 1.33f;
-	MaterialBuffer::materials[spheres[1].material_id].index_of_refraction = 1.68f;
+	MaterialBuffer::diffuse            [spheres[0].material_id] = Vector3(0.2f, 0.2f, 0.0f);
+	MaterialBuffer::diffuse            [spheres[1].material_id] = Vector3(0.0f, 0.2f, 0.2f);
+	MaterialBuffer::reflection         [spheres[0].material_id] = Vector3(0.6f, 0.6f, 0.0f);
+	MaterialBuffer::reflection         [spheres[1].material_id] = Vector3(0.0f, 0.6f, 0.6f);
+	MaterialBuffer::transmittance      [spheres[0].material_id] = 0.6f;
+	MaterialBuffer::transmittance      [spheres[1].material_id] = 0.6f;
+	MaterialBuffer::index_of_refraction[spheres[0].material_id] = 1.33f;
+	MaterialBuffer::index_of_refraction[spheres[1].material_id] = 1.68f;
 
 	planes[0].transform.position.y = -1.0f;
 	planes[0].transform.rotation   = Quaternion::axis_angle(Vector3(0.0f, 1.0f, 0.0f), 0.25f * PI);
-	MaterialBuffer::materials[planes[0].material_id].texture    = Texture::load(DATA_PATH("Floor.png"));
-	MaterialBuffer::materials[planes[0].material_id].reflection = 0.1f;
+	MaterialBuffer::texture   [planes[0].material_id] = Texture::load(DATA_PATH("Floor.png"));
+	MaterialBuffer::reflection[planes[0].material_id] = 0.1f;
 	
 	top_level_bvh.init(6);
-	Mesh * diamond   = top_level_bvh.primitives;
-	Mesh * monkey    = top_level_bvh.primitives + 1;
-	Mesh * icosphere = top_level_bvh.primitives + 2;
-	Mesh * rock      = top_level_bvh.primitives + 3;
-	Mesh * torus1    = top_level_bvh.primitives + 4;
-	Mesh * torus2    = top_level_bvh.primitives + 5;
+	Mesh<L> * diamond   = top_level_bvh.primitives;
+	Mesh<L> * monkey    = top_level_bvh.primitives + 1;
+	Mesh<L> * icosphere = top_level_bvh.primitives + 2;
+	Mesh<L> * rock      = top_level_bvh.primitives + 3;
+	Mesh<L> * torus1    = top_level_bvh.primitives + 4;
+	Mesh<L> * torus2    = top_level_bvh.primitives + 5;
 
 	diamond->transform.position   = Vector3( 0.0f, 1.0f, 0.0f);
 	monkey->transform.position    = Vector3( 4.0f, 2.0f, 0.0f);
@@ -68,13 +69,75 @@ Scene::Scene() : camera(DEG_TO_RAD(110.0f)), spheres(2), planes(1), sky(DATA_PAT
 
 	camera.position = Vector3(-4.694016f, 6.446100f, -0.572288f);
 	camera.rotation = Quaternion(0.268476f, 0.423740f, -0.133092f, 0.854779f);
+
+	light_bvh.init(point_lights, point_light_count, spot_lights, spot_light_count);
+}
+#elif SCENE == SCENE_MANY_LIGHTS
+template<int L>
+Scene<L>::Scene() : camera(DEG_TO_RAD(110.0f)), spheres(0), planes(1), sky(DATA_PATH("Sky_Probes/rnl_probe.float")) {
+	planes[0].transform.position.y = -1.0f;
+	MaterialBuffer::texture[planes[0].material_id] = Texture::load(DATA_PATH("Floor.png"));
+
+	const int grid_size    = 8;
+	const float grid_scale = 8.0f;
+
+	top_level_bvh.init(grid_size * grid_size);
+
+	for (int j = 0; j < grid_size; j++) {
+		for (int i = 0; i < grid_size; i++) {
+			Mesh<L> & mesh = top_level_bvh.primitives[i + j * grid_size];
+
+			mesh.transform.position = Vector3(float(i) * grid_scale, 1.0f, float(j) * grid_scale);
+			mesh.transform.rotation = Quaternion::axis_angle(Vector3(0.0f, 1.0f, 0.0f), float(i + j));
+
+			mesh.init((i + j) & 1 ? DATA_PATH("Monkey.obj") : DATA_PATH("Rock.obj"));
+		}
+	}
+
+	int triangle_count = 0;
+	for (int p = 0; p < top_level_bvh.primitive_count; p++) {
+		triangle_count += top_level_bvh.primitives[p].bvh->triangle_count;
+	}
+	printf("Scene contains %i triangles.\n", triangle_count);
+
+	// Lights are spread over the same area as the Meshes, each with a small radius of influence
+	const int light_grid_size = 32;
+
+	point_light_count = light_grid_size * light_grid_size;
+	point_lights = new PointLight[point_light_count];
+
+	float light_spacing = float(grid_size) * grid_scale / float(light_grid_size);
+
+	for (int j = 0; j < light_grid_size; j++) {
+		for (int i = 0; i < light_grid_size; i++) {
+			Vector3 colour(
+				0.5f + 0.5f * sinf(float(i) * 0.7f),
+				0.5f + 0.5f * sinf(float(j) * 0.9f + 2.0f),
+				0.5f + 0.5f * sinf(float(i + j) * 0.3f + 4.0f)
+			);
+			Vector3 position(float(i) * light_spacing, 0.5f + float((i * 7 + j * 3) % 4), float(j) * light_spacing);
+
+			point_lights[i + j * light_grid_size] = PointLight(0.25f * colour, position);
+		}
+	}
+
+	spot_light_count        = 0;
+	directional_light_count = 0;
+
+	ambient_lighting = Vector3(0.05f);
+
+	camera.position = Vector3(-6.0f, 12.0f, -6.0f);
+	camera.rotation = Quaternion::look_rotation(Vector3(1.0f, -0.8f, 1.0f), Vector3(0.0f, 1.0f, 0.0f));
+
+	light_bvh.init(point_lights, point_light_count, spot_lights, spot_light_count);
 }
 #else
 CatmullRomSpline spline_path;
 
-Scene::Scene() : camera(DEG_TO_RAD(110.0f)), spheres(0), planes(0), sky(DATA_PATH("Sky_Probes/rnl_probe.float")) {
+template<int L>
+Scene<L>::Scene() : camera(DEG_TO_RAD(110.0f)), spheres(0), planes(0), sky(DATA_PATH("Sky_Probes/rnl_probe.float")) {
 	top_level_bvh.init(3);
-	top_level_bvh.primitives[0].init(DATA_PATH("sponza/sponza.obj"));
+	top_level_bvh.primitives[0].init(DATA_PATH("sponza/sponza.obj"), BottomLevelBVH<L>::FLAG_TRIANGLE_RECORDS);
 	top_level_bvh.primitives[1].init(DATA_PATH("Magnifier.obj"));
 	top_level_bvh.primitives[2].init(DATA_PATH("Concave.obj"));
 	top_level_bvh.primitives[2].transform.position.x = 20.0f;
@@ -127,16 +190,20 @@ Scene::Scene() : camera(DEG_TO_RAD(110.0f)), spheres(0), planes(0), sky(DATA_PAT
 	
 	camera.position = Vector3(19.729143f, 18.946165f, 0.000000f);
 	camera.rotation = Quaternion(0.000000f, -0.707107f, 0.000000f, 0.707107f);
+
+	light_bvh.init(point_lights, point_light_count, spot_lights, spot_light_count);
 }
 #endif
 
-Scene::~Scene() {
+template<int L>
+Scene<L>::~Scene() {
 	delete [] point_lights;
 	delete [] spot_lights;
 	delete [] directional_lights;
 }
 
-void Scene::update(float delta) {
+template<int L>
+void Scene<L>::update(float delta) {
 #if SCENE == SCENE_DYNAMIC
 	top_level_bvh.primitives[0].transform.rotation = Quaternion::axis_angle(Vector3(0.0f, 1.0f, 0.0f), delta) * top_level_bvh.primitives[0].transform.rotation;
 
@@ -170,21 +237,97 @@ void Scene::update(float delta) {
 	top_level_bvh.build_bvh();
 }
 
-void Scene::trace_primitives(const Ray & ray, RayHit & ray_hit) const {
+template<int L>
+void Scene<L>::trace_primitives(const Ray<L> & ray, RayHit<L> & ray_hit) const {
 	spheres.trace(ray, ray_hit);
 	planes.trace(ray, ray_hit);
 	top_level_bvh.trace(ray, ray_hit);
 }
 
-SIMD_float Scene::intersect_primitives(const Ray & ray, SIMD_float max_distance) const {
-	SIMD_float result(0.0f);
+template<int L>
+void Scene<L>::trace_primitives(LargeRayPacket<L> & packet) const {
+	for (int p = 0; p < packet.packet_count; p++) {
+		spheres.trace(packet.rays[p], packet.hits[p]);
+		planes .trace(packet.rays[p], packet.hits[p]);
+	}
+
+	top_level_bvh.trace(packet);
+}
+
+template<int L>
+SIMD_float<L> Scene<L>::intersect_primitives(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const {
+	const SIMD_float<L> zero(0.0f);
+
+	SIMD_float<L> result(0.0f);
 	
 	result = spheres.intersect(ray, max_distance);
-	if (SIMD_float::all_true(result)) return result;
+	if (SIMD_float<L>::all_true(result)) return result;
+
+	// Lanes that are already occluded are retired by setting their max distance to zero
+	max_distance = SIMD_float<L>::blend(max_distance, zero, result);
 
 	result = result | planes.intersect(ray, max_distance);
-	if (SIMD_float::all_true(result)) return result;
+	if (SIMD_float<L>::all_true(result)) return result;
+
+	max_distance = SIMD_float<L>::blend(max_distance, zero, result);
 
-	result = result | top_level_bvh.intersect(ray, max_distance);
+	result = result | top_level_bvh.intersect(ray, max_distance, occluder);
 	return result;
 }
+
+template<int L>
+void Scene<L>::intersect_primitives(ShadowRayBatch<L> & batch) const {
+	// Spheres and Planes are cheap to test, so they are checked for every Light separately
+	for (int l = 0; l < batch.size; l++) {
+		if ((batch.active_mask & (1 << l)) == 0) continue;
+
+		batch.occlude(l, spheres.intersect(batch.rays[l], batch.max_distance[l]));
+		if ((batch.active_mask & (1 << l)) == 0) continue;
+
+		batch.occlude(l, planes.intersect(batch.rays[l], batch.max_distance[l]));
+	}
+
+	if (batch.active_mask == 0) return;
+
+	top_level_bvh.intersect(batch);
+}
+
+template<int L>
+template<bool PROPAGATE_DIFFERENTIALS>
+void Scene<L>::evaluate_hit(const Ray<L> & ray, const RayHit<L> & ray_hit, HitAttributes<L> & attributes) const {
+	SIMD_int<L> instance_ids  = ray_hit.instance_id;
+	SIMD_int<L> primitive_ids = ray_hit.primitive_id;
+
+	int remaining = SIMD_float<L>::mask(ray_hit.hit);
+
+	// Evaluate all lanes that hit the same Sphere, Plane or Mesh at once
+	for (int i = 0; i < L; i++) {
+		if ((remaining & (1 << i)) == 0) continue;
+
+		int instance_id  = instance_ids [i];
+		int primitive_id = primitive_ids[i];
+
+		SIMD_float<L> mask = ray_hit.hit & SIMD_int_as_float(instance_ids == SIMD_int<L>(instance_id));
+
+		if (instance_id == RayHit<L>::INSTANCE_ID_SPHERE) {
+			mask = mask & SIMD_int_as_float(primitive_ids == SIMD_int<L>(primitive_id));
+
+			spheres[primitive_id].evaluate<PROPAGATE_DIFFERENTIALS>(ray, ray_hit, mask, attributes);
+		} else if (instance_id == RayHit<L>::INSTANCE_ID_PLANE) {
+			mask = mask & SIMD_int_as_float(primitive_ids == SIMD_int<L>(primitive_id));
+
+			planes[primitive_id].evaluate<PROPAGATE_DIFFERENTIALS>(ray, ray_hit, mask, attributes);
+		} else {
+			// Lanes can hit different Triangles of the same Mesh, these are gathered by the Bottom Level BVH
+			top_level_bvh.primitives[instance_id].template evaluate<PROPAGATE_DIFFERENTIALS>(ray, ray_hit, mask, attributes);
+		}
+
+		remaining &= ~SIMD_float<L>::mask(mask);
+	}
+}
+
+#define INSTANTIATE_SCENE(L) \
+	template struct Scene<L>; \
+	template void Scene<L>::evaluate_hit<false>(const Ray<L> & ray, const RayHit<L> & ray_hit, HitAttributes<L> & attributes) const; \
+	template void Scene<L>::evaluate_hit<true> (const Ray<L> & ray, const RayHit<L> & ray_hit, HitAttributes<L> & attributes) const;
+SIMD_LANE_SIZES(INSTANTIATE_SCENE)
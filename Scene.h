@@ -10,17 +10,20 @@
 #include "SpotLight.h"
 #include "DirectionalLight.h"
 
+#include "LightBVH.h"
+
 #include "Camera.h"
 
 #include "Sky.h"
 
 #include "Window.h"
 
+template<int L>
 struct Scene {
 	PrimitiveList<Sphere> spheres;
 	PrimitiveList<Plane>  planes;
 
-	TopLevelBVH top_level_bvh;
+	TopLevelBVH<L> top_level_bvh;
 
 	// Lights
 	PointLight * point_lights      = nullptr;
@@ -32,6 +35,8 @@ struct Scene {
 	DirectionalLight * directional_lights      = nullptr;
 	int                directional_light_count = 0;
 
+	LightBVH light_bvh; // Built over the Point and Spot Lights, Directional Lights affect everything and are always shaded
+
 	Vector3 ambient_lighting = Vector3(0.2f);
 	
 	Sky sky;
@@ -43,6 +48,11 @@ struct Scene {
 	
 	void update(float delta);
 	
-	void       trace_primitives    (const Ray & ray, RayHit & ray_hit) const;
-	SIMD_float intersect_primitives(const Ray & ray, SIMD_float max_distance) const;
+	void          trace_primitives    (const Ray<L> & ray, RayHit<L> & ray_hit) const;
+	void          trace_primitives    (LargeRayPacket<L> & packet) const;
+	SIMD_float<L> intersect_primitives(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const;
+	void          intersect_primitives(ShadowRayBatch<L> & batch) const;
+
+	// The differentials of the hit point and Normal are only needed to propagate Ray Differentials to the next bounce
+	template<bool PROPAGATE_DIFFERENTIALS> void evaluate_hit(const Ray<L> & ray, const RayHit<L> & ray_hit, HitAttributes<L> & attributes) const;
 };
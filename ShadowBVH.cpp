@@ -0,0 +1,265 @@
+#include "ShadowBVH.h"
+
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+
+#include "BVHLayouts.h"
+
+const ShadowBVH * ShadowBVH::build(const Triangle * triangles, int triangle_count) {
+	ShadowBVH * bvh = new ShadowBVH();
+
+	bvh->triangle_count = triangle_count;
+	bvh->nodes = Util::aligned_malloc<BVHNode>(2 * triangle_count, CACHE_LINE_WIDTH);
+
+	int * indices_x = new int[triangle_count];
+	int * indices_y = new int[triangle_count];
+	int * indices_z = new int[triangle_count];
+
+	for (int i = 0; i < triangle_count; i++) {
+		indices_x[i] = i;
+		indices_y[i] = i;
+		indices_z[i] = i;
+	}
+
+	std::sort(indices_x, indices_x + triangle_count, [&](int a, int b) { return triangles[a].get_position().x < triangles[b].get_position().x; });
+	std::sort(indices_y, indices_y + triangle_count, [&](int a, int b) { return triangles[a].get_position().y < triangles[b].get_position().y; });
+	std::sort(indices_z, indices_z + triangle_count, [&](int a, int b) { return triangles[a].get_position().z < triangles[b].get_position().z; });
+
+	int * indices_xyz[3] = { indices_x, indices_y, indices_z };
+
+	float * sah  = new float[triangle_count];
+	int   * temp = new int[triangle_count];
+
+	// Spatial splits would duplicate Triangle references, so a regular SAH based BVH is used
+	bvh->node_count = 2;
+	BVHBuilders::build_bvh(bvh->nodes[0], triangles, indices_xyz, bvh->nodes, bvh->node_count, 0, triangle_count, sah, temp);
+
+	assert(bvh->node_count <= 2 * triangle_count);
+
+#if BVH_LAYOUT == BVH_LAYOUT_VAN_EMDE_BOAS
+	bvh->node_count = BVHLayouts::reorder_van_emde_boas(bvh->nodes, bvh->node_count);
+#endif
+
+	bvh->quantize(triangles, indices_x);
+
+	delete [] indices_x;
+	delete [] indices_y;
+	delete [] indices_z;
+
+	delete [] temp;
+	delete [] sah;
+
+	return bvh;
+}
+
+// Stores the Triangles in the order of the leaves, with their vertices quantized against the bounds of their leaf and deduplicated within the leaf.
+// Leaf Nodes are changed to index the leaf array instead of the Triangle array
+void ShadowBVH::quantize(const Triangle * triangles, const int * indices) {
+	std::vector<Leaf>            quantized_leaves;
+	std::vector<QuantizedVertex> quantized_vertices;
+
+	this->triangles = Util::aligned_malloc<QuantizedTriangle>(triangle_count, CACHE_LINE_WIDTH);
+
+	// Maps a quantized position to its vertex index within the current leaf
+	std::unordered_map<unsigned long long, int> vertex_map;
+
+	int stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack[0] = 0;
+
+	while (stack_size > 0) {
+		BVHNode & node = nodes[stack[--stack_size]];
+
+		if (!node.is_leaf()) {
+			stack[stack_size++] = node.left;
+			stack[stack_size++] = node.left + 1;
+
+			continue;
+		}
+
+		AABB bounds = AABB::create_empty();
+
+		for (int i = node.first; i < node.first + node.count; i++) {
+			const Triangle & triangle = triangles[indices[i]];
+
+			bounds.expand(triangle.position_0);
+			bounds.expand(triangle.position_1);
+			bounds.expand(triangle.position_2);
+		}
+
+		const float max_offset = 65535.0f;
+
+		Vector3 extent = bounds.max - bounds.min;
+		Vector3 inv_scale(
+			extent.x > 0.0f ? max_offset / extent.x : 0.0f,
+			extent.y > 0.0f ? max_offset / extent.y : 0.0f,
+			extent.z > 0.0f ? max_offset / extent.z : 0.0f
+		);
+
+		Leaf leaf;
+		leaf.origin = bounds.min;
+		leaf.scale  = extent / max_offset;
+		leaf.first_vertex   = quantized_vertices.size();
+		leaf.first_triangle = node.first;
+
+		vertex_map.clear();
+
+		for (int i = node.first; i < node.first + node.count; i++) {
+			const Triangle & triangle = triangles[indices[i]];
+
+			Vector3 positions[3] = {
+				triangle.position_0,
+				triangle.position_1,
+				triangle.position_2
+			};
+
+			unsigned short vertex_indices[3];
+
+			for (int v = 0; v < 3; v++) {
+				Vector3 offset = (positions[v] - leaf.origin) * inv_scale;
+
+				QuantizedVertex vertex;
+				vertex.x = Math::clamp(Util::float_to_int(offset.x), 0, 65535);
+				vertex.y = Math::clamp(Util::float_to_int(offset.y), 0, 65535);
+				vertex.z = Math::clamp(Util::float_to_int(offset.z), 0, 65535);
+
+				unsigned long long key =
+					 (unsigned long long)vertex.x |
+					((unsigned long long)vertex.y << 16) |
+					((unsigned long long)vertex.z << 32);
+
+				auto vertex_index = vertex_map.find(key);
+				if (vertex_index == vertex_map.end()) {
+					int new_vertex_index = quantized_vertices.size() - leaf.first_vertex;
+
+					if (new_vertex_index > 65535) {
+						printf("Too many unique vertices in a single Shadow BVH leaf to quantize!\n");
+
+						abort();
+					}
+
+					vertex_index = vertex_map.insert({ key, new_vertex_index }).first;
+
+					quantized_vertices.push_back(vertex);
+				}
+
+				vertex_indices[v] = vertex_index->second;
+			}
+
+			this->triangles[i].vertex_0 = vertex_indices[0];
+			this->triangles[i].vertex_1 = vertex_indices[1];
+			this->triangles[i].vertex_2 = vertex_indices[2];
+		}
+
+		node.first = quantized_leaves.size();
+		quantized_leaves.push_back(leaf);
+	}
+
+	leaf_count   = quantized_leaves.size();
+	vertex_count = quantized_vertices.size();
+
+	leaves   = Util::aligned_malloc<Leaf>           (leaf_count,   CACHE_LINE_WIDTH);
+	vertices = Util::aligned_malloc<QuantizedVertex>(vertex_count, CACHE_LINE_WIDTH);
+
+	memcpy(leaves,   quantized_leaves.data(),   leaf_count   * sizeof(Leaf));
+	memcpy(vertices, quantized_vertices.data(), vertex_count * sizeof(QuantizedVertex));
+
+	int size =
+		node_count     * sizeof(BVHNode) +
+		leaf_count     * sizeof(Leaf) +
+		vertex_count   * sizeof(QuantizedVertex) +
+		triangle_count * sizeof(QuantizedTriangle);
+
+	printf("Shadow BVH contains %i leaves and %i unique vertices, taking %i KB\n", leaf_count, vertex_count, size / 1024);
+}
+
+// Possible hints:
+// _MM_HINT_NTA - non-temporal
+// _MM_HINT_T0  - L1, L2, and L3 cache
+// _MM_HINT_T1  -     L2, and L3 cache
+// _MM_HINT_T2  -             L3 cache
+#define PREFETCH_HINT _MM_HINT_T0
+
+template<int L>
+SIMD_float<L> ShadowBVH::intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const {
+	int stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack[0] = 0;
+
+	const SIMD_float<L> zero(0.0f);
+
+	SIMD_float<L> hit(0.0f);
+
+	SIMD_Vector3<L> inv_direction = SIMD_Vector3<L>::rcp(ray.direction);
+
+	RayInterval interval(ray, inv_direction);
+
+#if BVH_PACKET_CULLING
+	const float packet_max_distance = SIMD_float<L>::hmax(max_distance);
+#endif
+
+	while (stack_size > 0) {
+		// Pop Node of the stack
+		const BVHNode & node = nodes[stack[--stack_size]];
+
+#if BVH_PACKET_CULLING
+		// Reject the Node for the entire packet at once if no lane can possibly hit it
+		if (!node.aabb.intersect(interval, packet_max_distance)) continue;
+#endif
+
+		SIMD_float<L> mask = node.aabb.intersect(ray, inv_direction, max_distance);
+		if (SIMD_float<L>::all_false(mask)) continue;
+
+		if (node.is_leaf()) {
+			const Leaf & leaf = leaves[node.first];
+
+			for (int i = leaf.first_triangle; i < leaf.first_triangle + node.count; i++) {
+				const QuantizedVertex & vertex_0 = vertices[leaf.first_vertex + triangles[i].vertex_0];
+				const QuantizedVertex & vertex_1 = vertices[leaf.first_vertex + triangles[i].vertex_1];
+				const QuantizedVertex & vertex_2 = vertices[leaf.first_vertex + triangles[i].vertex_2];
+
+				Vector3 position_0 = leaf.origin + leaf.scale * Vector3(float(vertex_0.x), float(vertex_0.y), float(vertex_0.z));
+				Vector3 position_1 = leaf.origin + leaf.scale * Vector3(float(vertex_1.x), float(vertex_1.y), float(vertex_1.z));
+				Vector3 position_2 = leaf.origin + leaf.scale * Vector3(float(vertex_2.x), float(vertex_2.y), float(vertex_2.z));
+
+				Vector3 position_edge_1 = position_1 - position_0;
+				Vector3 position_edge_2 = position_2 - position_0;
+
+				SIMD_float<L> triangle_hit = Triangle::intersect(position_0, position_edge_1, position_edge_2, ray, max_distance);
+				if (SIMD_float<L>::all_false(triangle_hit)) continue;
+
+				hit = hit | triangle_hit;
+
+				occluder.position_0      = position_0;
+				occluder.position_edge_1 = position_edge_1;
+				occluder.position_edge_2 = position_edge_2;
+
+				if (SIMD_float<L>::all_true(hit)) return hit;
+			}
+
+			// Lanes that are occluded are retired, they can no longer pass any AABB test
+			max_distance = SIMD_float<L>::blend(max_distance, zero, hit);
+		} else {
+			// Prefetch the cacheline containing the children of the current Node
+			_mm_prefetch(reinterpret_cast<const char *>(nodes + node.left), PREFETCH_HINT);
+
+			if (node.should_visit_left_first_occlusion()) {
+				stack[stack_size++] = node.left + 1;
+				stack[stack_size++] = node.left;
+			} else {
+				stack[stack_size++] = node.left;
+				stack[stack_size++] = node.left + 1;
+			}
+		}
+	}
+
+	return hit;
+}
+
+#define INSTANTIATE_SHADOW_BVH(L) template SIMD_float<L> ShadowBVH::intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const;
+SIMD_LANE_SIZES(INSTANTIATE_SHADOW_BVH)
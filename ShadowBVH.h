@@ -0,0 +1,39 @@
+#pragma once
+#include "BVHBuilders.h"
+#include "Occluder.h"
+
+// Bottom Level BVH that is only used for occlusion queries. It is built without spatial splits,
+// so that every Triangle is referenced exactly once, and it stores nothing but quantized positions
+struct ShadowBVH {
+	struct Leaf {
+		Vector3 origin; // Minimum corner of the bounds of all Triangles in the leaf
+		Vector3 scale;  // Size of one quantization step along each dimension
+
+		int first_vertex;   // Index of the first vertex of the leaf in the vertices array
+		int first_triangle; // Index of the first Triangle of the leaf in the triangles array
+	} * leaves;
+
+	// Vertex position stored as an offset from the leaf origin in quantization steps
+	struct QuantizedVertex {
+		unsigned short x, y, z;
+	} * vertices;
+
+	struct QuantizedTriangle {
+		unsigned short vertex_0, vertex_1, vertex_2; // Relative to the first vertex of the leaf, vertices are shared within a leaf
+	} * triangles;
+
+	int leaf_count;
+	int vertex_count;
+	int triangle_count;
+
+	BVHNode * nodes;
+	int       node_count;
+
+	static const ShadowBVH * build(const Triangle * triangles, int triangle_count);
+
+	template<int L>
+	SIMD_float<L> intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const;
+
+private:
+	void quantize(const Triangle * triangles, const int * indices);
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include "Ray.h"
+#include "Occluder.h"
+
+#include "Config.h"
+
+// Shadow Rays from one packet of hit points towards several Lights, traced through the Scene in a single traversal.
+// Every Light keeps its own lane masks and drops out of the traversal as soon as all of its lanes are occluded
+template<int L>
+struct ShadowRayBatch {
+	int size;        // Number of Lights in the batch
+	int active_mask; // One bit per Light that still has lanes that are not occluded
+
+	Ray<L>        rays        [SHADOW_RAY_BATCH_SIZE]; // All Rays share the same origin, with one direction per Light
+	SIMD_float<L> max_distance[SHADOW_RAY_BATCH_SIZE]; // Occluded lanes are retired by setting their max distance to zero
+	SIMD_float<L> occluded    [SHADOW_RAY_BATCH_SIZE];
+
+	Occluder * occluders[SHADOW_RAY_BATCH_SIZE]; // Last Occluder of every Light, see Raytracer::intersect_shadow
+
+	// Marks the given lanes of a Light as occluded and retires them
+	inline void occlude(int light, SIMD_float<L> mask) {
+		occluded    [light] = occluded[light] | mask;
+		max_distance[light] = SIMD_float<L>::blend(max_distance[light], SIMD_float<L>(0.0f), mask);
+
+		if (SIMD_float<L>::all_true(occluded[light])) {
+			active_mask &= ~(1 << light);
+		}
+	}
+};
@@ -25,44 +25,38 @@ Sky::Sky(const char * file_path) {
 	fclose(file);
 }
 
-SIMD_Vector3 Sky::sample(const SIMD_Vector3 & direction) const {
-	const SIMD_float one_over_pi(ONE_OVER_PI);
-	const SIMD_float half(0.5f);
-	const SIMD_float data_size((float)size);
+template<int L>
+SIMD_Vector3<L> Sky::sample(const SIMD_Vector3<L> & direction) const {
+	const SIMD_float<L> one_over_pi(ONE_OVER_PI);
+	const SIMD_float<L> half(0.5f);
+	const SIMD_float<L> data_size((float)size);
 
 	// Formula as described on https://www.pauldebevec.com/Probes/
-    SIMD_float r = half * one_over_pi * SIMD_float::acos(direction.z) * SIMD_float::inv_sqrt(direction.x*direction.x + direction.y*direction.y);
+    SIMD_float<L> r = half * one_over_pi * SIMD_Math::acos(direction.z) * SIMD_float<L>::inv_sqrt(direction.x*direction.x + direction.y*direction.y);
 
-	SIMD_float u = SIMD_float::madd(direction.x, r, half);
-	SIMD_float v = SIMD_float::madd(direction.y, r, half);
+	SIMD_float<L> u = SIMD_float<L>::madd(direction.x, r, half);
+	SIMD_float<L> v = SIMD_float<L>::madd(direction.y, r, half);
 
 	// Convert to pixel coordinates
-	SIMD_int x = SIMD_float_to_int(u * data_size);
-	SIMD_int y = SIMD_float_to_int(v * data_size);
-
-	SIMD_int index = y * SIMD_int(size) + x;
-	index = SIMD_int::max(index, SIMD_int(0));
-	index = SIMD_int::min(index, SIMD_int(size * size));
-
-#if SIMD_LANE_SIZE == 1
-	return one_over_pi * SIMD_Vector3(data[index[0]]);
-#elif SIMD_LANE_SIZE == 4
-	return one_over_pi * SIMD_Vector3(
-		data[index[3]],
-		data[index[2]],
-		data[index[1]],
-		data[index[0]]
-	);
-#elif SIMD_LANE_SIZE == 8
-	return one_over_pi * SIMD_Vector3(
-		data[index[7]],
-		data[index[6]],
-		data[index[5]],
-		data[index[4]],
-		data[index[3]],
-		data[index[2]],
-		data[index[1]],
-		data[index[0]]
-	);
-#endif
+	SIMD_int<L> x = SIMD_float_to_int(u * data_size);
+	SIMD_int<L> y = SIMD_float_to_int(v * data_size);
+
+	SIMD_int<L> index = y * SIMD_int<L>(size) + x;
+	index = SIMD_int<L>::max(index, SIMD_int<L>(0));
+	index = SIMD_int<L>::min(index, SIMD_int<L>(size * size));
+
+	SIMD_Vector3<L> result;
+
+	for (int i = 0; i < L; i++) {
+		const Vector3 & texel = data[index[i]];
+
+		result.x[i] = texel.x;
+		result.y[i] = texel.y;
+		result.z[i] = texel.z;
+	}
+
+	return one_over_pi * result;
 }
+
+#define INSTANTIATE_SKY(L) template SIMD_Vector3<L> Sky::sample(const SIMD_Vector3<L> & direction) const;
+SIMD_LANE_SIZES(INSTANTIATE_SKY)
@@ -9,5 +9,6 @@ private:
 public:
 	Sky(const char * file_name);
 
-	SIMD_Vector3 sample(const SIMD_Vector3 & direction) const;
+	template<int L>
+	SIMD_Vector3<L> sample(const SIMD_Vector3<L> & direction) const;
 };
@@ -6,107 +6,135 @@ void Sphere::update() {
 	transform.calc_world_matrix();
 }
 
-void Sphere::trace(const Ray & ray, RayHit & ray_hit) const {
-	const SIMD_float epsilon(Ray::EPSILON);
-	const SIMD_float two(2.0f);
+template<int L>
+void Sphere::trace(const Ray<L> & ray, RayHit<L> & ray_hit, int id) const {
+	const SIMD_float<L> epsilon(Ray<L>::EPSILON);
+	const SIMD_float<L> two(2.0f);
 
-	SIMD_Vector3 center(transform.position);
-	SIMD_float r2(radius_squared);
+	SIMD_Vector3<L> center(transform.position);
+	SIMD_float<L> r2(radius_squared);
 
-    SIMD_Vector3 oc = ray.origin - center;
+    SIMD_Vector3<L> oc = ray.origin - center;
 	// Solve quadratic equation using abc formula
-    SIMD_float a = SIMD_Vector3::length_squared(ray.direction);
-    SIMD_float b = two * SIMD_Vector3::dot(oc, ray.direction);
-    SIMD_float c = SIMD_Vector3::length_squared(oc) - r2;
+    SIMD_float<L> a = SIMD_Vector3<L>::length_squared(ray.direction);
+    SIMD_float<L> b = two * SIMD_Vector3<L>::dot(oc, ray.direction);
+    SIMD_float<L> c = SIMD_Vector3<L>::length_squared(oc) - r2;
 
 	// Compute disciminant
-    SIMD_float d = b*b - SIMD_float(4.0f) * a * c;
+    SIMD_float<L> d = b*b - SIMD_float<L>(4.0f) * a * c;
 
 	// If all discriminants are invalid, early out
-	SIMD_float mask = d >= SIMD_float(0.0f);
-	if (SIMD_float::all_false(mask)) return;
+	SIMD_float<L> mask = d >= SIMD_float<L>(0.0f);
+	if (SIMD_float<L>::all_false(mask)) return;
 
-	SIMD_float sqrt_d    =  SIMD_float::sqrt(d);
-	SIMD_float inv_denom = -SIMD_float::rcp(two * a);
+	SIMD_float<L> sqrt_d    =  SIMD_float<L>::sqrt(d);
+	SIMD_float<L> inv_denom = -SIMD_float<L>::rcp(two * a);
 
-    SIMD_float t0 = (b + sqrt_d) * inv_denom;
-    SIMD_float t1 = (b - sqrt_d) * inv_denom;
+    SIMD_float<L> t0 = (b + sqrt_d) * inv_denom;
+    SIMD_float<L> t1 = (b - sqrt_d) * inv_denom;
 
 	// t should be t0, unless t0 is behind the ray
-	SIMD_float t = SIMD_float::blend(t1, t0, t0 > epsilon);
+	SIMD_float<L> t = SIMD_float<L>::blend(t1, t0, t0 > epsilon);
 
 	// Check if t is in the valid range
 	mask = mask & (t > epsilon);
 	mask = mask & (t < ray_hit.distance);
 
-	if (SIMD_float::all_false(mask)) return;
-
-	const SIMD_float half(0.5f);
-	const SIMD_float one (1.0f);
-	const SIMD_float non_zero(1e-8f);
-	const SIMD_float one_over_r(radius_inv);
-	const SIMD_float one_over_pi    (ONE_OVER_PI);
-	const SIMD_float one_over_two_pi(ONE_OVER_TWO_PI);
+	if (SIMD_float<L>::all_false(mask)) return;
 
 	ray_hit.hit      = ray_hit.hit | mask;
-	ray_hit.distance = SIMD_float::blend(ray_hit.distance, t, mask);
+	ray_hit.distance = SIMD_float<L>::blend(ray_hit.distance, t, mask);
+
+	ray_hit.primitive_id = SIMD_int<L>::blend(ray_hit.primitive_id, SIMD_int<L>(id),                            SIMD_float_as_int(mask));
+	ray_hit.instance_id  = SIMD_int<L>::blend(ray_hit.instance_id,  SIMD_int<L>(RayHit<L>::INSTANCE_ID_SPHERE), SIMD_float_as_int(mask));
+}
+
+template<bool PROPAGATE_DIFFERENTIALS, int L>
+void Sphere::evaluate(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const {
+	const SIMD_float<L> half(0.5f);
+	const SIMD_float<L> one (1.0f);
+	const SIMD_float<L> non_zero(1e-8f);
+	const SIMD_float<L> one_over_r(radius_inv);
+	const SIMD_float<L> one_over_pi    (ONE_OVER_PI);
+	const SIMD_float<L> one_over_two_pi(ONE_OVER_TWO_PI);
+
+	SIMD_Vector3<L> center(transform.position);
 
-	ray_hit.point  = SIMD_Vector3::blend(ray_hit.point, ray.origin + t * ray.direction,         mask);
-	ray_hit.normal = SIMD_Vector3::blend(ray_hit.normal, (ray_hit.point - center) * one_over_r, mask);
+	SIMD_float<L> t = ray_hit.distance;
+
+	SIMD_Vector3<L> point  = ray.origin + t * ray.direction;
+	SIMD_Vector3<L> normal = (point - center) * one_over_r;
+
+	attributes.point  = SIMD_Vector3<L>::blend(attributes.point,  point,  mask);
+	attributes.normal = SIMD_Vector3<L>::blend(attributes.normal, normal, mask);
 	
-	ray_hit.material_id = SIMD_int::blend(ray_hit.material_id, SIMD_int(material_id), *reinterpret_cast<SIMD_int *>(&mask));
+	attributes.material_id = SIMD_int<L>::blend(attributes.material_id, SIMD_int<L>(material_id), SIMD_float_as_int(mask));
 
 	// Obtain u,v by converting the normal direction to spherical coordinates
-	ray_hit.u = SIMD_float::blend(ray_hit.u, SIMD_float::madd(SIMD_float::atan2(ray_hit.normal.z, ray_hit.normal.x), one_over_two_pi, half), mask);
-	ray_hit.v = SIMD_float::blend(ray_hit.v, SIMD_float::madd(SIMD_float::acos (ray_hit.normal.y),                   one_over_pi,     half), mask);
+	attributes.u = SIMD_float<L>::blend(attributes.u, SIMD_float<L>::madd(SIMD_Math::atan2(normal.z, normal.x), one_over_two_pi, half), mask);
+	attributes.v = SIMD_float<L>::blend(attributes.v, SIMD_float<L>::madd(SIMD_Math::acos (normal.y),           one_over_pi,     half), mask);
 
 #if RAY_DIFFERENTIALS_ENABLED
 	// Formulae for Transfer Ray Differential from Igehy 99
-	SIMD_Vector3 dP_dx_plus_t_dD_dx = SIMD_Vector3::madd(ray.dD_dx, t, ray.dO_dx);
-	SIMD_Vector3 dP_dy_plus_t_dD_dy = SIMD_Vector3::madd(ray.dD_dy, t, ray.dO_dy);
+	SIMD_Vector3<L> dP_dx_plus_t_dD_dx = SIMD_Vector3<L>::madd(ray.dD_dx, t, ray.dO_dx);
+	SIMD_Vector3<L> dP_dy_plus_t_dD_dy = SIMD_Vector3<L>::madd(ray.dD_dy, t, ray.dO_dy);
+
+	SIMD_float<L> denom = -one / SIMD_Vector3<L>::dot(ray.direction, normal);
+	SIMD_float<L> dt_dx = SIMD_Vector3<L>::dot(dP_dx_plus_t_dD_dx, normal) * denom;
+	SIMD_float<L> dt_dy = SIMD_Vector3<L>::dot(dP_dy_plus_t_dD_dy, normal) * denom;
 
-	SIMD_float denom = -one / SIMD_Vector3::dot(ray.direction, ray_hit.normal);
-	SIMD_float dt_dx = SIMD_Vector3::dot(dP_dx_plus_t_dD_dx, ray_hit.normal) * denom;
-	SIMD_float dt_dy = SIMD_Vector3::dot(dP_dy_plus_t_dD_dy, ray_hit.normal) * denom;
+	SIMD_Vector3<L> dP_dx = SIMD_Vector3<L>::madd(ray.direction, dt_dx, dP_dx_plus_t_dD_dx);
+	SIMD_Vector3<L> dP_dy = SIMD_Vector3<L>::madd(ray.direction, dt_dy, dP_dy_plus_t_dD_dy);
 
-	SIMD_Vector3 dP_dx = SIMD_Vector3::madd(ray.direction, dt_dx, dP_dx_plus_t_dD_dx);
-	SIMD_Vector3 dP_dy = SIMD_Vector3::madd(ray.direction, dt_dy, dP_dy_plus_t_dD_dy);
+	SIMD_Vector3<L> dN_dx = dP_dx * one_over_r;
+	SIMD_Vector3<L> dN_dy = dP_dy * one_over_r;
 
-	ray_hit.dO_dx = SIMD_Vector3::blend(ray_hit.dO_dx, dP_dx, mask);
-	ray_hit.dO_dy = SIMD_Vector3::blend(ray_hit.dO_dy, dP_dy, mask);
+	if constexpr (PROPAGATE_DIFFERENTIALS) {
+		attributes.dO_dx = SIMD_Vector3<L>::blend(attributes.dO_dx, dP_dx, mask);
+		attributes.dO_dy = SIMD_Vector3<L>::blend(attributes.dO_dy, dP_dy, mask);
 
-	ray_hit.dN_dx = SIMD_Vector3::blend(ray_hit.dN_dx, dP_dx * one_over_r, mask);
-	ray_hit.dN_dy = SIMD_Vector3::blend(ray_hit.dN_dy, dP_dy * one_over_r, mask);
+		attributes.dN_dx = SIMD_Vector3<L>::blend(attributes.dN_dx, dN_dx, mask);
+		attributes.dN_dy = SIMD_Vector3<L>::blend(attributes.dN_dy, dN_dy, mask);
+	}
 
 	// Formulae derived by differentiating the above formulae for u and v
-	SIMD_float ds_denom = one_over_two_pi / (ray_hit.normal.x * ray_hit.normal.x + ray_hit.normal.z * ray_hit.normal.z + non_zero);
-	ray_hit.ds_dx = SIMD_float::blend(ray_hit.ds_dx, (ray_hit.normal.x * ray_hit.dN_dx.z - ray_hit.normal.z * ray_hit.dN_dx.x) * ds_denom, mask); 
-	ray_hit.ds_dy = SIMD_float::blend(ray_hit.ds_dy, (ray_hit.normal.x * ray_hit.dN_dy.z - ray_hit.normal.z * ray_hit.dN_dy.x) * ds_denom, mask); 
+	SIMD_float<L> ds_denom = one_over_two_pi / (normal.x * normal.x + normal.z * normal.z + non_zero);
+	attributes.ds_dx = SIMD_float<L>::blend(attributes.ds_dx, (normal.x * dN_dx.z - normal.z * dN_dx.x) * ds_denom, mask); 
+	attributes.ds_dy = SIMD_float<L>::blend(attributes.ds_dy, (normal.x * dN_dy.z - normal.z * dN_dy.x) * ds_denom, mask); 
 
-	SIMD_float dt_denom = -one_over_pi * SIMD_float::inv_sqrt(one - ray_hit.normal.y*ray_hit.normal.y + non_zero);
-	ray_hit.dt_dx = SIMD_float::blend(ray_hit.dt_dx, ray_hit.dN_dx.y * dt_denom, mask);
-	ray_hit.dt_dy = SIMD_float::blend(ray_hit.dt_dy, ray_hit.dN_dy.y * dt_denom, mask);
+	SIMD_float<L> dt_denom = -one_over_pi * SIMD_float<L>::inv_sqrt(one - normal.y*normal.y + non_zero);
+	attributes.dt_dx = SIMD_float<L>::blend(attributes.dt_dx, dN_dx.y * dt_denom, mask);
+	attributes.dt_dy = SIMD_float<L>::blend(attributes.dt_dy, dN_dy.y * dt_denom, mask);
 #endif
 }
 
-SIMD_float Sphere::intersect(const Ray & ray, SIMD_float max_distance) const {
-	SIMD_Vector3 center(transform.position);
 
-	SIMD_Vector3 c = center - ray.origin;
-	SIMD_float   t = SIMD_Vector3::dot(c, ray.direction);
+template<int L>
+SIMD_float<L> Sphere::intersect(const Ray<L> & ray, SIMD_float<L> max_distance) const {
+	SIMD_Vector3<L> center(transform.position);
 
-	SIMD_Vector3 Q  = c - t * ray.direction;
-	SIMD_float   p2 = SIMD_Vector3::dot(Q, Q);
+	SIMD_Vector3<L> c = center - ray.origin;
+	SIMD_float<L>   t = SIMD_Vector3<L>::dot(c, ray.direction);
+
+	SIMD_Vector3<L> Q  = c - t * ray.direction;
+	SIMD_float<L>   p2 = SIMD_Vector3<L>::dot(Q, Q);
 	
-	SIMD_float rs(radius_squared);
-	SIMD_float mask = p2 < rs;
+	SIMD_float<L> rs(radius_squared);
+	SIMD_float<L> mask = p2 < rs;
 
-	if (SIMD_float::all_false(mask)) return mask;
+	if (SIMD_float<L>::all_false(mask)) return mask;
 	
-	t = t - SIMD_float::sqrt(rs - p2);
+	t = t - SIMD_float<L>::sqrt(rs - p2);
 
-	mask = mask & (t > Ray::EPSILON);
+	mask = mask & (t > SIMD_float<L>(Ray<L>::EPSILON));
 	mask = mask & (t < max_distance);
 	
 	return mask;
 }
+
+#define INSTANTIATE_SPHERE(L) \
+	template void          Sphere::trace          (const Ray<L> & ray, RayHit<L> & ray_hit, int id) const; \
+	template SIMD_float<L> Sphere::intersect      (const Ray<L> & ray, SIMD_float<L> max_distance) const; \
+	template void          Sphere::evaluate<false>(const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const; \
+	template void          Sphere::evaluate<true> (const Ray<L> & ray, const RayHit<L> & ray_hit, SIMD_float<L> mask, HitAttributes<L> & attributes) const;
+SIMD_LANE_SIZES(INSTANTIATE_SPHERE)
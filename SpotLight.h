@@ -4,7 +4,7 @@
 #include "Util.h"
 
 struct SpotLight : PointLight {
-	SIMD_Vector3 negative_direction;
+	Vector3 negative_direction;
 
 	float inner_cutoff; // Cosine of half the angle that describes the inner cone of the SpotLight. Angles inside this cone will receive full SpotLight intensity
 	float outer_cutoff; // Cosine of half the angle that describes the outer cone of the SpotLight. Angles outside this cone will receive no SpotLight intensity
@@ -14,21 +14,22 @@ struct SpotLight : PointLight {
 		outer_cutoff = cosf(DEG_TO_RAD(0.5f * outer_angle));
 	}
 
-	inline SIMD_Vector3 calc_lighting(const SIMD_Vector3 & normal, const SIMD_Vector3 & to_light, const SIMD_Vector3 & to_camera, SIMD_float distance_squared) const {
-		const SIMD_float one(1.0f);
+	template<int L>
+	inline SIMD_Vector3<L> calc_lighting(const SIMD_Vector3<L> & normal, const SIMD_Vector3<L> & to_light, const SIMD_Vector3<L> & to_camera, SIMD_float<L> distance_squared) const {
+		const SIMD_float<L> one(1.0f);
 
-		SIMD_float dot = SIMD_Vector3::dot(to_light, negative_direction);
+		SIMD_float<L> dot = SIMD_Vector3<L>::dot(to_light, SIMD_Vector3<L>(negative_direction));
 
-		SIMD_float inner(inner_cutoff);
-		SIMD_float outer(outer_cutoff);
+		SIMD_float<L> inner(inner_cutoff);
+		SIMD_float<L> outer(outer_cutoff);
 
-		SIMD_float mask = dot > outer;
-		if (SIMD_float::all_false(mask)) return SIMD_Vector3(0.0f);
+		SIMD_float<L> mask = dot > outer;
+		if (SIMD_float<L>::all_false(mask)) return SIMD_Vector3<L>(0.0f);
 
 		// Modulate light intensity as a function of the angle
-		SIMD_float radial_falloff = (dot - outer) / (inner - outer);
-		radial_falloff = SIMD_float::blend(radial_falloff, one, radial_falloff > one);
+		SIMD_float<L> radial_falloff = (dot - outer) / (inner - outer);
+		radial_falloff = SIMD_float<L>::blend(radial_falloff, one, radial_falloff > one);
 		
-		return SIMD_float::blend(SIMD_float(0.0f), radial_falloff, mask) * PointLight::calc_lighting(normal, to_light, to_camera, distance_squared);
+		return SIMD_float<L>::blend(SIMD_float<L>(0.0f), radial_falloff, mask) * PointLight::calc_lighting(normal, to_light, to_camera, distance_squared);
 	}
 };
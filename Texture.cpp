@@ -1,5 +1,7 @@
 #include "Texture.h"
 
+#include <vector>
+#include <climits>
 #include <algorithm>
 #include <unordered_map>
 
@@ -27,6 +29,36 @@ static unsigned colour_pack(const Vector3 & colour) {
 	return r | g | b;
 }
 
+#if TEXTURE_TILED
+static_assert(Math::is_power_of_two(TEXTURE_TILE_SIZE), "Tiles should be a power of two in size");
+
+// Only Mipmap levels that consist of whole tiles are tiled
+static bool is_tiled(int level_width, int level_height) {
+	return level_width % TEXTURE_TILE_SIZE == 0 && level_height % TEXTURE_TILE_SIZE == 0;
+}
+
+// Moves bit i of a coordinate within a tile to bit 2i, so that the bits of x and y can be interleaved
+static int morton_spread(int a) {
+	int result = 0;
+
+	for (int bit = 0; (1 << bit) < TEXTURE_TILE_SIZE; bit++) {
+		result |= ((a >> bit) & 1) << (2 * bit);
+	}
+
+	return result;
+}
+
+// Tiles are stored row by row, the texels inside a tile are stored in Morton order
+static int get_tiled_index(int x, int y, int level_width) {
+	int tile_x = x / TEXTURE_TILE_SIZE;
+	int tile_y = y / TEXTURE_TILE_SIZE;
+
+	int tile = tile_x + tile_y * (level_width / TEXTURE_TILE_SIZE);
+
+	return tile * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE + morton_spread(x % TEXTURE_TILE_SIZE) + 2 * morton_spread(y % TEXTURE_TILE_SIZE);
+}
+#endif
+
 const Texture * Texture::load(const char * file_path) {
 	Texture *& texture = texture_cache[file_path];
 
@@ -54,12 +86,16 @@ const Texture * Texture::load(const char * file_path) {
 
 	texture->mipmapped = use_mipmapping;
 
+	int texel_count = texture->width * texture->height;
 	if (use_mipmapping) {
-		texture->data = Util::aligned_malloc<Vector3>(texture->width * texture->height + (texture->width * texture->height) / 3, CACHE_LINE_WIDTH);
-	} else {
-		texture->data = Util::aligned_malloc<Vector3>(texture->width * texture->height, CACHE_LINE_WIDTH);
+		texel_count += texel_count / 3;
 	}
 
+	// Texels are gathered through 32 bit offsets to their individual floats, see fetch_texel
+	assert(texel_count <= INT_MAX / 3);
+
+	texture->data = Util::aligned_malloc<Vector3>(texel_count, CACHE_LINE_WIDTH);
+
 	// Copy the data over into Mipmap level 0, and convert it to linear colour space
 	for (int i = 0; i < texture->width * texture->height; i++) {
 		Vector3 colour = colour_unpack(data[i]);
@@ -120,6 +156,26 @@ const Texture * Texture::load(const char * file_path) {
 		texture->mip_offsets = new int(0);
 	}
 
+#if TEXTURE_TILED
+	// Reorder the texels of every level into tiles, this is done afterwards because the Mipmaps are generated from row-major levels
+	for (int level = 0; level < texture->mip_levels; level++) {
+		int level_width  = texture->width  >> level;
+		int level_height = texture->height >> level;
+
+		if (!is_tiled(level_width, level_height)) continue;
+
+		Vector3 * texels = texture->data + texture->mip_offsets[level];
+
+		std::vector<Vector3> row_major(texels, texels + level_width * level_height);
+
+		for (int j = 0; j < level_height; j++) {
+			for (int i = 0; i < level_width; i++) {
+				texels[get_tiled_index(i, j, level_width)] = row_major[i + j * level_width];
+			}
+		}
+	}
+#endif
+
 	texture->width_f  = float(texture->width);
 	texture->height_f = float(texture->height);
 	
@@ -143,195 +199,403 @@ Vector3 Texture::fetch_texel(int x, int y, int level) const {
 	assert(y >= 0 && y < level_height);
 
 	assert(data);
+#if TEXTURE_TILED
+	if (is_tiled(level_width, level_height)) return data[offset + get_tiled_index(x, y, level_width)];
+#endif
 	return data[offset + x + y * level_width];
 }
 
-Vector3 Texture::sample_nearest(float s, float t) const {
-	int x = Util::float_to_int(s * width_f);
-	int y = Util::float_to_int(t * height_f);
+// Rounds to the nearest integer the same way Util::float_to_int does, halfway cases go to even
+template<int L>
+static FORCEINLINE SIMD_float<L> round_to_int(SIMD_float<L> x) {
+	return SIMD_int_to_float(SIMD_float_to_int(x));
+}
+
+#if TEXTURE_TILED
+// Same as morton_spread(int), using floor instead of bit operations: spread(a) = a + sum over k >= 1 of 2 * 4^(k-1) * floor(a / 2^k)
+template<int L>
+static FORCEINLINE SIMD_float<L> morton_spread(SIMD_float<L> a) {
+	SIMD_float<L> result = a;
+	float         scale  = 2.0f;
 
-	return fetch_texel(x, y);
+	for (int k = 2; k < TEXTURE_TILE_SIZE; k *= 2, scale *= 4.0f) {
+		result = SIMD_float<L>::madd(SIMD_float<L>::floor(a * SIMD_float<L>(1.0f / float(k))), SIMD_float<L>(scale), result);
+	}
+
+	return result;
 }
+#endif
 
-Vector3 Texture::sample_bilinear(float s, float t, int level) const {
-	int level_width  = width  >> level;
-	int level_height = height >> level;
+template<int L>
+FORCEINLINE Texture::MipLevel<L> Texture::get_mip_level(SIMD_float<L> level) const {
+	SIMD_float<L> scale = SIMD_Math::exp2i(-level);
+
+	MipLevel<L> mip_level;
+	mip_level.width  = SIMD_float<L>(width_f)  * scale;
+	mip_level.height = SIMD_float<L>(height_f) * scale;
+	mip_level.stride = SIMD_float_to_int(mip_level.width);
+	mip_level.offset = SIMD_int_gather(mip_offsets, SIMD_float_to_int(level));
+
+#if TEXTURE_TILED
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> tile_size(float(TEXTURE_TILE_SIZE));
+
+	mip_level.tiled = (SIMD_Math::mod(mip_level.width, tile_size) == zero) & (SIMD_Math::mod(mip_level.height, tile_size) == zero);
+#endif
+
+	return mip_level;
+}
+
+// Texel indices are the sum of a column term and a row term, so that a footprint only addresses each of its columns and rows once.
+// x should be integral and is wrapped around, which is exact in floating point for power of two sizes
+template<int L>
+FORCEINLINE SIMD_int<L> Texture::get_texel_column(SIMD_float<L> x, const MipLevel<L> & mip_level) const {
+	// The clamp protects against rounding in the division for other sizes
+	x = SIMD_Math::clamp(SIMD_Math::mod(x, mip_level.width), SIMD_float<L>(0.0f), mip_level.width - SIMD_float<L>(1.0f));
+
+#if TEXTURE_TILED
+	const SIMD_float<L> tile_size(float(TEXTURE_TILE_SIZE));
+
+	SIMD_float<L> tile_x = SIMD_float<L>::floor(x * SIMD_float<L>(1.0f / float(TEXTURE_TILE_SIZE)));
+
+	// The tiled column is below width * tile size, which is still exact in floating point
+	SIMD_float<L> tiled_column = SIMD_float<L>::madd(tile_x, SIMD_float<L>(float(TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE)), morton_spread(x - tile_x * tile_size));
+
+	x = SIMD_float<L>::blend(x, tiled_column, mip_level.tiled);
+#endif
+
+	return SIMD_float_to_int(x);
+}
+
+// The row term grows with width * height, so unlike the column term it is multiplied out in integer arithmetic
+template<int L>
+FORCEINLINE SIMD_int<L> Texture::get_texel_row(SIMD_float<L> y, const MipLevel<L> & mip_level) const {
+	y = SIMD_Math::clamp(SIMD_Math::mod(y, mip_level.height), SIMD_float<L>(0.0f), mip_level.height - SIMD_float<L>(1.0f));
+
+	SIMD_int<L> row = SIMD_float_to_int(y) * mip_level.stride;
+
+#if TEXTURE_TILED
+	const SIMD_float<L> tile_size(float(TEXTURE_TILE_SIZE));
+
+	SIMD_float<L> tile_y = SIMD_float<L>::floor(y * SIMD_float<L>(1.0f / float(TEXTURE_TILE_SIZE)));
+
+	// A row of tiles spans width * tile size texels, the bits of y go in between the bits of x
+	SIMD_int<L> tiled_row = 
+		SIMD_float_to_int(tile_y) * (mip_level.stride * SIMD_int<L>(TEXTURE_TILE_SIZE)) + 
+		SIMD_float_to_int(morton_spread(y - tile_y * tile_size) * SIMD_float<L>(2.0f));
+
+	row = SIMD_int<L>::blend(row, tiled_row, SIMD_float_as_int(mip_level.tiled));
+#endif
+
+	return row;
+}
+
+template<int L>
+FORCEINLINE SIMD_Vector3<L> Texture::fetch_texel(SIMD_int<L> column, SIMD_int<L> row, const MipLevel<L> & mip_level) const {
+	SIMD_int<L> index = mip_level.offset + column + row;
+
+	// Texels are gathered as three interleaved float columns
+	const float * texels = &data[0].x;
+
+	SIMD_int<L> offsets = index * SIMD_int<L>(3);
+
+	return SIMD_Vector3<L>(
+		SIMD_float_gather(texels,     offsets),
+		SIMD_float_gather(texels + 1, offsets),
+		SIMD_float_gather(texels + 2, offsets)
+	);
+}
+
+// Fetches texel (0, 0) of the last Mipmap level. The last level is one texel along the shorter side of the Texture,
+// so only square Textures end in a single texel. Otherwise the first texel of the remaining row or column is used
+template<int L>
+SIMD_Vector3<L> Texture::fetch_last_texel() const {
+	return SIMD_Vector3<L>(fetch_texel(0, 0, mip_levels - 1));
+}
+
+template<int L>
+SIMD_Vector3<L> Texture::sample_nearest(SIMD_float<L> s, SIMD_float<L> t) const {
+	SIMD_float<L> x = round_to_int(s * SIMD_float<L>(width_f));
+	SIMD_float<L> y = round_to_int(t * SIMD_float<L>(height_f));
+
+	MipLevel<L> mip_level = get_mip_level(SIMD_float<L>(0.0f));
+
+	return fetch_texel(get_texel_column(x, mip_level), get_texel_row(y, mip_level), mip_level);
+}
+
+template<int L>
+SIMD_Vector3<L> Texture::sample_bilinear(SIMD_float<L> s, SIMD_float<L> t, const MipLevel<L> & mip_level) const {
+	const SIMD_float<L> one (1.0f);
+	const SIMD_float<L> half(0.5f);
 
 	// Convert normalized (u,v) to pixel space
-	s = s * level_width  - 0.5f;
-	t = t * level_height - 0.5f;
+	s = s * mip_level.width  - half;
+	t = t * mip_level.height - half;
 
 	// Calculate bilinear weights
-	float fractional_s = s - floor(s);
-	float fractional_t = t - floor(t);
+	SIMD_float<L> fractional_s = s - SIMD_float<L>::floor(s);
+	SIMD_float<L> fractional_t = t - SIMD_float<L>::floor(t);
 
-	float one_minus_fractional_s = 1.0f - fractional_s;
-	float one_minus_fractional_t = 1.0f - fractional_t;
+	SIMD_float<L> one_minus_fractional_s = one - fractional_s;
+	SIMD_float<L> one_minus_fractional_t = one - fractional_t;
+
+	SIMD_float<L> w0 = one_minus_fractional_s * one_minus_fractional_t;
+	SIMD_float<L> w1 =           fractional_s * one_minus_fractional_t;
+	SIMD_float<L> w2 = one_minus_fractional_s *           fractional_t;
+	SIMD_float<L> w3 = one - w0 - w1 - w2;
 
-	float w0 = one_minus_fractional_s * one_minus_fractional_t;
-	float w1 =           fractional_s * one_minus_fractional_t;
-	float w2 = one_minus_fractional_s *           fractional_t;
-	float w3 = 1.0f - w0 - w1 - w2;
-	
 	// Convert pixel coordinates to integers
-	int int_s = Util::float_to_int(s - 0.5f);
-	int int_t = Util::float_to_int(t - 0.5f);
-	
+	SIMD_float<L> int_s = round_to_int(s - half);
+	SIMD_float<L> int_t = round_to_int(t - half);
+
+	SIMD_int<L> column0 = get_texel_column(int_s,       mip_level);
+	SIMD_int<L> column1 = get_texel_column(int_s + one, mip_level);
+	SIMD_int<L> row0    = get_texel_row   (int_t,       mip_level);
+	SIMD_int<L> row1    = get_texel_row   (int_t + one, mip_level);
+
 	// Blend everything together using the weights
 	return 
-		w0 * fetch_texel(int_s,     int_t,     level) +
-		w1 * fetch_texel(int_s + 1, int_t,     level) +
-		w2 * fetch_texel(int_s,     int_t + 1, level) +
-		w3 * fetch_texel(int_s + 1, int_t + 1, level);
+		w0 * fetch_texel(column0, row0, mip_level) +
+		w1 * fetch_texel(column1, row0, mip_level) +
+		w2 * fetch_texel(column0, row1, mip_level) +
+		w3 * fetch_texel(column1, row1, mip_level);
 }
 
 // Based on: PBRT chapter 10.4
-Vector3 Texture::sample_mipmap_trilinear(float s, float t, float ds_dx, float ds_dy, float dt_dx, float dt_dy) const {
-	float width = 2.0f * std::max(
-		std::max(std::abs(ds_dx), std::abs(ds_dy)),
-		std::max(std::abs(dt_dx), std::abs(dt_dy))
+template<int L>
+SIMD_Vector3<L> Texture::sample_mipmap_trilinear(SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+
+	SIMD_float<L> width = SIMD_float<L>(2.0f) * SIMD_float<L>::max(
+		SIMD_float<L>::max(SIMD_Math::abs(ds_dx), SIMD_Math::abs(ds_dy)),
+		SIMD_float<L>::max(SIMD_Math::abs(dt_dx), SIMD_Math::abs(dt_dy))
 	);
 	
-	float lambda = mip_levels_f - 1.0f + log2f(std::max(width, 1e-8f));
-	int   level  = Util::float_to_int(lambda - 0.5f);
+	SIMD_float<L> lambda = SIMD_float<L>(mip_levels_f - 1.0f) + SIMD_Math::log2(SIMD_float<L>::max(width, SIMD_float<L>(1e-8f)));
+	SIMD_float<L> level  = round_to_int(lambda - SIMD_float<L>(0.5f));
+
+	// Lanes below level 0 sample level 0 bilinearly, lanes at or above the last level get its only texel
+	SIMD_float<L> mask_below = level < zero;
+	SIMD_float<L> mask_above = level >= SIMD_float<L>(mip_levels_f - 1.0f);
+
+	if (SIMD_float<L>::all_true(mask_above)) return fetch_last_texel<L>();
+
+	SIMD_float<L> f = SIMD_float<L>::blend(lambda - SIMD_float<L>::floor(lambda), zero, mask_below);
+
+	// Keep both levels valid for all lanes, lanes above the last level are replaced afterwards
+	level = SIMD_Math::clamp(level, zero, SIMD_float<L>(std::max(mip_levels_f - 2.0f, 0.0f)));
 
-	if (level < 0)               return sample_bilinear(s, t);
-	if (level >= mip_levels - 1) return fetch_texel(0, 0, mip_levels - 1);
+	SIMD_Vector3<L> result = (one - f) * sample_bilinear(s, t, get_mip_level(level));
 
-	float f = lambda - floorf(lambda);
+	if (!SIMD_float<L>::all_false(f > zero)) {
+		result += f * sample_bilinear(s, t, get_mip_level(SIMD_float<L>::min(level + one, SIMD_float<L>(mip_levels_f - 1.0f))));
+	}
+
+	if (!SIMD_float<L>::all_false(mask_above)) {
+		result = SIMD_Vector3<L>::blend(result, fetch_last_texel<L>(), mask_above);
+	}
 
-	return (1.0f - f) * sample_bilinear(s, t, level) + f * sample_bilinear(s, t, level + 1);
+	return result;
 }
 
 // Based on: https://www.khronos.org/registry/OpenGL/extensions/EXT/EXT_texture_filter_anisotropic.txt
-Vector3 Texture::sample_mipmap_anisotropic(float s, float t, float ds_dx, float ds_dy, float dt_dx, float dt_dy) const {
-	float p_x = std::max(std::abs(ds_dx), std::abs(dt_dx));
-	float p_y = std::max(std::abs(ds_dy), std::abs(dt_dy));
+template<int L>
+SIMD_Vector3<L> Texture::sample_mipmap_anisotropic(SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
 
-	float p_min = std::min(p_x, p_y);
-	float p_max = std::max(p_x, p_y);
+	SIMD_float<L> p_x = SIMD_float<L>::max(SIMD_Math::abs(ds_dx), SIMD_Math::abs(dt_dx));
+	SIMD_float<L> p_y = SIMD_float<L>::max(SIMD_Math::abs(ds_dy), SIMD_Math::abs(dt_dy));
 
-	float          N = std::min(ceilf(p_max / p_min), MAX_ANISOTROPY);
-	float one_over_N = 1.0f / N;
-	
-	float lambda = mip_levels_f - 1.0f + log2f(p_max * one_over_N);
-	int   level  = Util::float_to_int(lambda);
-	
-	if (level < 0)               return sample_bilinear(s, t);
-	if (level >= mip_levels - 1) return fetch_texel(0, 0, mip_levels - 1);
+	SIMD_float<L> p_min = SIMD_float<L>::min(p_x, p_y);
+	SIMD_float<L> p_max = SIMD_float<L>::max(p_x, p_y);
+
+	SIMD_float<L>          N = SIMD_float<L>::min(SIMD_float<L>::ceil(p_max / p_min), SIMD_float<L>(MAX_ANISOTROPY));
+	SIMD_float<L> one_over_N = one / N;
 	
-	bool  x_major = p_x > p_y;
-	float step_s = x_major ? ds_dx : ds_dy;
-	float step_t = x_major ? dt_dx : dt_dy;
+	SIMD_float<L> lambda = SIMD_float<L>(mip_levels_f - 1.0f) + SIMD_Math::log2(p_max * one_over_N);
+	SIMD_float<L> level  = round_to_int(lambda);
+
+	// Lanes below level 0 take a single bilinear sample from level 0, lanes at or above the last level get its only texel
+	SIMD_float<L> mask_below = level < zero;
+	SIMD_float<L> mask_above = level >= SIMD_float<L>(mip_levels_f - 1.0f);
 
-	float one_over_N_plus_1 = 1.0f / (N + 1.0f);
+	if (SIMD_float<L>::all_true(mask_above)) return fetch_last_texel<L>();
 
-	Vector3 sum(0.0f);
+	N          = SIMD_float<L>::blend(N,          one, mask_below);
+	one_over_N = SIMD_float<L>::blend(one_over_N, one, mask_below);
 
-	for (float i = 1.0f; i <= N + 0.001f; i += 1.0f) {
-		float x = s + step_s * (i * one_over_N_plus_1 - 0.5f);
-		float y = t + step_t * (i * one_over_N_plus_1 - 0.5f);
+	level = SIMD_Math::clamp(level, zero, SIMD_float<L>(mip_levels_f - 1.0f));
 
-		sum += sample_bilinear(x, y, level);
+	SIMD_float<L> x_major = p_x > p_y;
+	SIMD_float<L> step_s = SIMD_float<L>::blend(SIMD_float<L>::blend(ds_dy, ds_dx, x_major), zero, mask_below);
+	SIMD_float<L> step_t = SIMD_float<L>::blend(SIMD_float<L>::blend(dt_dy, dt_dx, x_major), zero, mask_below);
+
+	SIMD_float<L> one_over_N_plus_1 = one / (N + one);
+
+	MipLevel<L> mip_level = get_mip_level(level);
+
+	SIMD_Vector3<L> sum;
+
+	// Every lane takes its own number of samples, the loop runs until the lane with the most samples is done
+	float N_max = SIMD_float<L>::hmax(N);
+
+	for (float i = 1.0f; i <= N_max + 0.001f; i += 1.0f) {
+		SIMD_float<L> offset = SIMD_float<L>(i) * one_over_N_plus_1 - SIMD_float<L>(0.5f);
+
+		SIMD_float<L> x = s + step_s * offset;
+		SIMD_float<L> y = t + step_t * offset;
+
+		sum = SIMD_Vector3<L>::blend(sum, sum + sample_bilinear(x, y, mip_level), SIMD_float<L>(i) <= N + SIMD_float<L>(0.001f));
 	}
 
-	return sum * one_over_N;
+	SIMD_Vector3<L> result = sum * one_over_N;
+
+	if (!SIMD_float<L>::all_false(mask_above)) {
+		result = SIMD_Vector3<L>::blend(result, fetch_last_texel<L>(), mask_above);
+	}
+
+	return result;
 }
 
 // Based on: PBRT chapter 10.4
-Vector3 Texture::sample_mipmap_ewa(float s, float t, float ds_dx, float ds_dy, float dt_dx, float dt_dy) const {
-	Vector2 major_axis(ds_dx, dt_dx);
-	Vector2 minor_axis(ds_dy, dt_dy);
-	
-	float major_length = Vector2::length(major_axis);
-	float minor_length = Vector2::length(minor_axis);
+template<int L>
+SIMD_Vector3<L> Texture::sample_mipmap_ewa(SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const {
+	const SIMD_float<L> zero(0.0f);
+	const SIMD_float<L> one (1.0f);
+	const SIMD_float<L> half(0.5f);
+
+	SIMD_float<L> major_length = SIMD_float<L>::sqrt(ds_dx * ds_dx + dt_dx * dt_dx);
+	SIMD_float<L> minor_length = SIMD_float<L>::sqrt(ds_dy * ds_dy + dt_dy * dt_dy);
 	
-	if (minor_length > major_length) {
-		std::swap(minor_axis,   major_axis);
-		std::swap(minor_length, major_length);
-	}
+	SIMD_float<L> mask_swap = minor_length > major_length;
+
+	SIMD_float<L> major_axis_x = SIMD_float<L>::blend(ds_dx, ds_dy, mask_swap);
+	SIMD_float<L> major_axis_y = SIMD_float<L>::blend(dt_dx, dt_dy, mask_swap);
+	SIMD_float<L> minor_axis_x = SIMD_float<L>::blend(ds_dy, ds_dx, mask_swap);
+	SIMD_float<L> minor_axis_y = SIMD_float<L>::blend(dt_dy, dt_dx, mask_swap);
+
+	SIMD_float<L> length = major_length;
+	major_length = SIMD_float<L>::blend(major_length, minor_length, mask_swap);
+	minor_length = SIMD_float<L>::blend(minor_length, length,       mask_swap);
 
-	if (minor_length < 0.00001f) return sample_bilinear(s, t);
-	if (major_length > width_f)  return fetch_texel(0, 0, mip_levels - 1);
+	// Lanes with a degenerate ellipse sample level 0 bilinearly, lanes with a huge ellipse get the texel of the last level
+	SIMD_float<L> mask_bilinear = minor_length < SIMD_float<L>(0.00001f);
+	SIMD_float<L> mask_ellipse  = minor_length >= SIMD_float<L>(0.00001f);
+	SIMD_float<L> mask_last     = mask_ellipse & (major_length > SIMD_float<L>(width_f));
 
 	// Clamp ellipse eccentricity when it is too large
-	if (minor_length * MAX_ANISOTROPY < major_length) {
-		float scale = major_length / (minor_length * MAX_ANISOTROPY);
+	SIMD_float<L> scale = SIMD_float<L>::blend(one, major_length / (minor_length * SIMD_float<L>(MAX_ANISOTROPY)), minor_length * SIMD_float<L>(MAX_ANISOTROPY) < major_length);
 
-		minor_axis   *= scale;
-		minor_length *= scale;
-	}
+	minor_axis_x = minor_axis_x * scale;
+	minor_axis_y = minor_axis_y * scale;
+	minor_length = minor_length * scale;
+
+	SIMD_float<L> lambda = SIMD_float<L>::max(zero, SIMD_float<L>(mip_levels_f - 1.0f) + SIMD_Math::log2(minor_length));
+	SIMD_float<L> level  = round_to_int(lambda);
 
-	float lambda = std::max(0.0f, mip_levels_f - 1.0f + log2f(minor_length));
-	int   level  = Util::float_to_int(lambda);
+	mask_last    = mask_last | (mask_ellipse & (level >= SIMD_float<L>(mip_levels_f - 1.0f)));
+	mask_ellipse = SIMD_float<L>::andnot(mask_last, mask_ellipse);
 
-	if (level >= mip_levels - 1) return fetch_texel(0, 0, mip_levels - 1);
+	SIMD_Vector3<L> result;
 
-	float level_width  = float(width  >> level);
-	float level_height = float(height >> level);
+	if (!SIMD_float<L>::all_false(mask_ellipse)) {
+		level = SIMD_Math::clamp(level, zero, SIMD_float<L>(mip_levels_f - 1.0f));
 
-	// Convert EWA coordinates to appropriate scale for level
-	s = s * level_width  - 0.5f;
-	t = t * level_height - 0.5f;
+		MipLevel<L> mip_level = get_mip_level(level);
 
-	Vector2 size(level_width, level_height);
-	Vector2 major_axis_scaled = major_axis * size;
-	Vector2 minor_axis_scaled = minor_axis * size;
+		// Convert EWA coordinates to appropriate scale for level
+		SIMD_float<L> s_level = s * mip_level.width  - half;
+		SIMD_float<L> t_level = t * mip_level.height - half;
 
-	// Compute ellipse coefficients to bound EWA filter region
-	float a =  1.0f + (major_axis_scaled.y * major_axis_scaled.y + minor_axis_scaled.y * minor_axis_scaled.y);
-	float b = -2.0f * (major_axis_scaled.x * major_axis_scaled.y + minor_axis_scaled.x * minor_axis_scaled.y);
-	float c =  1.0f + (major_axis_scaled.x * major_axis_scaled.x + minor_axis_scaled.x * minor_axis_scaled.x);
+		SIMD_float<L> major_axis_scaled_x = major_axis_x * mip_level.width;
+		SIMD_float<L> major_axis_scaled_y = major_axis_y * mip_level.height;
+		SIMD_float<L> minor_axis_scaled_x = minor_axis_x * mip_level.width;
+		SIMD_float<L> minor_axis_scaled_y = minor_axis_y * mip_level.height;
+
+		// Compute ellipse coefficients to bound EWA filter region
+		SIMD_float<L> a = one                + (major_axis_scaled_y * major_axis_scaled_y + minor_axis_scaled_y * minor_axis_scaled_y);
+		SIMD_float<L> b = SIMD_float<L>(-2.0f) * (major_axis_scaled_x * major_axis_scaled_y + minor_axis_scaled_x * minor_axis_scaled_y);
+		SIMD_float<L> c = one                + (major_axis_scaled_x * major_axis_scaled_x + minor_axis_scaled_x * minor_axis_scaled_x);
 	
-	float one_over_f = 1.0f / (a * c - b * b * 0.25f);
+		SIMD_float<L> one_over_f = one / (a * c - b * b * SIMD_float<L>(0.25f));
 	
-	a *= one_over_f;
-	b *= one_over_f;
-	c *= one_over_f;
+		a = a * one_over_f;
+		b = b * one_over_f;
+		c = c * one_over_f;
 
-	// Compute the ellipse's bounding box in texture space
-	float det = -b * b + 4.0f * a * c;
+		// Compute the ellipse's bounding box in texture space
+		SIMD_float<L> det = -b * b + SIMD_float<L>(4.0f) * a * c;
 
-	float sqrt_u = sqrtf(det * c);
-	float sqrt_v = sqrtf(det * a);
+		SIMD_float<L> sqrt_u = SIMD_float<L>::sqrt(det * c);
+		SIMD_float<L> sqrt_v = SIMD_float<L>::sqrt(det * a);
 
-	float two_inv_det = 2.0f / det;
-	float two_inv_det_sqrt_u = two_inv_det * sqrt_u;
-	float two_inv_det_sqrt_v = two_inv_det * sqrt_v;
+		SIMD_float<L> two_inv_det = SIMD_float<L>(2.0f) / det;
+		SIMD_float<L> two_inv_det_sqrt_u = two_inv_det * sqrt_u;
+		SIMD_float<L> two_inv_det_sqrt_v = two_inv_det * sqrt_v;
 
-	int s0 = Util::float_to_int(s - two_inv_det_sqrt_u + 0.5f);
-	int s1 = Util::float_to_int(s + two_inv_det_sqrt_u - 0.5f);
-	int t0 = Util::float_to_int(t - two_inv_det_sqrt_v + 0.5f);
-	int t1 = Util::float_to_int(t + two_inv_det_sqrt_v - 0.5f);
+		SIMD_float<L> s0 = round_to_int(s_level - two_inv_det_sqrt_u + half);
+		SIMD_float<L> s1 = round_to_int(s_level + two_inv_det_sqrt_u - half);
+		SIMD_float<L> t0 = round_to_int(t_level - two_inv_det_sqrt_v + half);
+		SIMD_float<L> t1 = round_to_int(t_level + two_inv_det_sqrt_v - half);
 
-	// Scan over ellipse bound and compute quadratic equation
-	Vector3 sum(0.0f);
-	float   sum_weights = 0.0f;
+		// Every lane scans its own bounding box, the loops cover the largest box of all lanes
+		float ds_max = SIMD_float<L>::hmax(SIMD_float<L>::blend(zero, s1 - s0, mask_ellipse));
+		float dt_max = SIMD_float<L>::hmax(SIMD_float<L>::blend(zero, t1 - t0, mask_ellipse));
 
-	float t0f = float(t0);
-	float s0f = float(s0);
+		// Scan over ellipse bound and compute quadratic equation
+		SIMD_Vector3<L> sum;
+		SIMD_float<L>   sum_weights(0.0f);
 
-	float tf = t0f;
-	
-	for (int ti = t0; ti <= t1; ti++, tf += 1.0f) {
-		float tt = tf - t;
+		for (float dt = 0.0f; dt <= dt_max; dt += 1.0f) {
+			SIMD_float<L> ti = t0 + SIMD_float<L>(dt);
+			SIMD_float<L> tt = ti - t_level;
+
+			SIMD_float<L> mask_row = mask_ellipse & (ti <= t1);
+			if (SIMD_float<L>::all_false(mask_row)) break;
+
+			SIMD_int<L> row = get_texel_row(ti, mip_level);
+
+			for (float ds = 0.0f; ds <= ds_max; ds += 1.0f) {
+				SIMD_float<L> si = s0 + SIMD_float<L>(ds);
+				SIMD_float<L> ss = si - s_level;
 
-		float sf = s0f;
+				// Compute squared radius and filter texel if inside ellipse
+				SIMD_float<L> r2 = a * ss * ss + b * ss * tt + c * tt * tt;
 
-		for (int si = s0; si <= s1; si++, sf += 1.0f) {
-			float ss = sf - s;
+				SIMD_float<L> mask_inside = mask_row & (si <= s1) & (r2 < one);
+				if (SIMD_float<L>::all_false(mask_inside)) continue;
 
-			// Compute squared radius and filter texel if inside ellipse
-			float r2 = a * ss * ss + b * ss * tt + c * tt * tt;
-			if (r2 < 1.0f) {
-				int   index  = std::min(Util::float_to_int(r2 * ewa_weight_table_size), ewa_weight_table_size - 1);
-				float weight = ewa_weight_table[index];
+				SIMD_int<L> index = SIMD_float_to_int(r2 * SIMD_float<L>(float(ewa_weight_table_size)));
+				index = SIMD_int<L>::max(SIMD_int<L>::min(index, SIMD_int<L>(ewa_weight_table_size - 1)), SIMD_int<L>(0));
 
-				sum         += weight * fetch_texel(si, ti, level);
-				sum_weights += weight;
+				SIMD_float<L> weight = SIMD_float<L>::blend(zero, SIMD_float_gather(ewa_weight_table, index), mask_inside);
+
+				sum         += weight * fetch_texel(get_texel_column(si, mip_level), row, mip_level);
+				sum_weights  = sum_weights + weight;
 			}
 		}
+
+		result = sum / sum_weights;
+	}
+
+	if (!SIMD_float<L>::all_false(mask_bilinear)) {
+		result = SIMD_Vector3<L>::blend(result, sample_bilinear(s, t, get_mip_level(zero)), mask_bilinear);
 	}
 
-	return sum / sum_weights;
+	if (!SIMD_float<L>::all_false(mask_last)) {
+		result = SIMD_Vector3<L>::blend(result, fetch_last_texel<L>(), mask_last);
+	}
+
+	return result;
 }
+
+#define INSTANTIATE_TEXTURE(L) \
+	template Texture::MipLevel<L> Texture::get_mip_level(SIMD_float<L> level) const; \
+	template SIMD_Vector3<L> Texture::sample_nearest           (SIMD_float<L> s, SIMD_float<L> t)                                const; \
+	template SIMD_Vector3<L> Texture::sample_bilinear          (SIMD_float<L> s, SIMD_float<L> t, const MipLevel<L> & mip_level) const; \
+	template SIMD_Vector3<L> Texture::sample_mipmap_trilinear  (SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const; \
+	template SIMD_Vector3<L> Texture::sample_mipmap_anisotropic(SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const; \
+	template SIMD_Vector3<L> Texture::sample_mipmap_ewa        (SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const;
+SIMD_LANE_SIZES(INSTANTIATE_TEXTURE)
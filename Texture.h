@@ -1,7 +1,8 @@
 #pragma once
-#include "Vector2.h"
 #include "Vector3.h"
 
+#include "SIMD_Vector3.h"
+
 #include "Config.h"
 
 struct Texture {
@@ -22,21 +23,64 @@ private:
 
 	Vector3 fetch_texel(int x, int y, int level = 0) const;
 
-	Vector3 sample_nearest (float s, float t)                const;
-	Vector3 sample_bilinear(float s, float t, int level = 0) const;
+	// Dimensions and texel offset of the Mipmap level of every lane
+	template<int L>
+	struct MipLevel {
+		SIMD_float<L> width, height;
+		SIMD_int<L>   stride; // Width as an integer, rows are addressed in integer arithmetic so that the indices of large levels remain exact
+		SIMD_int<L>   offset;
+
+#if TEXTURE_TILED
+		SIMD_float<L> tiled; // Mask of the lanes whose level is stored in tiles
+#endif
+	};
+
+	template<int L>
+	MipLevel<L> get_mip_level(SIMD_float<L> level) const;
+
+	template<int L>
+	SIMD_int<L> get_texel_column(SIMD_float<L> x, const MipLevel<L> & mip_level) const;
+	template<int L>
+	SIMD_int<L> get_texel_row   (SIMD_float<L> y, const MipLevel<L> & mip_level) const;
+
+	template<int L>
+	SIMD_Vector3<L> fetch_texel(SIMD_int<L> column, SIMD_int<L> row, const MipLevel<L> & mip_level) const;
+	template<int L>
+	SIMD_Vector3<L> fetch_last_texel() const;
+
+	template<int L>
+	SIMD_Vector3<L> sample_nearest (SIMD_float<L> s, SIMD_float<L> t)                                const;
+	template<int L>
+	SIMD_Vector3<L> sample_bilinear(SIMD_float<L> s, SIMD_float<L> t, const MipLevel<L> & mip_level) const;
 	
-	Vector3 sample_mipmap_trilinear  (float s, float t, float ds_dx, float ds_dy, float dt_dx, float dt_dy) const;
-	Vector3 sample_mipmap_anisotropic(float s, float t, float ds_dx, float ds_dy, float dt_dx, float dt_dy) const;
-	Vector3 sample_mipmap_ewa        (float s, float t, float ds_dx, float ds_dy, float dt_dx, float dt_dy) const;
+	template<int L>
+	SIMD_Vector3<L> sample_mipmap_trilinear  (SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const;
+	template<int L>
+	SIMD_Vector3<L> sample_mipmap_anisotropic(SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const;
+	template<int L>
+	SIMD_Vector3<L> sample_mipmap_ewa        (SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy) const;
 
 public:
-	inline Vector3 sample(float s, float t, float ds_dx, float ds_dy, float dt_dx, float dt_dy) const {
+	// Samples the Texture for all lanes at once. Level selection, addressing and filtering are done per lane,
+	// lanes outside the mask are sampled at (0, 0) without a footprint and their result should be ignored
+	template<int L>
+	inline SIMD_Vector3<L> sample(SIMD_float<L> s, SIMD_float<L> t, SIMD_float<L> ds_dx, SIMD_float<L> ds_dy, SIMD_float<L> dt_dx, SIMD_float<L> dt_dy, SIMD_float<L> mask) const {
+		const SIMD_float<L> zero(0.0f);
+
+		// Inactive lanes may contain garbage, which could make them address memory outside the Texture
+		s = SIMD_float<L>::blend(zero, s, mask);
+		t = SIMD_float<L>::blend(zero, t, mask);
+		ds_dx = SIMD_float<L>::blend(zero, ds_dx, mask);
+		ds_dy = SIMD_float<L>::blend(zero, ds_dy, mask);
+		dt_dx = SIMD_float<L>::blend(zero, dt_dx, mask);
+		dt_dy = SIMD_float<L>::blend(zero, dt_dy, mask);
+
 #if TEXTURE_SAMPLE_MODE == TEXTURE_SAMPLE_MODE_NEAREST
 		return sample_nearest(s, t);
 #elif TEXTURE_SAMPLE_MODE == TEXTURE_SAMPLE_MODE_BILINEAR
-		return sample_bilinear(s, t);
+		return sample_bilinear(s, t, get_mip_level(zero));
 #elif TEXTURE_SAMPLE_MODE == TEXTURE_SAMPLE_MODE_MIPMAP
-		if (!mipmapped) return sample_bilinear(s, t);
+		if (!mipmapped) return sample_bilinear(s, t, get_mip_level(zero));
 
 	#if MIPMAP_FILTER == MIPMAP_FILTER_TRILINEAR
 		return sample_mipmap_trilinear(s, t, ds_dx, ds_dy, dt_dx, dt_dy);
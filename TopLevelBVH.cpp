@@ -2,11 +2,12 @@
 
 #include <algorithm>
 
-void TopLevelBVH::init(int count) {
+template<int L>
+void TopLevelBVH<L>::init(int count) {
 	assert(count > 0);
 
 	primitive_count = count; 
-	primitives = new Mesh[primitive_count];
+	primitives = new Mesh<L>[primitive_count];
 
 	indices = nullptr;
 
@@ -29,7 +30,8 @@ void TopLevelBVH::init(int count) {
 	indices = indices_x;
 }
 
-void TopLevelBVH::build_bvh() {
+template<int L>
+void TopLevelBVH<L>::build_bvh() {
 	std::sort(indices_x, indices_x + primitive_count, [&](int a, int b) { return primitives[a].get_position().x < primitives[b].get_position().x; });
 	std::sort(indices_y, indices_y + primitive_count, [&](int a, int b) { return primitives[a].get_position().y < primitives[b].get_position().y; });
 	std::sort(indices_z, indices_z + primitive_count, [&](int a, int b) { return primitives[a].get_position().z < primitives[b].get_position().z; });
@@ -44,36 +46,55 @@ void TopLevelBVH::build_bvh() {
 	leaf_count = primitive_count;
 }
 
-void TopLevelBVH::update() const {
+template<int L>
+void TopLevelBVH<L>::update() const {
 	for (int i = 0; i < primitive_count; i++) {
 		primitives[i].update();
 	}
 }
 
-void TopLevelBVH::trace(const Ray & ray, RayHit & ray_hit) const {
+template<int L>
+void TopLevelBVH<L>::trace(const Ray<L> & ray, RayHit<L> & ray_hit) const {
 	int stack[BVH_TRAVERSAL_STACK_SIZE];
 	int stack_size = 1;
 
 	// Push root on stack
 	stack[0] = 0;
 
-	int step = 0;
-	
-	SIMD_Vector3 inv_direction = SIMD_Vector3::rcp(ray.direction);
+	SIMD_Vector3<L> inv_direction = SIMD_Vector3<L>::rcp(ray.direction);
+
+	RayInterval interval(ray, inv_direction);
+
+#if BVH_PACKET_CULLING
+	float max_distance = SIMD_float<L>::hmax(ray_hit.distance);
+#endif
 
 	while (stack_size > 0) {
 		// Pop Node of the stack
 		const BVHNode & node = nodes[stack[--stack_size]];
 
-		SIMD_float mask = node.aabb.intersect(ray, inv_direction, ray_hit.distance);
-		if (SIMD_float::all_false(mask)) continue;
+#if BVH_COUNT_NODE_FETCHES && !PRIMARY_RAY_LARGE_PACKETS
+		ray_hit.node_fetches++;
+#endif
+
+#if BVH_PACKET_CULLING
+		// Reject the Node for the entire packet at once if no lane can possibly hit it
+		if (!node.aabb.intersect(interval, max_distance)) continue;
+#endif
+
+		SIMD_float<L> mask = node.aabb.intersect(ray, inv_direction, ray_hit.distance);
+		if (SIMD_float<L>::all_false(mask)) continue;
 
 		if (node.is_leaf()) {
 			for (int i = node.first; i < node.first + node.count; i++) {
-				primitives[indices[i]].trace(ray, ray_hit, step);
+				primitives[indices[i]].trace(ray, ray_hit, indices[i]);
 			}
+
+#if BVH_PACKET_CULLING
+			max_distance = SIMD_float<L>::hmax(ray_hit.distance);
+#endif
 		} else {
-			if (node.should_visit_left_first(ray)) {
+			if (node.should_visit_left_first(interval)) {
 				stack[stack_size++] = node.left + 1;
 				stack[stack_size++] = node.left;
 			} else {
@@ -81,12 +102,65 @@ void TopLevelBVH::trace(const Ray & ray, RayHit & ray_hit) const {
 				stack[stack_size++] = node.left + 1;
 			}
 		}
+	}
+}
 
-		step++;
+template<int L>
+void TopLevelBVH<L>::trace(LargeRayPacket<L> & packet) const {
+	typename LargeRayPacket<L>::StackEntry stack[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack[0] = { 0, 0 };
+
+	int packet_count = packet.packet_count;
+
+	SIMD_Vector3<L> inv_directions[LargeRayPacket<L>::MAX_PACKET_COUNT];
+	for (int p = 0; p < packet_count; p++) {
+		inv_directions[p] = SIMD_Vector3<L>::rcp(packet.rays[p].direction);
+	}
+
+	RayInterval interval(packet.rays, inv_directions, packet_count);
+
+	float max_distance = LargeRayPacket<L>::max_distance(packet.hits, 0, packet_count);
+
+	while (stack_size > 0) {
+		// Pop Node of the stack
+		typename LargeRayPacket<L>::StackEntry entry = stack[--stack_size];
+
+		const BVHNode & node = nodes[entry.node];
+
+#if BVH_COUNT_NODE_FETCHES
+		packet.node_fetches++;
+#endif
+
+		// Reject the Node for all packets at once if no lane can possibly hit it
+		if (!node.aabb.intersect(interval, max_distance)) continue;
+
+		// Packets before the first one that hit the parent can not hit its children either
+		int first_active = LargeRayPacket<L>::find_first_active(node.aabb, packet.rays, inv_directions, packet.hits, entry.first, packet_count);
+		if (first_active == packet_count) continue;
+
+		if (node.is_leaf()) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				primitives[indices[i]].trace(packet, first_active, indices[i]);
+			}
+
+			max_distance = LargeRayPacket<L>::max_distance(packet.hits, 0, packet_count);
+		} else {
+			if (node.should_visit_left_first(interval)) {
+				stack[stack_size++] = { node.left + 1, first_active };
+				stack[stack_size++] = { node.left,     first_active };
+			} else {
+				stack[stack_size++] = { node.left,     first_active };
+				stack[stack_size++] = { node.left + 1, first_active };
+			}
+		}
 	}
 }
 
-SIMD_float TopLevelBVH::intersect(const Ray & ray, SIMD_float max_distance) const {
+template<int L>
+SIMD_float<L> TopLevelBVH<L>::intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const {
 	int stack[BVH_TRAVERSAL_STACK_SIZE];
 	int stack_size = 1;
 
@@ -95,25 +169,45 @@ SIMD_float TopLevelBVH::intersect(const Ray & ray, SIMD_float max_distance) cons
 
 	int step = 0;
 
-	SIMD_float hit(0.0f);
+	const SIMD_float<L> zero(0.0f);
+
+	SIMD_float<L> hit(0.0f);
 	
-	SIMD_Vector3 inv_direction = SIMD_Vector3::rcp(ray.direction);
+	SIMD_Vector3<L> inv_direction = SIMD_Vector3<L>::rcp(ray.direction);
+
+	RayInterval interval(ray, inv_direction);
+
+#if BVH_PACKET_CULLING
+	const float packet_max_distance = SIMD_float<L>::hmax(max_distance);
+#endif
 
 	while (stack_size > 0) {
 		// Pop Node of the stack
 		const BVHNode & node = nodes[stack[--stack_size]];
 
-		SIMD_float mask = node.aabb.intersect(ray, inv_direction, max_distance);
-		if (SIMD_float::all_false(mask)) continue;
+#if BVH_PACKET_CULLING
+		// Reject the Node for the entire packet at once if no lane can possibly hit it
+		if (!node.aabb.intersect(interval, packet_max_distance)) continue;
+#endif
+
+		SIMD_float<L> mask = node.aabb.intersect(ray, inv_direction, max_distance);
+		if (SIMD_float<L>::all_false(mask)) continue;
 
 		if (node.is_leaf()) {
 			for (int i = node.first; i < node.first + node.count; i++) {
-				hit = hit | primitives[indices[i]].intersect(ray, max_distance);
+				SIMD_float<L> mesh_hit = primitives[indices[i]].intersect(ray, max_distance, occluder);
+				if (SIMD_float<L>::all_false(mesh_hit)) continue;
+
+				hit = hit | mesh_hit;
+				occluder.instance_id = indices[i];
+
+				if (SIMD_float<L>::all_true(hit)) return hit;
 
-				if (SIMD_float::all_true(hit)) return hit;
+				// Lanes that are occluded are retired, they no longer need to be tested against the remaining Meshes
+				max_distance = SIMD_float<L>::blend(max_distance, zero, hit);
 			}
 		} else {
-			if (node.should_visit_left_first(ray)) {
+			if (node.should_visit_left_first_occlusion()) {
 				stack[stack_size++] = node.left + 1;
 				stack[stack_size++] = node.left;
 			} else {
@@ -127,3 +221,66 @@ SIMD_float TopLevelBVH::intersect(const Ray & ray, SIMD_float max_distance) cons
 
 	return hit;
 }
+
+// Traverses the Top Level BVH once for all Lights in the batch, see BottomLevelBVH::intersect
+template<int L>
+void TopLevelBVH<L>::intersect(ShadowRayBatch<L> & batch) const {
+	int stack       [BVH_TRAVERSAL_STACK_SIZE];
+	int stack_lights[BVH_TRAVERSAL_STACK_SIZE];
+	int stack_size = 1;
+
+	// Push root on stack
+	stack       [0] = 0;
+	stack_lights[0] = batch.active_mask;
+
+	SIMD_Vector3<L> inv_direction[SHADOW_RAY_BATCH_SIZE];
+
+	for (int l = 0; l < batch.size; l++) {
+		inv_direction[l] = SIMD_Vector3<L>::rcp(batch.rays[l].direction);
+	}
+
+	while (stack_size > 0) {
+		// Pop Node of the stack
+		stack_size--;
+
+		const BVHNode & node = nodes[stack[stack_size]];
+
+		int parent_lights = stack_lights[stack_size] & batch.active_mask;
+		if (parent_lights == 0) continue;
+
+		// Determine which of the remaining Lights reach this Node
+		int node_lights = 0;
+
+		for (int remaining_lights = parent_lights; remaining_lights != 0; remaining_lights &= remaining_lights - 1) {
+			int l = _tzcnt_u32(remaining_lights);
+
+			SIMD_float<L> mask = node.aabb.intersect(batch.rays[l], inv_direction[l], batch.max_distance[l]);
+			if (!SIMD_float<L>::all_false(mask)) node_lights |= 1 << l;
+		}
+
+		if (node_lights == 0) continue;
+
+		if (node.is_leaf()) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				primitives[indices[i]].intersect(batch, node_lights & batch.active_mask, indices[i]);
+
+				if (batch.active_mask == 0) return;
+			}
+		} else {
+			if (node.should_visit_left_first_occlusion()) {
+				stack       [stack_size]   = node.left + 1;
+				stack_lights[stack_size++] = node_lights;
+				stack       [stack_size]   = node.left;
+				stack_lights[stack_size++] = node_lights;
+			} else {
+				stack       [stack_size]   = node.left;
+				stack_lights[stack_size++] = node_lights;
+				stack       [stack_size]   = node.left + 1;
+				stack_lights[stack_size++] = node_lights;
+			}
+		}
+	}
+}
+
+#define INSTANTIATE_TOP_LEVEL_BVH(L) template struct TopLevelBVH<L>;
+SIMD_LANE_SIZES(INSTANTIATE_TOP_LEVEL_BVH)
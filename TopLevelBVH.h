@@ -3,9 +3,10 @@
 
 #include "BVHBuilders.h"
 
+template<int L>
 struct TopLevelBVH {
-	Mesh * primitives;
-	int    primitive_count;
+	Mesh<L> * primitives;
+	int       primitive_count;
 
 	int * indices;
 	int   leaf_count;
@@ -27,7 +28,9 @@ struct TopLevelBVH {
 
 	void update() const;
 
-	void trace(const Ray & ray, RayHit & ray_hit) const;
+	void trace(const Ray<L> & ray, RayHit<L> & ray_hit) const;
+	void trace(LargeRayPacket<L> & packet) const;
 
-	SIMD_float intersect(const Ray & ray, SIMD_float max_distance) const;
+	SIMD_float<L> intersect(const Ray<L> & ray, SIMD_float<L> max_distance, Occluder & occluder) const;
+	void          intersect(ShadowRayBatch<L> & batch) const;
 };
@@ -24,4 +24,44 @@ struct Triangle {
 	inline Vector3 get_position() const {
 		return (position_0 + position_1 + position_2) * (1.0f / 3.0f);
 	}
+
+	// Moller-Trumbore test of a Ray packet against the Triangle given by its first vertex and the edges from that vertex to the other two.
+	// Returns the lanes that hit the Triangle closer than max_distance, from either side. Shared by all any-hit tests, so that they agree exactly
+	template<int L>
+	static FORCEINLINE SIMD_float<L> intersect(const Vector3 & position_0, const Vector3 & position_edge_1, const Vector3 & position_edge_2, const Ray<L> & ray, SIMD_float<L> max_distance) {
+		const SIMD_float<L> zero(0.0f);
+		const SIMD_float<L> one (1.0f);
+
+		SIMD_Vector3<L> edge_0(position_edge_1);
+		SIMD_Vector3<L> edge_1(position_edge_2);
+
+		SIMD_Vector3<L> h = SIMD_Vector3<L>::cross(ray.direction, edge_1);
+		SIMD_float<L>   a = SIMD_Vector3<L>::dot(edge_0, h);
+
+		SIMD_float<L>   f = SIMD_float<L>::rcp(a);
+		SIMD_Vector3<L> s = ray.origin - SIMD_Vector3<L>(position_0);
+		SIMD_float<L>   u = f * SIMD_Vector3<L>::dot(s, h);
+
+		// If the barycentric coordinate on the edge between vertices i and i+1
+		// is outside the interval [0, 1] we know no intersection is possible
+		SIMD_float<L> mask = (u > zero) & (u < one);
+		if (SIMD_float<L>::all_false(mask)) return mask;
+
+		SIMD_Vector3<L> q = SIMD_Vector3<L>::cross(s, edge_0);
+		SIMD_float<L>   v = f * SIMD_Vector3<L>::dot(ray.direction, q);
+
+		// If the barycentric coordinate on the edge between vertices i and i+2
+		// is outside the interval [0, 1] we know no intersection is possible
+		mask = mask & (v       > zero);
+		mask = mask & ((u + v) < one);
+		if (SIMD_float<L>::all_false(mask)) return mask;
+
+		SIMD_float<L> t = f * SIMD_Vector3<L>::dot(edge_1, q);
+
+		// Check if we are in the right distance range
+		mask = mask & (t > SIMD_float<L>(Ray<L>::EPSILON));
+		mask = mask & (t < max_distance);
+
+		return mask;
+	}
 };
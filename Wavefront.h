@@ -0,0 +1,171 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+#include "AABB.h"
+
+// Scalar Ray in a wavefront queue. Rays of the same bounce are collected for a whole tile,
+// sorted for coherence and then repacked into SIMD packets, see Raytracer::render_tile_wavefront
+struct WavefrontRay {
+	Vector3 origin;
+	Vector3 direction;
+
+#if RAY_DIFFERENTIALS_ENABLED
+	Vector3 dO_dx, dO_dy;
+	Vector3 dD_dx, dD_dy;
+#endif
+
+	Vector3 weight;     // Fraction of the colour found along this Ray that ends up in its pixel
+	Vector3 absorption; // Beer's Law is applied to the weight once the distance travelled through the medium is known, zero outside of a medium
+
+	int pixel; // Index of the pixel within the tile
+
+	bool is_refraction;
+
+	inline Vector3 get_position() const {
+		return origin;
+	}
+
+	// Rays are grouped by the octant of their direction
+	inline unsigned get_sort_group() const {
+		return (direction.x < 0.0f) | (direction.y < 0.0f) << 1 | (direction.z < 0.0f) << 2;
+	}
+};
+
+// Closest hit of a WavefrontRay, waiting to be shaded. Stores the HitAttributes of its lane,
+// together with the parts of the incoming Ray that are needed to spawn reflection and refraction Rays
+struct WavefrontHit {
+	Vector3 point;
+	Vector3 normal;
+
+	int   material_id;
+	float u, v;
+
+	Vector3 direction; // Direction of the incoming Ray
+
+#if RAY_DIFFERENTIALS_ENABLED
+	float ds_dx, ds_dy;
+	float dt_dx, dt_dy;
+
+	Vector3 dO_dx, dO_dy;
+	Vector3 dN_dx, dN_dy;
+
+	Vector3 dD_dx, dD_dy;
+#endif
+
+	Vector3 weight; // Weight of the incoming Ray, with Beer's Law already applied
+
+	int pixel;
+
+	inline Vector3 get_position() const {
+		return point;
+	}
+
+	// Hits are grouped by Material, so that a shading packet only has to access a single Material and Texture
+	inline unsigned get_sort_group() const {
+		return material_id;
+	}
+};
+
+// Shadow Ray in a wavefront queue, adds its colour to its pixel if it is not occluded
+struct WavefrontShadowRay {
+	Vector3 origin;
+	Vector3 direction;
+	float   max_distance;
+
+	Vector3 colour; // Unoccluded lighting, already multiplied by the weight of the Ray that found the hit
+
+	int pixel;
+	int light;
+
+	// Shadow Rays are grouped by Light, so that every packet goes to a single Light and can use its Occluder
+	inline Vector3 get_position() const {
+		return origin;
+	}
+
+	inline unsigned get_sort_group() const {
+		return light;
+	}
+};
+
+struct WavefrontSortKey {
+	unsigned long long key;
+	int                index;
+
+	inline bool operator<(const WavefrontSortKey & other) const {
+		return key < other.key;
+	}
+};
+
+// Queues of a single thread, reused between tiles so that they only allocate while growing
+struct WavefrontQueues {
+	std::vector<WavefrontRay> rays;
+	std::vector<WavefrontRay> rays_next;
+	std::vector<WavefrontRay> rays_sorted;
+
+	std::vector<WavefrontHit> hits;
+	std::vector<WavefrontHit> hits_sorted;
+
+	std::vector<WavefrontShadowRay> shadow_rays;
+	std::vector<WavefrontShadowRay> shadow_rays_sorted;
+
+	std::vector<WavefrontSortKey> sort_keys;
+
+	std::vector<Vector3> colours; // Accumulated colour of every pixel in the tile
+};
+
+namespace Wavefront {
+	// Spreads the lower 10 bits of the given integer out over 30 bits, leaving two zero bits in between every bit
+	inline unsigned expand_bits(unsigned x) {
+		x = (x | (x << 16)) & 0x030000ff;
+		x = (x | (x <<  8)) & 0x0300f00f;
+		x = (x | (x <<  4)) & 0x030c30c3;
+		x = (x | (x <<  2)) & 0x09249249;
+
+		return x;
+	}
+
+	inline unsigned morton_code(unsigned x, unsigned y, unsigned z) {
+		return expand_bits(x) | (expand_bits(y) << 1) | (expand_bits(z) << 2);
+	}
+
+	// Sorts the Rays (or hits) by their group first and by the Morton code of their position second,
+	// so that consecutive Rays, and therefore the Rays within a packet, are coherent
+	template<typename RayType>
+	inline void sort(std::vector<RayType> & rays, std::vector<RayType> & sorted, std::vector<WavefrontSortKey> & keys) {
+		int ray_count = rays.size();
+
+		AABB bounds = AABB::create_empty();
+		for (int i = 0; i < ray_count; i++) {
+			bounds.expand(rays[i].get_position());
+		}
+
+		Vector3 extent = bounds.max - bounds.min;
+		Vector3 scale(
+			extent.x > 0.0f ? 1023.0f / extent.x : 0.0f,
+			extent.y > 0.0f ? 1023.0f / extent.y : 0.0f,
+			extent.z > 0.0f ? 1023.0f / extent.z : 0.0f
+		);
+
+		keys.resize(ray_count);
+
+		for (int i = 0; i < ray_count; i++) {
+			Vector3 cell = (rays[i].get_position() - bounds.min) * scale;
+
+			unsigned morton = morton_code(unsigned(cell.x), unsigned(cell.y), unsigned(cell.z));
+
+			keys[i].key   = (unsigned long long)rays[i].get_sort_group() << 30 | morton;
+			keys[i].index = i;
+		}
+
+		std::sort(keys.begin(), keys.end());
+
+		sorted.resize(ray_count);
+
+		for (int i = 0; i < ray_count; i++) {
+			sorted[i] = rays[keys[i].index];
+		}
+
+		rays.swap(sorted);
+	}
+}
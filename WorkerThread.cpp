@@ -10,22 +10,27 @@ static HANDLE * done_signal;
 
 static volatile LONG remaining;
 
+static int lane_size; // Lane size of the Raytracer passed to init
+
+template<int L>
 struct Params {
 	int thread_id;
 
-	const Raytracer * raytracer;
-	const Window    * window;
+	const Raytracer<L> * raytracer;
+	const Window       * window;
 
 	PerformanceStats * stats;
+
+	ThreadState<L> * thread_state;
 };
-static Params * parameters;
 
 static PerformanceStats * stats;
 
 // This is the actual function that will run on each Worker Thread
 // It will wait until work becomes available, execute it and notify when the work is done
+template<int L>
 ULONG WINAPI worker_thread(LPVOID parameters) {
-	Params params = *reinterpret_cast<Params *>(parameters);
+	Params<L> params = *reinterpret_cast<Params<L> *>(parameters);
 
 	HANDLE thread = GetCurrentThread(); 
 
@@ -60,7 +65,7 @@ ULONG WINAPI worker_thread(LPVOID parameters) {
 				int tile_width  = x + params.window->tile_width  < params.window->width  ? params.window->tile_width  : params.window->width  - x;
 				int tile_height = y + params.window->tile_height < params.window->height ? params.window->tile_height : params.window->height - y;
 
-				params.raytracer->render_tile(*params.window, x, y, tile_width, tile_height, *params.stats);
+				params.raytracer->render_tile(*params.window, x, y, tile_width, tile_height, *params.stats, *params.thread_state);
 			} 
 		}
 		
@@ -69,7 +74,10 @@ ULONG WINAPI worker_thread(LPVOID parameters) {
 	}
 }
 
-void WorkerThreads::init(const Raytracer & raytracer, const Window & window) {
+template<int L>
+void WorkerThreads::init(const Raytracer<L> & raytracer, const Window & window) {
+	lane_size = L;
+
 #if USE_MULTITHREADING
 	thread_count = 0;
 
@@ -95,10 +103,12 @@ void WorkerThreads::init(const Raytracer & raytracer, const Window & window) {
 	go_signal   = new HANDLE[thread_count];
 	done_signal = new HANDLE[thread_count];
 
-	parameters = new Params[thread_count];
+	Params<L> * parameters = new Params<L>[thread_count];
 
 	stats = new PerformanceStats[thread_count];
 
+	int light_count = raytracer.get_light_count();
+
 	// Spawn the appropriate number of Worker Threads.
 	for (int i = 0; i < thread_count; i++) {
 		go_signal  [i] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
@@ -109,7 +119,13 @@ void WorkerThreads::init(const Raytracer & raytracer, const Window & window) {
 		parameters[i].window    = &window;
 		parameters[i].stats     = stats + i;
 
-		CreateThread(nullptr, 0, worker_thread, &parameters[i], 0, nullptr);
+		parameters[i].thread_state = new ThreadState<L>();
+		parameters[i].thread_state->occluders   = new Occluder[light_count];
+		parameters[i].thread_state->tile_lights = new int[light_count];
+		parameters[i].thread_state->lights      = new int[light_count];
+		parameters[i].thread_state->ray_stack   = new PendingRay<L>[RAY_STACK_SIZE];
+
+		CreateThread(nullptr, 0, worker_thread<L>, &parameters[i], 0, nullptr);
 	}
 }
 
@@ -136,13 +152,30 @@ PerformanceStats WorkerThreads::sum_performance_stats() {
 		result.num_shadow_rays     += stats[i].num_shadow_rays;
 		result.num_reflection_rays += stats[i].num_reflection_rays;
 		result.num_refraction_rays += stats[i].num_refraction_rays;
+
+		result.num_shadow_cache_hits   += stats[i].num_shadow_cache_hits;
+		result.num_shadow_rays_skipped += stats[i].num_shadow_rays_skipped;
+
+		result.num_bounce_lanes_terminated += stats[i].num_bounce_lanes_terminated;
+
+		result.num_packet_traversals     += stats[i].num_packet_traversals;
+		result.num_single_ray_traversals += stats[i].num_single_ray_traversals;
+
+		result.num_primary_node_fetches += stats[i].num_primary_node_fetches;
 	}
 
-	// Rays are traced in Packets of size SIMD_LINE_SIZE
-	result.num_primary_rays    *= SIMD_LANE_SIZE;
-	result.num_shadow_rays     *= SIMD_LANE_SIZE;
-	result.num_reflection_rays *= SIMD_LANE_SIZE;
-	result.num_refraction_rays *= SIMD_LANE_SIZE;
+	// Rays are traced in Packets of size lane_size
+	result.num_primary_rays    *= lane_size;
+	result.num_shadow_rays     *= lane_size;
+	result.num_reflection_rays *= lane_size;
+	result.num_refraction_rays *= lane_size;
+
+	result.num_shadow_cache_hits   *= lane_size;
+	result.num_shadow_rays_skipped *= lane_size;
 
 	return result;
 }
+
+#define INSTANTIATE_WORKER_THREADS(L) template void WorkerThreads::init(const Raytracer<L> & raytracer, const Window & window);
+
+SIMD_LANE_SIZES(INSTANTIATE_WORKER_THREADS)